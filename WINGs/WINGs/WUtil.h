@@ -780,6 +780,10 @@ WMPropList* WMRetainPropList(WMPropList *plist);
 
 void WMReleasePropList(WMPropList *plist);
 
+/* Number of property lists created and freed since the program started,
+ * to find the leaks */
+void WMGetPropListStats(unsigned long *created, unsigned long *freed);
+
 /* Objects inserted in arrays and dictionaries will be retained,
  * so you can safely release them after insertion.
  * For dictionaries both the key and value are retained.
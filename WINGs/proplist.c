@@ -57,6 +57,10 @@ static WMPropList *getPropList(PLData * pldata);
 
 typedef Bool(*isEqualFunc) (const void *, const void *);
 
+/* Number of property lists created and freed so far, see WMGetPropListStats */
+static unsigned long plists_created = 0;
+static unsigned long plists_freed = 0;
+
 static const WMHashTableCallbacks WMPropListHashCallbacks = {
 	hashPropList,
 	(isEqualFunc) WMIsPropListEqualTo,
@@ -172,6 +176,18 @@ static WMPropList *retainPropListByCount(WMPropList * plist, int count)
 	return plist;
 }
 
+static WMPropList *allocPropList(void)
+{
+	plists_created++;
+	return wmalloc(sizeof(W_PropList));
+}
+
+static void freePropList(WMPropList * plist)
+{
+	plists_freed++;
+	wfree(plist);
+}
+
 static void releasePropListByCount(WMPropList * plist, int count)
 {
 	WMPropList *key, *value;
@@ -184,13 +200,13 @@ static void releasePropListByCount(WMPropList * plist, int count)
 	case WPLString:
 		if (plist->retainCount < 1) {
 			wfree(plist->d.string);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLData:
 		if (plist->retainCount < 1) {
 			WMReleaseData(plist->d.data);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLArray:
@@ -199,7 +215,7 @@ static void releasePropListByCount(WMPropList * plist, int count)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeArray(plist->d.array);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLDictionary:
@@ -210,7 +226,7 @@ static void releasePropListByCount(WMPropList * plist, int count)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeHashTable(plist->d.dict);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	default:
@@ -900,13 +916,19 @@ void WMPLSetCaseSensitive(Bool caseSensitiveness)
 	caseSensitive = caseSensitiveness;
 }
 
+void WMGetPropListStats(unsigned long *created, unsigned long *freed)
+{
+	*created = plists_created;
+	*freed = plists_freed;
+}
+
 WMPropList *WMCreatePLString(const char *str)
 {
 	WMPropList *plist;
 
 	wassertrv(str != NULL, NULL);
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLString;
 	plist->d.string = wstrdup(str);
 	plist->retainCount = 1;
@@ -920,7 +942,7 @@ WMPropList *WMCreatePLData(WMData * data)
 
 	wassertrv(data != NULL, NULL);
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLData;
 	plist->d.data = WMRetainData(data);
 	plist->retainCount = 1;
@@ -934,7 +956,7 @@ WMPropList *WMCreatePLDataWithBytes(const unsigned char *bytes, unsigned int len
 
 	wassertrv(bytes != NULL, NULL);
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLData;
 	plist->d.data = WMCreateDataWithBytes(bytes, length);
 	plist->retainCount = 1;
@@ -948,7 +970,7 @@ WMPropList *WMCreatePLDataWithBytesNoCopy(unsigned char *bytes, unsigned int len
 
 	wassertrv(bytes != NULL, NULL);
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLData;
 	plist->d.data = WMCreateDataWithBytesNoCopy(bytes, length, destructor);
 	plist->retainCount = 1;
@@ -961,7 +983,7 @@ WMPropList *WMCreatePLArray(WMPropList * elem, ...)
 	WMPropList *plist, *nelem;
 	va_list ap;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLArray;
 	plist->d.array = WMCreateArray(4);
 	plist->retainCount = 1;
@@ -988,7 +1010,7 @@ WMPropList *WMCreatePLDictionary(WMPropList * key, WMPropList * value, ...)
 	WMPropList *plist, *nkey, *nvalue, *k, *v;
 	va_list ap;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList();
 	plist->type = WPLDictionary;
 	plist->d.dict = WMCreateHashTable(WMPropListHashCallbacks);
 	plist->retainCount = 1;
@@ -1065,13 +1087,13 @@ void WMReleasePropList(WMPropList * plist)
 	case WPLString:
 		if (plist->retainCount < 1) {
 			wfree(plist->d.string);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLData:
 		if (plist->retainCount < 1) {
 			WMReleaseData(plist->d.data);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLArray:
@@ -1080,7 +1102,7 @@ void WMReleasePropList(WMPropList * plist)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeArray(plist->d.array);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLDictionary:
@@ -1091,7 +1113,7 @@ void WMReleasePropList(WMPropList * plist)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeHashTable(plist->d.dict);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	default:
@@ -1380,7 +1402,7 @@ WMPropList *WMGetPLDictionaryKeys(WMPropList * plist)
 
 	wassertrv(plist->type == WPLDictionary, NULL);
 
-	array = (WMPropList *) wmalloc(sizeof(W_PropList));
+	array = allocPropList();
 	array->type = WPLArray;
 	array->d.array = WMCreateArray(WMCountHashTable(plist->d.dict));
 	array->retainCount = 1;
@@ -1411,7 +1433,7 @@ WMPropList *WMShallowCopyPropList(WMPropList * plist)
 		WMReleaseData(data);
 		break;
 	case WPLArray:
-		ret = (WMPropList *) wmalloc(sizeof(W_PropList));
+		ret = allocPropList();
 		ret->type = WPLArray;
 		ret->d.array = WMCreateArrayWithArray(plist->d.array);
 		ret->retainCount = 1;
@@ -102,6 +102,52 @@ AC_DEFUN_ONCE([WM_XEXT_CHECK_XSHM],
 ]) dnl AC_DEFUN
 
 
+# WM_XEXT_CHECK_XRENDER
+# ---------------------
+#
+# Check for the RENDER extension, used for server side scaling
+# The check depends on variable 'enable_xrender' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in XLIBS, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XRENDER],
+[WM_LIB_CHECK([XRender], [-lXrender], [XRenderCreatePicture], [$XLIBS],
+    [wm_save_CFLAGS="$CFLAGS"
+     AS_IF([wm_fn_lib_try_compile "X11/extensions/Xrender.h" "" "XRenderSetPictureFilter(NULL, 0, FilterBilinear, NULL, 0)" ""],
+        [],
+        [AC_MSG_ERROR([found $CACHEVAR but cannot compile using XRender header])])
+     CFLAGS="$wm_save_CFLAGS"],
+    [supported_xext], [XLIBS], [enable_xrender], [-])dnl
+]) dnl AC_DEFUN
+
+
+# WM_XEXT_CHECK_XDAMAGE
+# ---------------------
+#
+# Check for the DAMAGE extension, used to know when a window was drawn in
+# The check depends on variable 'enable_xdamage' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in XLIBS, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XDAMAGE],
+[WM_LIB_CHECK([XDamage], [-lXdamage], [XDamageCreate], [$XLIBS],
+    [wm_save_CFLAGS="$CFLAGS"
+     AS_IF([wm_fn_lib_try_compile "X11/extensions/Xdamage.h" "" "XDamageSubtract(NULL, None, None, None)" ""],
+        [],
+        [AC_MSG_ERROR([found $CACHEVAR but cannot compile using XDamage header])])
+     CFLAGS="$wm_save_CFLAGS"],
+    [supported_xext], [XLIBS], [enable_xdamage], [-])dnl
+]) dnl AC_DEFUN
+
+
 # WM_XEXT_CHECK_XMU
 # -----------------
 #
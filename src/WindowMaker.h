@@ -525,6 +525,9 @@ extern struct WPreferences {
 	Cursor cursor[WCUR_LAST];
 
     int switch_panel_icon_size;               /* icon size in switch panel */
+    int switch_panel_blur;                    /* blur radius for the switch panel background */
+
+    int session_launch_limit;                 /* applications of the session started together, 0 for all */
 
 } wPreferences;
 
@@ -580,6 +583,7 @@ extern struct wmaker_global_variables {
 	struct {
 		int fd_event_queue;   /* Inotify's queue file descriptor */
 		int wd_defaults;   /* Watch Descriptor for the 'Defaults' configuration file */
+		WMHandlerID handler;   /* reads the queue when the event loop waits */
 	} inotify;
 #endif
 
@@ -659,6 +663,19 @@ extern struct wmaker_global_variables {
 		} randr;
 #endif
 
+#ifdef USE_XRENDER
+		struct {
+			Bool supported;
+		} render;
+#endif
+
+#ifdef USE_XDAMAGE
+		struct {
+			Bool supported;
+			int event_base;
+		} damage;
+#endif
+
 		/*
 		 * If no extension were activated, we would end up with an empty
 		 * structure, which old compilers may not appreciate, so let's
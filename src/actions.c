@@ -26,8 +26,12 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
+#ifdef USE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
 #include <stdint.h>
@@ -48,10 +52,12 @@
 #include "winspector.h"
 #include "workspace.h"
 #include "xinerama.h"
+#include "spatial.h"
 #include "usermenu.h"
 #include "placement.h"
 #include "misc.h"
 #include "event.h"
+#include "minipreview.h"
 
 
 #ifndef HAVE_FLOAT_MATHFUNC
@@ -212,6 +218,7 @@ void wSetFocusTo(WScreen *scr, WWindow *wwin)
 		focused->next = wwin;
 		wwin->next = NULL;
 		scr->focused_window = wwin;
+		wWorkspaceIndexRaise(wwin);
 
 		if (oapp && oapp != napp) {
 			wAppMenuUnmap(oapp->menu);
@@ -261,6 +268,7 @@ void wShadeWindow(WWindow *wwin)
 
 	/* for the client it's just like iconification */
 	wFrameWindowResize(wwin->frame, wwin->frame->core->width, wwin->frame->top_width - 1);
+	wSpatialUpdate(wwin);
 
 	wwin->client.y = wwin->frame_y - wwin->client.height + wwin->frame->top_width;
 	wWindowSynthConfigureNotify(wwin);
@@ -294,6 +302,7 @@ void wUnshadeWindow(WWindow *wwin)
 	wwin->flags.skip_next_animation = 0;
 	wFrameWindowResize(wwin->frame, wwin->frame->core->width,
 			   wwin->frame->top_width + wwin->client.height + wwin->frame->bottom_width);
+	wSpatialUpdate(wwin);
 
 	wwin->client.y = wwin->frame_y + wwin->frame->top_width;
 	wWindowSynthConfigureNotify(wwin);
@@ -1067,6 +1076,123 @@ void wUnfullscreenWindow(WWindow *wwin)
 }
 
 #ifdef USE_ANIMATIONS
+/*
+ * Draw the window contents scaled to the size of the animation overlay.
+ *
+ * When the RENDER extension is available, the snapshot is sent once to the
+ * X server and each frame is scaled there with a bilinear filter; otherwise
+ * the snapshot is scaled and sent again each time the size changes.
+ */
+typedef struct AnimationFrames {
+	WScreen *scr;
+	RImage *snapshot;
+	Window overlay;
+	GC gc;
+
+#ifdef USE_XRENDER
+	Pixmap src_pixmap;
+	Picture src_picture;
+	Picture dst_picture;
+#endif
+
+	/* used when RENDER is not available */
+	Pixmap pixmap;
+	int width, height;
+} AnimationFrames;
+
+static void animation_frames_init(AnimationFrames *af, WScreen *scr, RImage *snapshot,
+                                  Window overlay, GC gc)
+{
+	memset(af, 0, sizeof(*af));
+	af->scr = scr;
+	af->snapshot = snapshot;
+	af->overlay = overlay;
+	af->gc = gc;
+
+#ifdef USE_XRENDER
+	if (w_global.xext.render.supported) {
+		XRenderPictFormat *src_format, *dst_format;
+		XRenderPictureAttributes pattr;
+
+		src_format = XRenderFindVisualFormat(dpy, scr->w_visual);
+		dst_format = XRenderFindVisualFormat(dpy, DefaultVisual(dpy, scr->screen));
+		if (!src_format || !dst_format)
+			return;
+
+		if (!RConvertImage(scr->rcontext, snapshot, &af->src_pixmap))
+			return;
+
+		/* Do not repeat the edge pixels when the filter reads outside */
+		pattr.repeat = RepeatPad;
+		af->src_picture = XRenderCreatePicture(dpy, af->src_pixmap, src_format, CPRepeat, &pattr);
+		XRenderSetPictureFilter(dpy, af->src_picture, FilterBilinear, NULL, 0);
+		af->dst_picture = XRenderCreatePicture(dpy, overlay, dst_format, 0, NULL);
+	}
+#endif
+}
+
+static Bool animation_frames_draw(AnimationFrames *af, int width, int height)
+{
+	RImage *scaled;
+
+#ifdef USE_XRENDER
+	if (af->src_picture != None) {
+		XTransform transform = {{
+			{ XDoubleToFixed((double)af->snapshot->width / width), 0, 0 },
+			{ 0, XDoubleToFixed((double)af->snapshot->height / height), 0 },
+			{ 0, 0, XDoubleToFixed(1.0) }
+		}};
+
+		XRenderSetPictureTransform(dpy, af->src_picture, &transform);
+		XRenderComposite(dpy, PictOpSrc, af->src_picture, None, af->dst_picture,
+				 0, 0, 0, 0, 0, 0, width, height);
+		return True;
+	}
+#endif
+
+	if (width != af->width || height != af->height || af->pixmap == None) {
+		if (af->pixmap != None) {
+			XFreePixmap(dpy, af->pixmap);
+			af->pixmap = None;
+		}
+
+		if (af->snapshot->width == (unsigned)width && af->snapshot->height == (unsigned)height)
+			scaled = RRetainImage(af->snapshot);
+		else
+			scaled = RScaleImage(af->snapshot, width, height);
+		if (!scaled)
+			return False;
+
+		if (!RConvertImage(af->scr->rcontext, scaled, &af->pixmap)) {
+			RReleaseImage(scaled);
+			af->pixmap = None;
+			return False;
+		}
+		RReleaseImage(scaled);
+
+		af->width = width;
+		af->height = height;
+	}
+
+	XCopyArea(dpy, af->pixmap, af->overlay, af->gc, 0, 0, width, height, 0, 0);
+	return True;
+}
+
+static void animation_frames_release(AnimationFrames *af)
+{
+#ifdef USE_XRENDER
+	if (af->dst_picture != None)
+		XRenderFreePicture(dpy, af->dst_picture);
+	if (af->src_picture != None)
+		XRenderFreePicture(dpy, af->src_picture);
+	if (af->src_pixmap != None)
+		XFreePixmap(dpy, af->src_pixmap);
+#endif
+
+	if (af->pixmap != None)
+		XFreePixmap(dpy, af->pixmap);
+}
+
 static Bool animateResizeGlideWithContents(WWindow *wwin, RImage *snapshot,
                                            int x, int y, int w, int h,
                                            int fx, int fy, int fw, int fh)
@@ -1079,9 +1205,7 @@ static Bool animateResizeGlideWithContents(WWindow *wwin, RImage *snapshot,
         Atom opacity_atom;
         int steps = MINIATURIZE_ANIMATION_STEPS_GLIDE;
         int delay = MINIATURIZE_ANIMATION_DELAY_GLIDE;
-        int prev_w = -1, prev_h = -1;
-        Pixmap pix = None;
-        RImage *scaled = NULL;
+        AnimationFrames frames;
         Bool success = True;
 
         if (!snapshot || steps <= 0)
@@ -1112,6 +1236,8 @@ static Bool animateResizeGlideWithContents(WWindow *wwin, RImage *snapshot,
 
         opacity_atom = XInternAtom(display, "_NET_WM_WINDOW_OPACITY", False);
 
+        animation_frames_init(&frames, scr, snapshot, overlay, gc);
+
         XMapRaised(display, overlay);
         XGrabServer(display);
 
@@ -1142,38 +1268,13 @@ static Bool animateResizeGlideWithContents(WWindow *wwin, RImage *snapshot,
                 if (cur_h <= 0)
                         cur_h = 1;
 
-                if (cur_w != prev_w || cur_h != prev_h) {
-                        if (pix != None)
-                                XFreePixmap(display, pix);
-                        if (scaled)
-                                RReleaseImage(scaled);
-
-                        if (snapshot->width == (unsigned)cur_w && snapshot->height == (unsigned)cur_h)
-                                scaled = RRetainImage(snapshot);
-                        else
-                                scaled = RScaleImage(snapshot, cur_w, cur_h);
-
-                        if (!scaled) {
-                                success = False;
-                                break;
-                        }
-
-                        if (!RConvertImage(scr->rcontext, scaled, &pix)) {
-                                RReleaseImage(scaled);
-                                scaled = NULL;
-                                success = False;
-                                break;
-                        }
-
-                        prev_w = cur_w;
-                        prev_h = cur_h;
-                }
-
                 XResizeWindow(display, overlay, cur_w, cur_h);
                 XMoveWindow(display, overlay, cur_x, cur_y);
 
-                if (pix != None)
-                        XCopyArea(display, pix, overlay, gc, 0, 0, cur_w, cur_h, 0, 0);
+                if (!animation_frames_draw(&frames, cur_w, cur_h)) {
+                        success = False;
+                        break;
+                }
 
                 XFlush(display);
                 if (delay > 0)
@@ -1183,10 +1284,7 @@ static Bool animateResizeGlideWithContents(WWindow *wwin, RImage *snapshot,
         XUngrabServer(display);
         XUnmapWindow(display, overlay);
 
-        if (pix != None)
-                XFreePixmap(display, pix);
-        if (scaled)
-                RReleaseImage(scaled);
+        animation_frames_release(&frames);
 
         XFreeGC(display, gc);
         XDestroyWindow(display, overlay);
@@ -1234,6 +1332,7 @@ static Bool animateResizeWithContents(WWindow *wwin, RImage *snapshot,
         XSetWindowAttributes attr;
 	Window overlay;
 	GC gc;
+	AnimationFrames frames;
 	Bool success = True;
 	int steps;
 
@@ -1273,6 +1372,8 @@ static Bool animateResizeWithContents(WWindow *wwin, RImage *snapshot,
 		return False;
 	}
 
+	animation_frames_init(&frames, scr, snapshot, overlay, gc);
+
 	XMapRaised(display, overlay);
 	XGrabServer(display);
 
@@ -1282,42 +1383,26 @@ static Bool animateResizeWithContents(WWindow *wwin, RImage *snapshot,
 		int cur_h = h + (int)((fh - h) * t + 0.5);
 		int cur_x = x + (int)((fx - x) * t + 0.5);
 		int cur_y = y + (int)((fy - y) * t + 0.5);
-		RImage *scaled;
-		Pixmap pix;
 
 		if (cur_w <= 0)
 			cur_w = 1;
 		if (cur_h <= 0)
 			cur_h = 1;
 
-		if (snapshot->width == (unsigned)cur_w && snapshot->height == (unsigned)cur_h)
-			scaled = RRetainImage(snapshot);
-		else
-			scaled = RScaleImage(snapshot, cur_w, cur_h);
-		if (!scaled) {
-			success = False;
-			break;
-		}
-
-		if (!RConvertImage(scr->rcontext, scaled, &pix)) {
-			RReleaseImage(scaled);
+		XResizeWindow(display, overlay, cur_w, cur_h);
+		XMoveWindow(display, overlay, cur_x, cur_y);
+		if (!animation_frames_draw(&frames, cur_w, cur_h)) {
 			success = False;
 			break;
 		}
-
-		XResizeWindow(display, overlay, cur_w, cur_h);
-		XMoveWindow(display, overlay, cur_x, cur_y);
-		XCopyArea(display, pix, overlay, gc, 0, 0, cur_w, cur_h, 0, 0);
 		XFlush(display);
 		if (MINIATURIZE_ANIMATION_DELAY_Z > 0)
 			wusleep(MINIATURIZE_ANIMATION_DELAY_Z);
-
-		XFreePixmap(display, pix);
-		RReleaseImage(scaled);
 	}
 
 	XUngrabServer(display);
 	XUnmapWindow(display, overlay);
+	animation_frames_release(&frames);
 	XDestroyWindow(display, overlay);
 	XFreeGC(display, gc);
 	XFlush(display);
@@ -1706,45 +1791,9 @@ void wIconifyWindow(WWindow *wwin)
 
                 if (wPreferences.show_window_contents_in_animations &&
                     wwin->client_win && wwin->flags.mapped) {
-                        RImage *mini_preview;
-                        XImage *pimg;
-                        unsigned int w, h;
-                        int x, y;
-                        Window baz;
-
+                        /* It must be read before the window is unmapped, the scaling is done in background */
                         XRaiseWindow(dpy, wwin->frame->core->window);
-                        XTranslateCoordinates(dpy, wwin->client_win, wwin->screen_ptr->root_win, 0, 0, &x, &y, &baz);
-
-                        w = attribs.width;
-                        h = attribs.height;
-
-                        if (x - attribs.x + attribs.width > wwin->screen_ptr->scr_width)
-                                w = wwin->screen_ptr->scr_width - x + attribs.x;
-
-                        if (y - attribs.y + attribs.height > wwin->screen_ptr->scr_height)
-                                h = wwin->screen_ptr->scr_height - y + attribs.y;
-
-                        pimg = XGetImage(dpy, wwin->client_win, 0, 0, w, h, AllPlanes, ZPixmap);
-                        if (pimg) {
-                                mini_preview = RCreateImageFromXImage(wwin->screen_ptr->rcontext, pimg, NULL);
-                                XDestroyImage(pimg);
-
-                                if (mini_preview) {
-                                        set_icon_minipreview(wwin->icon, mini_preview);
-                                        RReleaseImage(mini_preview);
-                                } else {
-                                        const char *title;
-                                        char title_buf[32];
-
-                                        if (wwin->frame->title) {
-                                                title = wwin->frame->title;
-                                        } else {
-                                                snprintf(title_buf, sizeof(title_buf), "(id=0x%lx)", wwin->client_win);
-                                                title = title_buf;
-                                        }
-                                        wwarning(_("creation of mini-preview failed for window \"%s\""), title);
-                                }
-                        }
+                        wMiniPreviewUpdate(wwin);
                 }
         }
 
@@ -2355,6 +2404,7 @@ void wArrangeIcons(WScreen *scr, Bool arrangeAll)
 {
 	WWindow *wwin;
 	WAppIcon *aicon;
+	Bool all_windows;
 
 	int head;
 	const int heads = wXineramaHeads(scr);
@@ -2463,11 +2513,17 @@ void wArrangeIcons(WScreen *scr, Bool arrangeAll)
 		aicon = aicon->prev;
 	}
 
-	/* arrange miniwindows */
-	wwin = scr->focused_window;
-	/* reverse them to avoid unnecessarily shuffling */
-	while (wwin && wwin->prev)
-		wwin = wwin->prev;
+	/* arrange miniwindows, only those of the current workspace matter
+	 * unless they are all shown or have to be reset */
+	all_windows = wPreferences.sticky_icons || arrangeAll;
+	if (all_windows) {
+		wwin = scr->focused_window;
+		/* reverse them to avoid unnecessarily shuffling */
+		while (wwin && wwin->prev)
+			wwin = wwin->prev;
+	} else {
+		wwin = scr->workspace_windows[scr->current_workspace].oldest;
+	}
 
 	while (wwin) {
 		if (wwin->icon && wwin->flags.miniaturized && !wwin->flags.hidden &&
@@ -2493,7 +2549,7 @@ void wArrangeIcons(WScreen *scr, Bool arrangeAll)
 		if (arrangeAll)
 			wwin->flags.icon_moved = 0;
 		/* we reversed the order, so we use next */
-		wwin = wwin->next;
+		wwin = all_windows ? wwin->next : wwin->next_in_workspace;
 	}
 
 	wfree(vars);
@@ -2536,6 +2592,9 @@ void wSelectWindow(WWindow *wwin, Bool flag)
 		if (scr->selected_windows)
 			WMRemoveFromArray(scr->selected_windows, wwin);
 	}
+
+	/* the border of borderless windows is shown while they are selected */
+	wSpatialUpdate(wwin);
 }
 
 void wMakeWindowVisible(WWindow *wwin)
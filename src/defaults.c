@@ -64,6 +64,8 @@
 #include "properties.h"
 #include "misc.h"
 #include "winmenu.h"
+#include "switchpanel.h"
+#include "trace.h"
 
 #define MAX_SHORTCUT_LENGTH 32
 
@@ -149,6 +151,7 @@ static WDECallbackUpdate setClipTitleColor;
 
 static WDECallbackUpdate setMenuStyle;
 static WDECallbackUpdate setSwPOptions;
+static WDECallbackUpdate setSwitchPanelBlur;
 static WDECallbackUpdate updateUsableArea;
 
 static WDECallbackUpdate setModifierKeyLabels;
@@ -432,6 +435,8 @@ WDefaultEntry optionList[] = {
 	    &wPreferences.sticky_icons, getBool, setStickyIcons, NULL, NULL},
 	{"SaveSessionOnExit", "NO", NULL,
 	    &wPreferences.save_session_on_exit, getBool, NULL, NULL, NULL},
+	{"SessionLaunchLimit", "8", NULL,
+	    &wPreferences.session_launch_limit, getInt, NULL, NULL, NULL},
 	{"WrapMenus", "NO", NULL,
 	    &wPreferences.wrap_menus, getBool, NULL, NULL, NULL},
 	{"ScrollableMenus", "YES", NULL,
@@ -655,6 +660,8 @@ WDefaultEntry optionList[] = {
 	    NULL, getColor, setIconTitleBack, NULL, NULL},
 	{"SwitchPanelImages", "(swtile.png, swback.png, 30, 40)", &wPreferences,
 	    NULL, getPropList, setSwPOptions, NULL, NULL},
+	{"SwitchPanelBlur", "0", NULL,
+	    &wPreferences.switch_panel_blur, getInt, setSwitchPanelBlur, NULL, NULL},
 	{"ModifierKeyLabels", "(\"Shift+\", \"Control+\", \"Mod1+\", \"Mod2+\", \"Mod3+\", \"Mod4+\", \"Mod5+\")", &wPreferences,
 	    NULL, getPropList, setModifierKeyLabels, NULL, NULL},
 	{"FrameBorderWidth", "1", NULL,
@@ -899,6 +906,8 @@ static void initDefaults(void)
 	unsigned int i;
 	WDefaultEntry *entry;
 
+	wTraceBegin("initDefaults");
+
 	WMPLSetCaseSensitive(False);
 
 	for (i = 0; i < wlengthof(optionList); i++) {
@@ -920,6 +929,8 @@ static void initDefaults(void)
 		else
 			entry->plvalue = NULL;
 	}
+
+	wTraceEnd("initDefaults");
 }
 
 static WMPropList *readGlobalDomain(const char *domainName, Bool requireDictionary)
@@ -1219,6 +1230,8 @@ void wReadDefaults(WScreen * scr, WMPropList * new_dict)
 	void *tdata;
 	WMPropList *old_dict = (w_global.domain.wmaker->dictionary != new_dict ? w_global.domain.wmaker->dictionary : NULL);
 
+	wTraceBegin("wReadDefaults");
+
 	needs_refresh = 0;
 
 	for (i = 0; i < wlengthof(optionList); i++) {
@@ -1336,6 +1349,8 @@ void wReadDefaults(WScreen * scr, WMPropList * new_dict)
 				scr->clip_submenu->flags.realized = 0;
 		}
 	}
+
+	wTraceEnd("wReadDefaults");
 }
 
 void wDefaultUpdateIcons(WScreen *scr)
@@ -1344,6 +1359,8 @@ void wDefaultUpdateIcons(WScreen *scr)
 	WDrawerChain *dc;
 	WWindow *wwin = scr->focused_window;
 
+	wSwitchPanelFlushCache();
+
 	while (aicon) {
 		/* Get the application icon, default included */
 		wIconChangeImageFile(aicon->icon, NULL);
@@ -1706,9 +1723,9 @@ static int getEnum(WScreen * scr, WDefaultEntry * entry, WMPropList * value, voi
  * (mvgradient <color> <color> ...)
  * (mdgradient <color> <color> ...)
  * (igradient <color1> <color1> <thickness1> <color2> <color2> <thickness2>)
- * (tpixmap <file> <color>)
- * (spixmap <file> <color>)
- * (cpixmap <file> <color>)
+ * (tpixmap <file> <color> [<blur radius>])
+ * (spixmap <file> <color> [<blur radius>])
+ * (cpixmap <file> <color> [<blur radius>])
  * (thgradient <file> <opaqueness> <color> <color>)
  * (tvgradient <file> <opaqueness> <color> <color>)
  * (tdgradient <file> <opaqueness> <color> <color>)
@@ -1913,8 +1930,9 @@ static WTexture *parse_texture(WScreen * scr, WMPropList * pl)
 		   strcasecmp(val, "cpixmap") == 0 || strcasecmp(val, "tpixmap") == 0) {
 		XColor color;
 		int type;
+		int blur = 0;
 
-		if (nelem != 3)
+		if (nelem != 3 && nelem != 4)
 			return NULL;
 
 		if (val[0] == 's' || val[0] == 'S')
@@ -1936,13 +1954,26 @@ static WTexture *parse_texture(WScreen * scr, WMPropList * pl)
 			return NULL;
 		}
 
+		/* optional blur radius */
+		if (nelem == 4) {
+			elem = WMGetFromPLArray(pl, 3);
+			if (!elem || !WMIsPLString(elem))
+				return NULL;
+			val = WMGetFromPLString(elem);
+
+			if (sscanf(val, "%i", &blur) != 1 || blur < 0 || blur > MAX_BLUR_RADIUS) {
+				wwarning(_("bad blur radius value in pixmap texture specification"));
+				blur = 0;
+			}
+		}
+
 		/* file name */
 		elem = WMGetFromPLArray(pl, 1);
 		if (!elem || !WMIsPLString(elem))
 			return NULL;
 		val = WMGetFromPLString(elem);
 
-		texture = (WTexture *) wTextureMakePixmap(scr, type, val, &color);
+		texture = (WTexture *) wTextureMakePixmap(scr, type, val, &color, blur);
 	} else if (strcasecmp(val, "thgradient") == 0
 		   || strcasecmp(val, "tvgradient") == 0 || strcasecmp(val, "tdgradient") == 0) {
 		RColor color1, color2;
@@ -3403,6 +3434,7 @@ static int setSwPOptions(WScreen * scr, WDefaultEntry * entry, void *tdata, void
 		prefs->swtileImage = NULL;
 
 		WMReleasePropList(array);
+		wSwitchPanelFlushCache();
 		return 0;
 	}
 
@@ -3507,6 +3539,8 @@ static int setSwPOptions(WScreen * scr, WDefaultEntry * entry, void *tdata, void
 
 	WMReleasePropList(array);
 
+	wSwitchPanelFlushCache();
+
 	return 0;
 }
 
@@ -3578,6 +3612,23 @@ static int setHotCornerActions(WScreen * scr, WDefaultEntry * entry, void *tdata
 }
 
 
+static int setSwitchPanelBlur(WScreen *scr, WDefaultEntry *entry, void *tdata, void *foo)
+{
+	int *value = tdata;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) scr;
+	(void) foo;
+
+	if (*value < 0 || *value > MAX_BLUR_RADIUS) {
+		wwarning(_("bad value %d for option \"%s\", it must be between 0 and %d; blur disabled"),
+			 *value, entry->key, MAX_BLUR_RADIUS);
+		wPreferences.switch_panel_blur = 0;
+	}
+
+	return 0;
+}
+
 static int setDoubleClick(WScreen *scr, WDefaultEntry *entry, void *tdata, void *foo)
 {
 	int *value = tdata;
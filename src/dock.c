@@ -62,6 +62,7 @@
 #include "placement.h"
 #include "misc.h"
 #include "event.h"
+#include "iconprefetch.h"
 
 /**** Local variables ****/
 #define CLIP_REWIND       1
@@ -1883,6 +1884,131 @@ WAppIcon *wClipRestoreState(WScreen *scr, WMPropList *clip_state)
 	return icon;
 }
 
+static WMPropList *get_saved_applications(WScreen *scr, WMPropList *dock_state)
+{
+	WMPropList *apps, *tmp;
+	char buffer[64];
+
+	/*
+	 * When saving, it saves the dock state in
+	 * Applications and Applicationsnnn
+	 *
+	 * When loading, it will first try Applicationsnnn.
+	 * If it does not exist, use Applications as default.
+	 */
+
+	snprintf(buffer, sizeof(buffer), "Applications%i", scr->scr_height);
+
+	tmp = WMCreatePLString(buffer);
+	apps = WMGetFromPLDictionary(dock_state, tmp);
+	WMReleasePropList(tmp);
+
+	if (!apps)
+		apps = WMGetFromPLDictionary(dock_state, dApplications);
+
+	return apps;
+}
+
+/* Add the icon files of the applications in the list, as restore_icon_state would find them */
+static void collect_icon_files(WMPropList *apps, WMArray *files)
+{
+	WMPropList *info, *cmd, *name;
+	char *wclass, *winstance, *file;
+	int i;
+
+	if (!apps || !WMIsPLArray(apps))
+		return;
+
+	for (i = 0; i < WMGetPropListItemCount(apps); i++) {
+		info = WMGetFromPLArray(apps, i);
+		if (!WMIsPLDictionary(info))
+			continue;
+
+		cmd = WMGetFromPLDictionary(info, dCommand);
+		if (!cmd || !WMIsPLString(cmd) || strcmp(WMGetFromPLString(cmd), "-") == 0)
+			continue;
+
+		name = WMGetFromPLDictionary(info, dName);
+		if (!name)
+			continue;
+
+		ParseWindowName(name, &winstance, &wclass, "dock");
+		if (!winstance && !wclass)
+			continue;
+
+		file = get_icon_filename(winstance, wclass, WMGetFromPLString(cmd), False);
+		if (file)
+			WMAddToArray(files, file);
+
+		if (wclass)
+			wfree(wclass);
+		if (winstance)
+			wfree(winstance);
+	}
+}
+
+/*
+ * Decode in advance, using several threads, the icons of all the applications
+ * saved in the dock, the clips and the drawers, so the restore functions will
+ * only have to convert them for the X server
+ */
+void wDockPrefetchIcons(WScreen *scr)
+{
+	WMPropList *state, *list, *key;
+	WMArray *files;
+	int i;
+
+	make_keys();
+
+	if (!scr->session_state)
+		return;
+
+	files = WMCreateArrayWithDestructor(64, wfree);
+
+	if (!wPreferences.flags.nodock) {
+		state = WMGetFromPLDictionary(scr->session_state, dDock);
+		if (state && WMIsPLDictionary(state))
+			collect_icon_files(get_saved_applications(scr, state), files);
+	}
+
+	if (!wPreferences.flags.noclip) {
+		key = WMCreatePLString("Workspaces");
+		list = WMGetFromPLDictionary(scr->session_state, key);
+		WMReleasePropList(key);
+
+		if (list && WMIsPLArray(list)) {
+			for (i = 0; i < WMGetPropListItemCount(list); i++) {
+				WMPropList *wks_state = WMGetFromPLArray(list, i);
+
+				if (!WMIsPLDictionary(wks_state))
+					continue;
+				state = WMGetFromPLDictionary(wks_state, dClip);
+				if (state && WMIsPLDictionary(state))
+					collect_icon_files(get_saved_applications(scr, state), files);
+			}
+		}
+	}
+
+	if (!wPreferences.flags.nodrawer) {
+		list = WMGetFromPLDictionary(scr->session_state, dDrawers);
+		if (list && WMIsPLArray(list)) {
+			for (i = 0; i < WMGetPropListItemCount(list); i++) {
+				WMPropList *drawer_state = WMGetFromPLArray(list, i);
+
+				if (!WMIsPLDictionary(drawer_state))
+					continue;
+				state = WMGetFromPLDictionary(drawer_state, dDock);
+				if (state && WMIsPLDictionary(state))
+					collect_icon_files(WMGetFromPLDictionary(state, dApplications), files);
+			}
+		}
+	}
+
+	wIconPrefetch(scr, files, wPreferences.icon_size);
+
+	WMFreeArray(files);
+}
+
 WDock *wDockRestoreState(WScreen *scr, WMPropList *dock_state, int type)
 {
 	WDock *dock;
@@ -2003,28 +2129,7 @@ WDock *wDockRestoreState(WScreen *scr, WMPropList *dock_state, int type)
 
 	/* application list */
 
-	{
-		WMPropList *tmp;
-		char buffer[64];
-
-		/*
-		 * When saving, it saves the dock state in
-		 * Applications and Applicationsnnn
-		 *
-		 * When loading, it will first try Applicationsnnn.
-		 * If it does not exist, use Applications as default.
-		 */
-
-		snprintf(buffer, sizeof(buffer), "Applications%i", scr->scr_height);
-
-		tmp = WMCreatePLString(buffer);
-		apps = WMGetFromPLDictionary(dock_state, tmp);
-		WMReleasePropList(tmp);
-
-		if (!apps)
-			apps = WMGetFromPLDictionary(dock_state, dApplications);
-	}
-
+	apps = get_saved_applications(scr, dock_state);
 	if (!apps)
 		goto finish;
 
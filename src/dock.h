@@ -66,6 +66,7 @@ typedef struct WDock {
 
 WDock *wDockCreate(WScreen *scr, int type, const char *name);
 WDock *wDockRestoreState(WScreen *scr, WMPropList *dock_state, int type);
+void wDockPrefetchIcons(WScreen *scr);
 
 void wDockDestroy(WDock *dock);
 void wDockHideIcons(WDock *dock);
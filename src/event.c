@@ -23,7 +23,6 @@
 #include "wconfig.h"
 
 #ifdef HAVE_INOTIFY
-#include <sys/select.h>
 #include <sys/inotify.h>
 #endif
 
@@ -49,6 +48,10 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
+
 #ifdef KEEP_XKB_LOCK_STATUS
 #include <X11/XKBlib.h>
 #endif				/* KEEP_XKB_LOCK_STATUS */
@@ -79,6 +82,10 @@
 #include "winmenu.h"
 #include "switchmenu.h"
 #include "wsmap.h"
+#include "trace.h"
+#include "minipreview.h"
+#include "session.h"
+#include "stats.h"
 
 
 #define MOD_MASK wPreferences.modifier_mask
@@ -103,7 +110,7 @@ static void handleKeyPress(XEvent *event);
 static void handleFocusIn(XEvent *event);
 static void handleMotionNotify(XEvent *event);
 static void handleVisibilityNotify(XEvent *event);
-static void handle_inotify_events(void);
+static void handle_inotify_events(int fd, int mask, void *data);
 static void handle_selection_request(XSelectionRequestEvent *event);
 static void handle_selection_clear(XSelectionClearEvent *event);
 static void wdelete_death_handler(WMagicNumber id);
@@ -200,6 +207,7 @@ void DispatchEvent(XEvent * event)
 		return;
 
 	saveTimestamp(event);
+	wTraceBeginArg("DispatchEvent", "type", event->type);
 	switch (event->type) {
 	case MapRequest:
 		handleMapRequest(event);
@@ -289,9 +297,22 @@ void DispatchEvent(XEvent * event)
 		handleExtensions(event);
 		break;
 	}
+	wTraceEnd("DispatchEvent");
 }
 
 #ifdef HAVE_INOTIFY
+static void close_inotify(void)
+{
+	if (w_global.inotify.handler) {
+		WMDeleteInputHandler(w_global.inotify.handler);
+		w_global.inotify.handler = NULL;
+	}
+	if (w_global.inotify.fd_event_queue >= 0) {
+		close(w_global.inotify.fd_event_queue);
+		w_global.inotify.fd_event_queue = -1;
+	}
+}
+
 /*
  *----------------------------------------------------------------------
  * handle_inotify_events-
@@ -305,7 +326,7 @@ void DispatchEvent(XEvent * event)
  * 	Calls wDefaultsCheckDomains if config database is updated
  *----------------------------------------------------------------------
  */
-static void handle_inotify_events(void)
+static void handle_inotify_events(int fd, int mask, void *data)
 {
 	ssize_t eventQLength;
 	size_t i = 0;
@@ -314,6 +335,11 @@ static void handle_inotify_events(void)
 	/* Check config only once per read of the event queue */
 	int oneShotFlag = 0;
 
+	/* Called by WINGs when there is something to read */
+	(void) fd;
+	(void) mask;
+	(void) data;
+
 	/*
 	 * Read off the queued events
 	 * queue overflow is not checked (IN_Q_OVERFLOW). In practise this should
@@ -325,7 +351,13 @@ static void handle_inotify_events(void)
 	                    buff, sizeof(buff) );
 
 	if (eventQLength < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
 		wwarning(_("read problem when trying to get INotify event: %s"), strerror(errno));
+		wwarning(_("The inotify instance will be closed."
+			   " Changes to the defaults database will require"
+			   " a restart to take effect."));
+		close_inotify();
 		return;
 	}
 
@@ -341,21 +373,16 @@ static void handle_inotify_events(void)
 			wwarning(_("the defaults database has been deleted!"
 				   " Restart Window Maker to create the database" " with the default settings"));
 
-			if (w_global.inotify.fd_event_queue >= 0) {
-				close(w_global.inotify.fd_event_queue);
-				w_global.inotify.fd_event_queue = -1;
-			}
+			close_inotify();
+			break;
 		}
 		if (pevent->mask & IN_UNMOUNT) {
 			wwarning(_("the unit containing the defaults database has"
 				   " been unmounted. Setting --static mode." " Any changes will not be saved."));
 
-			if (w_global.inotify.fd_event_queue >= 0) {
-				close(w_global.inotify.fd_event_queue);
-				w_global.inotify.fd_event_queue = -1;
-			}
-
+			close_inotify();
 			wPreferences.flags.noupdates = 1;
+			break;
 		}
 		if ((pevent->mask & IN_MODIFY) && oneShotFlag == 0) {
 			wwarning(_("Inotify: Reading config files in defaults database."));
@@ -369,6 +396,261 @@ static void handle_inotify_events(void)
 }
 #endif /* HAVE_INOTIFY */
 
+/*
+ * Events are handled by batches: when the loop wakes up, it looks at all
+ * the events already queued, and events that only update the state of a
+ * window (Expose, ConfigureNotify, PropertyNotify of an atom, MotionNotify)
+ * are merged with the later ones for the same window, so a client that
+ * changes its title 50 times in a row costs one redraw instead of 50.
+ *
+ * The events are left in the Xlib queue until they are dispatched, because
+ * some handlers take their next events from it themselves (when moving a
+ * window for example); what we know of the queue is checked against what we
+ * actually get, and the batch is abandoned as soon as it does not match.
+ */
+#define MAX_EVENT_BATCH		256
+
+typedef struct QueuedEvent {
+	XEvent event;
+	Bool merged;	/* already taken from the queue by coalesceEvent */
+} QueuedEvent;
+
+static struct {
+	XEvent *head;	/* first event of the queue, to notice when Xlib scans it again */
+	int count;
+	int next;
+	QueuedEvent events[MAX_EVENT_BATCH];
+} batch;
+
+static WEventStats event_stats;
+
+
+static Bool takeSnapshot(Display *dpy, XEvent *event, XPointer arg)
+{
+	(void) dpy;
+	(void) arg;
+
+	/* Xlib may restart from the beginning after reading the connection */
+	if (event == batch.head)
+		batch.count = 0;
+	if (batch.count == 0)
+		batch.head = event;
+
+	if (batch.count < MAX_EVENT_BATCH) {
+		batch.events[batch.count].event = *event;
+		batch.events[batch.count].merged = False;
+		batch.count++;
+	}
+
+	/* Nothing is taken from the queue */
+	return False;
+}
+
+static Bool isQueuedEvent(Display *dpy, XEvent *event, XPointer arg)
+{
+	(void) dpy;
+
+	return memcmp(event, arg, sizeof(XEvent)) == 0;
+}
+
+/* The window the event is about, which is not always the one it was sent to */
+static Window subjectWindow(XEvent *event)
+{
+	switch (event->type) {
+	case CreateNotify:
+		return event->xcreatewindow.window;
+	case DestroyNotify:
+		return event->xdestroywindow.window;
+	case MapNotify:
+		return event->xmap.window;
+	case UnmapNotify:
+		return event->xunmap.window;
+	case ReparentNotify:
+		return event->xreparent.window;
+	case ConfigureNotify:
+		return event->xconfigure.window;
+	case MapRequest:
+		return event->xmaprequest.window;
+	default:
+		return event->xany.window;
+	}
+}
+
+static Bool isSameTarget(XEvent *event, XEvent *other)
+{
+	if (event->type != other->type)
+		return False;
+
+	switch (event->type) {
+	case MotionNotify:
+		return other->xmotion.window == event->xmotion.window
+			&& other->xmotion.subwindow == event->xmotion.subwindow
+			&& other->xmotion.state == event->xmotion.state
+			&& other->xmotion.same_screen == event->xmotion.same_screen;
+	case Expose:
+		return other->xexpose.window == event->xexpose.window;
+	case ConfigureNotify:
+		return other->xconfigure.event == event->xconfigure.event
+			&& other->xconfigure.window == event->xconfigure.window;
+	case PropertyNotify:
+		return other->xproperty.window == event->xproperty.window
+			&& other->xproperty.atom == event->xproperty.atom;
+	default:
+		return False;
+	}
+}
+
+/* Whether 'other' must be handled between 'event' and a later event of the same kind */
+static Bool isBarrier(XEvent *event, XEvent *other)
+{
+	/* The pointer motion must stay in order with the buttons, keys and crossings */
+	if (event->type == MotionNotify)
+		return other->type != MotionNotify;
+
+	switch (other->type) {
+	case CreateNotify:
+	case DestroyNotify:
+	case MapNotify:
+	case UnmapNotify:
+	case ReparentNotify:
+	case MapRequest:
+		return subjectWindow(other) == subjectWindow(event);
+	default:
+		return False;
+	}
+}
+
+static void mergeEvent(XEvent *event, XEvent *later)
+{
+	if (event->type == Expose) {
+		int x1, y1, x2, y2;
+
+		/* Redraw the area of both, the count tells if more are coming */
+		x1 = WMIN(event->xexpose.x, later->xexpose.x);
+		y1 = WMIN(event->xexpose.y, later->xexpose.y);
+		x2 = WMAX(event->xexpose.x + event->xexpose.width, later->xexpose.x + later->xexpose.width);
+		y2 = WMAX(event->xexpose.y + event->xexpose.height, later->xexpose.y + later->xexpose.height);
+
+		*event = *later;
+		event->xexpose.x = x1;
+		event->xexpose.y = y1;
+		event->xexpose.width = x2 - x1;
+		event->xexpose.height = y2 - y1;
+	} else {
+		/* The last one tells the current state */
+		*event = *later;
+	}
+}
+
+/*
+ * Take out of the queue the events that can be merged into 'event', which is
+ * at position 'index' in the batch (-1 if it was already taken before)
+ */
+static void coalesceEvent(XEvent *event, int index)
+{
+	XEvent later;
+	int i;
+
+	switch (event->type) {
+	case MotionNotify:
+	case Expose:
+	case ConfigureNotify:
+	case PropertyNotify:
+		break;
+	default:
+		return;
+	}
+
+	for (i = index + 1; i < batch.count; i++) {
+		QueuedEvent *queued = &batch.events[i];
+
+		if (queued->merged)
+			continue;
+
+		if (isSameTarget(event, &queued->event)) {
+			/* It is known to be there, so this does not wait for anything */
+			if (!XCheckIfEvent(dpy, &later, isQueuedEvent, (XPointer) &queued->event)) {
+				batch.count = 0;
+				return;
+			}
+			queued->merged = True;
+			mergeEvent(event, &later);
+			event_stats.received++;
+			event_stats.coalesced++;
+		} else if (isBarrier(event, &queued->event)) {
+			break;
+		}
+	}
+}
+
+/*
+ * Get the next event of the batch, if it is still in the queue; 'index' is
+ * set to its position in the batch, or -1 if it is not the expected one
+ */
+static Bool nextBatchEvent(XEvent *event, int *index)
+{
+	while (batch.next < batch.count && batch.events[batch.next].merged)
+		batch.next++;
+
+	if (batch.next >= batch.count || XEventsQueued(dpy, QueuedAlready) == 0)
+		return False;
+
+	XNextEvent(dpy, event);
+	event_stats.received++;
+
+	if (memcmp(event, &batch.events[batch.next].event, sizeof(XEvent)) != 0) {
+		/* A handler took events from the queue itself, forget what we knew */
+		batch.count = 0;
+		*index = -1;
+	} else {
+		*index = batch.next++;
+	}
+
+	return True;
+}
+
+static void handleEventBatch(XEvent *event)
+{
+	XEvent dummy;
+	unsigned long received;
+	int index;
+
+	received = event_stats.received;
+	event_stats.received++;
+	event_stats.batches++;
+
+	/*
+	 * Look at everything that is queued, reading what the server already
+	 * sent; the predicate never accepts an event, it makes a copy of them
+	 */
+	batch.head = NULL;
+	batch.count = 0;
+	batch.next = 0;
+	XCheckIfEvent(dpy, &dummy, takeSnapshot, NULL);
+
+	index = -1;
+	do {
+		coalesceEvent(event, index);
+		WMHandleEvent(event);
+		event_stats.dispatched++;
+	} while (nextBatchEvent(event, &index));
+
+	batch.count = 0;
+
+	/* Once for all the changes made by the batch */
+	wNETWMFlushProperties();
+
+	if (event_stats.received - received > event_stats.largest_batch)
+		event_stats.largest_batch = event_stats.received - received;
+
+	wTraceCounter("EventsCoalesced", "count", event_stats.coalesced);
+}
+
+void wEventGetStats(WEventStats *stats)
+{
+	*stats = event_stats;
+}
+
 /*
  *----------------------------------------------------------------------
  * EventLoop-
@@ -379,47 +661,23 @@ static void handle_inotify_events(void)
  *
  * Side effects:
  * 	The LastTimestamp global variable is updated.
- *      Calls inotifyGetEvents if defaults database changes.
+ *      Installs the handler that reads the inotify events.
  *----------------------------------------------------------------------
  */
 noreturn void EventLoop(void)
 {
 	XEvent event;
-#ifdef HAVE_INOTIFY
-	struct timeval time;
-	fd_set rfds;
-	int retVal = 0;
 
-	if (w_global.inotify.fd_event_queue < 0 || w_global.inotify.wd_defaults < 0)
-		retVal = -1;
+#ifdef HAVE_INOTIFY
+	/* Read by WINGs while it waits for the X events, no need to check after each of them */
+	if (w_global.inotify.fd_event_queue >= 0 && w_global.inotify.wd_defaults >= 0)
+		w_global.inotify.handler = WMAddInputHandler(w_global.inotify.fd_event_queue, WIReadMask,
+							     handle_inotify_events, NULL);
 #endif
 
 	for (;;) {
-
 		WMNextEvent(dpy, &event);	/* Blocks here */
-		WMHandleEvent(&event);
-#ifdef HAVE_INOTIFY
-		if (retVal != -1) {
-			time.tv_sec = 0;
-			time.tv_usec = 0;
-			FD_ZERO(&rfds);
-			FD_SET(w_global.inotify.fd_event_queue, &rfds);
-
-			/* check for available read data from inotify - don't block! */
-			retVal = select(w_global.inotify.fd_event_queue + 1, &rfds, NULL, NULL, &time);
-
-			if (retVal < 0) {	/* an error has occurred */
-				wwarning(_("select failed. The inotify instance will be closed."
-					   " Changes to the defaults database will require"
-					   " a restart to take effect."));
-				close(w_global.inotify.fd_event_queue);
-				w_global.inotify.fd_event_queue = -1;
-				continue;
-			}
-			if (FD_ISSET(w_global.inotify.fd_event_queue, &rfds))
-				handle_inotify_events();
-		}
-#endif
+		handleEventBatch(&event);
 	}
 }
 
@@ -491,6 +749,7 @@ static void handleDeadProcess(void)
 
 	for (i = 0; i < deadProcessPtr; i++) {
 		wWindowDeleteSavedStatesForPID(deadProcesses[i].pid);
+		wSessionLaunchFinished(deadProcesses[i].pid);
 	}
 
 	if (!deathHandlers) {
@@ -585,6 +844,10 @@ static void handleExtensions(XEvent * event)
 		Restart(NULL,True);
 	}
 #endif
+#ifdef USE_XDAMAGE
+	if (w_global.xext.damage.supported && event->type == (w_global.xext.damage.event_base + XDamageNotify))
+		wMiniPreviewHandleDamage(event);
+#endif
 }
 
 static void handleMapRequest(XEvent * ev)
@@ -710,10 +973,8 @@ static void handleDestroyNotify(XEvent * event)
 static void handleExpose(XEvent * event)
 {
 	WObjDescriptor *desc;
-	XEvent ev;
-
-	while (XCheckTypedWindowEvent(dpy, event->xexpose.window, Expose, &ev)) ;
 
+	/* The Expose already queued for the window were merged by handleEventBatch */
 	if (XFindContext(dpy, event->xexpose.window, w_global.context.client_win, (XPointer *) & desc) == XCNOENT) {
 		return;
 	}
@@ -1025,6 +1286,8 @@ static void handleClientMessage(XEvent * event)
 		if (strncmp(command, "Reconfigure", sizeof("Reconfigure")) == 0) {
 			wwarning(_("Got Reconfigure command"));
 			wDefaultsCheckDomains(NULL);
+		} else if (strncmp(command, "DumpStats", sizeof("DumpStats")) == 0) {
+			wStatsDump();
 		} else {
 			wwarning(_("Got unknown command %s"), command);
 		}
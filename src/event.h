@@ -30,7 +30,19 @@
 
 typedef void (WDeathHandler)(pid_t pid, unsigned int status, void *cdata);
 
+/*
+ * Counters of the work done by EventLoop
+ */
+typedef struct WEventStats {
+	unsigned long received;		/* events taken from the X queue */
+	unsigned long dispatched;	/* events given to the handlers */
+	unsigned long coalesced;	/* events merged with one for the same window */
+	unsigned long batches;		/* times the loop woke up */
+	unsigned long largest_batch;	/* most events received in one wake up */
+} WEventStats;
+
 noreturn void EventLoop(void);
+void wEventGetStats(WEventStats *stats);
 void DispatchEvent(XEvent *event);
 void ProcessPendingEvents(void);
 WMagicNumber wAddDeathHandler(pid_t pid, WDeathHandler *callback, void *cdata);
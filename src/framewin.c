@@ -42,6 +42,7 @@
 #include "stacking.h"
 #include "misc.h"
 #include "event.h"
+#include "trace.h"
 
 
 static void handleExpose(WObjDescriptor * desc, XEvent * event);
@@ -925,6 +926,8 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 	WScreen *scr = fwin->screen_ptr;
 	int state;
 
+	wTraceBegin("wFrameWindowPaint");
+
 	state = fwin->flags.state;
 
 	if (fwin->flags.is_client_window_frame)
@@ -1099,6 +1102,8 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 			handleButtonExpose(&fwin->language_button->descriptor, NULL);
 #endif
 	}
+
+	wTraceEnd("wFrameWindowPaint");
 }
 
 static void reconfigure(WFrameWindow * fwin, int x, int y, int width, int height, Bool dontMove)
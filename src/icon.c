@@ -47,12 +47,12 @@
 #include "startup.h"
 #include "event.h"
 #include "winmenu.h"
+#include "stats.h"
 
 /**** Global varianebles ****/
 
 #define MOD_MASK wPreferences.modifier_mask
 #define CACHE_ICON_PATH "/" PACKAGE_TARNAME "/CachedPixmaps"
-#define ICON_BORDER 3
 
 static void miniwindowExpose(WObjDescriptor *desc, XEvent *event);
 static void miniwindowMouseDown(WObjDescriptor *desc, XEvent *event);
@@ -172,6 +172,7 @@ static WIcon *icon_create_core(WScreen *scr, int coord_x, int coord_y)
 	WIcon *icon;
 
 	icon = wmalloc(sizeof(WIcon));
+	wStatsCreated(WSTATS_ICONS);
 	icon->core = wCoreCreateTopLevel(scr,
 					 coord_x,
 					 coord_y,
@@ -231,6 +232,7 @@ void wIconDestroy(WIcon *icon)
 	unset_icon_image(icon);
 
 	wCoreDestroy(icon->core);
+	wStatsFreed(WSTATS_ICONS);
 	wfree(icon);
 }
 
@@ -624,10 +626,13 @@ void set_icon_minipreview(WIcon *icon, RImage *image)
 	Pixmap tmp;
 	RImage *scaled_mini_preview;
 	WScreen *scr = icon->core->screen_ptr;
+	int size = wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER;
 
-		scaled_mini_preview = RSmoothScaleImageToFit(image,
-			wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
-			wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER, True);
+	/* The image may already be prepared at the right size */
+	if ((image->width == size && image->height <= size) || (image->height == size && image->width <= size))
+		scaled_mini_preview = RRetainImage(image);
+	else
+		scaled_mini_preview = RSmoothScaleImageToFit(image, size, size, True);
 
 	if (RConvertImage(scr->rcontext, scaled_mini_preview, &tmp)) {
 		if (icon->mini_preview != None)
@@ -32,6 +32,9 @@
 /* This is the border, in pixel, drawn around a Mini-Preview */
 #define MINIPREVIEW_BORDER 1
 
+/* Room kept around the image inside an icon of wPreferences.icon_size */
+#define ICON_BORDER 3
+
 typedef struct WIcon {
 	WCoreWindow 	*core;
 	WWindow 	*owner;		/* owner window */
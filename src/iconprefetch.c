@@ -0,0 +1,242 @@
+/* iconprefetch.c - decode icon images in parallel at startup
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <X11/Xlib.h>
+#include <wraster.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "icon.h"
+#include "iconprefetch.h"
+
+
+/* No need for more, the disk becomes the limit */
+#define MAX_PREFETCH_THREADS	8
+
+typedef struct PrefetchedIcon {
+	RImage *image;
+	int max_size;
+} PrefetchedIcon;
+
+/* file name -> PrefetchedIcon */
+static WMHashTable *prefetched = NULL;
+
+
+#ifdef HAVE_PTHREAD
+
+typedef struct PrefetchJob {
+	RContext *rcontext;
+	int max_size;
+
+	char **files;
+	RImage **images;
+	int count;
+
+	pthread_mutex_t lock;
+	int next;
+} PrefetchJob;
+
+/*
+ * The workers only use the part of wrlib that does not talk to the X server,
+ * the conversion to a Pixmap is done later by the main thread when the icon
+ * is created
+ */
+static RImage *decode_icon(RContext *rcontext, const char *file, int max_size)
+{
+	const char *format;
+	RImage *image;
+	int target_size;
+
+	/*
+	 * The XPM loader allocates colors on the X server, and formats wrlib
+	 * does not know about may be handled by an external library we know
+	 * nothing about; leave them to the main thread
+	 */
+	format = RGetImageFileFormat(file);
+	if (!format || strcmp(format, "XPM") == 0)
+		return NULL;
+
+	target_size = max_size - ICON_BORDER;
+	if (target_size <= 0)
+		target_size = 1;
+
+	image = RLoadImageScaled(rcontext, file, 0, target_size, target_size);
+
+	return wIconValidateIconSize(image, max_size);
+}
+
+static void *prefetch_worker(void *arg)
+{
+	PrefetchJob *job = arg;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&job->lock);
+		i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+
+		if (i >= job->count)
+			break;
+
+		job->images[i] = decode_icon(job->rcontext, job->files[i], job->max_size);
+	}
+
+	return NULL;
+}
+
+static int get_thread_count(int count)
+{
+	long n;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	n = 1;
+#endif
+	if (n > MAX_PREFETCH_THREADS)
+		n = MAX_PREFETCH_THREADS;
+	if (n > count)
+		n = count;
+	if (n < 1)
+		n = 1;
+
+	return n;
+}
+
+void wIconPrefetch(WScreen *scr, WMArray *files, int max_size)
+{
+	PrefetchJob job;
+	pthread_t tid[MAX_PREFETCH_THREADS];
+	int started[MAX_PREFETCH_THREADS];
+	int nthreads, i, n;
+
+	n = WMGetArrayItemCount(files);
+	if (n == 0)
+		return;
+
+	if (!prefetched)
+		prefetched = WMCreateHashTable(WMStringHashCallbacks);
+
+	job.rcontext = scr->rcontext;
+	job.max_size = max_size;
+	job.files = wmalloc(n * sizeof(char *));
+	job.images = wmalloc(n * sizeof(RImage *));
+	job.count = 0;
+	job.next = 0;
+	pthread_mutex_init(&job.lock, NULL);
+
+	/* The same icon is often used by many entries, only decode it once */
+	for (i = 0; i < n; i++) {
+		char *file = WMGetFromArray(files, i);
+		int j;
+
+		if (WMHashGet(prefetched, file))
+			continue;
+		for (j = 0; j < job.count; j++)
+			if (strcmp(job.files[j], file) == 0)
+				break;
+		if (j == job.count)
+			job.files[job.count++] = file;
+	}
+
+	/* The calling thread works too, so it does not just sit waiting */
+	nthreads = get_thread_count(job.count);
+	for (i = 1; i < nthreads; i++)
+		started[i] = (pthread_create(&tid[i], NULL, prefetch_worker, &job) == 0);
+
+	prefetch_worker(&job);
+
+	for (i = 1; i < nthreads; i++)
+		if (started[i])
+			pthread_join(tid[i], NULL);
+
+	pthread_mutex_destroy(&job.lock);
+
+	for (i = 0; i < job.count; i++) {
+		PrefetchedIcon *entry;
+
+		if (!job.images[i])
+			continue;
+
+		entry = wmalloc(sizeof(PrefetchedIcon));
+		entry->image = job.images[i];
+		entry->max_size = max_size;
+		WMHashInsert(prefetched, job.files[i], entry);
+	}
+
+	wfree(job.files);
+	wfree(job.images);
+}
+
+#else /* HAVE_PTHREAD */
+
+void wIconPrefetch(WScreen *scr, WMArray *files, int max_size)
+{
+	/* Decoding them in advance one by one would not gain anything */
+	(void) scr;
+	(void) files;
+	(void) max_size;
+}
+
+#endif /* HAVE_PTHREAD */
+
+RImage *wIconPrefetchGet(const char *file, int max_size)
+{
+	PrefetchedIcon *entry;
+
+	if (!prefetched)
+		return NULL;
+
+	entry = WMHashGet(prefetched, file);
+	if (!entry || entry->max_size != max_size)
+		return NULL;
+
+	/* The caller may modify the image, and the same file can be used again */
+	return RCloneImage(entry->image);
+}
+
+void wIconPrefetchRelease(void)
+{
+	WMHashEnumerator enumerator;
+	PrefetchedIcon *entry;
+
+	if (!prefetched)
+		return;
+
+	enumerator = WMEnumerateHashTable(prefetched);
+	while ((entry = WMNextHashEnumeratorItem(&enumerator)) != NULL) {
+		RReleaseImage(entry->image);
+		wfree(entry);
+	}
+
+	WMFreeHashTable(prefetched);
+	prefetched = NULL;
+}
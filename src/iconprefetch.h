@@ -0,0 +1,37 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMICONPREFETCH_H_
+#define WMICONPREFETCH_H_
+
+/*
+ * Decode the image files in 'files' (an array of char *) in parallel, and
+ * keep them ready for get_rimage_from_file until wIconPrefetchRelease()
+ */
+void wIconPrefetch(WScreen *scr, WMArray *files, int max_size);
+
+/*
+ * Return a copy of the image prefetched for 'file', or NULL if there is none
+ */
+RImage *wIconPrefetchGet(const char *file, int max_size);
+
+void wIconPrefetchRelease(void);
+
+#endif
@@ -57,6 +57,8 @@
 #include "main.h"
 #include "monitor.h"
 #include "misc.h"
+#include "trace.h"
+#include "stats.h"
 
 #include <WINGs/WUtil.h>
 
@@ -223,6 +225,8 @@ void Restart(char *manager, Bool abortOnFailure)
 		XCloseDisplay(dpy);
 		dpy = NULL;
 	}
+	/* atexit handlers are not run by exec */
+	wTraceClose();
 	if (!prog) {
 		execvp(Arguments[0], Arguments);
 		wfatal(_("failed to restart Window Maker."));
@@ -454,6 +458,8 @@ static void print_help(void)
 
 	puts(_(" --visual-id visualid	visual id of visual to use"));
 	puts(_(" --static		do not update or save configurations"));
+	puts(_(" --trace file		write startup and event timings to file"));
+	puts(_(" --dump-stats		make the running Window Maker write its object counters"));
 #ifndef HAVE_INOTIFY
 	puts(_(" --no-polling		do not periodically check for configuration updates"));
 #endif
@@ -615,6 +621,8 @@ static int real_main(int argc, char **argv)
 {
 	int i;
 	char *pos;
+	char *trace_file = NULL;
+	Bool dump_stats = False;
 	int d, s;
 
 	setlocale(LC_ALL, "");
@@ -696,6 +704,15 @@ static int real_main(int argc, char **argv)
 				}
 			} else if (strcmp(argv[i], "-static") == 0 || strcmp(argv[i], "--static") == 0) {
 				wPreferences.flags.noupdates = 1;
+			} else if (strcmp(argv[i], "--trace") == 0) {
+				i++;
+				if (i >= argc) {
+					wwarning(_("too few arguments for %s"), argv[i - 1]);
+					exit(0);
+				}
+				trace_file = argv[i];
+			} else if (strcmp(argv[i], "--dump-stats") == 0) {
+				dump_stats = True;
 			} else if (strcmp(argv[i], "--no-polling") == 0) {
 #ifndef HAVE_INOTIFY
 				wPreferences.flags.noupdates = 1;
@@ -713,6 +730,14 @@ static int real_main(int argc, char **argv)
 		}
 	}
 
+	/* Only once the whole command line is read, for the -display option */
+	if (dump_stats)
+		exit(wStatsRequestDump(DisplayName) ? 0 : 1);
+
+	if (!trace_file)
+		trace_file = getenv("WMAKER_TRACE");
+	wTraceOpen(trace_file);
+
 	if (!wPreferences.flags.noupdates) {
 		/* check existence of Defaults DB directory */
 		check_defaults();
@@ -805,7 +830,9 @@ static int real_main(int argc, char **argv)
 	setenv("DISPLAY", DisplayName, 1);
 
 	wXModifierInitialize();
+	wTraceBegin("StartUp");
 	StartUp(!multiHead);
+	wTraceEnd("StartUp");
 
 	if (w_global.screen_count == 1)
 		multiHead = False;
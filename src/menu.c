@@ -44,6 +44,7 @@
 #include "dialog.h"
 #include "rootmenu.h"
 #include "switchmenu.h"
+#include "stats.h"
 
 
 #define MOD_MASK wPreferences.modifier_mask
@@ -77,6 +78,8 @@ static int saveMenuRecurs(WMPropList * menus, WScreen * scr, WMenu * menu);
 static int restoreMenuRecurs(WScreen *scr, WMPropList *menus, WMenu *menu, const char *path);
 static void selectEntry(WMenu * menu, int entry_no);
 static void closeCascade(WMenu * menu);
+static void renderEntries(WMenu *menu);
+static void releaseEntries(WMenu *menu);
 
 /****** Notification Observers ******/
 
@@ -97,7 +100,8 @@ static void appearanceObserver(void *self, WMNotification * notif)
 			if (!menu->flags.brother)
 				updateTexture(menu);
 		}
-		if (flags & (WTextureSettings | WColorSettings)) {
+		/* The original menu paints its brother too */
+		if ((flags & (WTextureSettings | WColorSettings)) && !menu->flags.brother) {
 			wMenuPaint(menu);
 		}
 	} else if (menu->flags.titled) {
@@ -136,6 +140,7 @@ WMenu *wMenuCreate(WScreen *screen, const char *title, int main_menu)
 	int tmp, flags;
 
 	menu = wmalloc(sizeof(WMenu));
+	wStatsCreated(WSTATS_MENUS);
 
 #ifdef SINGLE_MENULEVEL
 	tmp = WMSubmenuLevel;
@@ -533,10 +538,9 @@ void wMenuRealize(WMenu * menu)
 
 	menu->flags.realized = 1;
 
-	if (menu->flags.mapped)
+	/* The entries were rendered over the previous texture and size */
+	if (!brother_done)
 		wMenuPaint(menu);
-	if (menu->brother->flags.mapped)
-		wMenuPaint(menu->brother);
 }
 
 void wMenuDestroy(WMenu * menu, int recurse)
@@ -594,6 +598,7 @@ void wMenuDestroy(WMenu * menu, int recurse)
 	}
 
 	FREE_PIXMAP(menu->menu_texture_data);
+	FREE_PIXMAP(menu->entries_pixmap);
 
 	if (menu->cascades)
 		wfree(menu->cascades);
@@ -605,6 +610,7 @@ void wMenuDestroy(WMenu * menu, int recurse)
 	if (!menu->flags.brother && menu->brother)
 		wMenuDestroy(menu->brother, False);
 
+	wStatsFreed(WSTATS_MENUS);
 	wfree(menu);
 }
 
@@ -650,18 +656,19 @@ static void drawFrame(WScreen * scr, Drawable win, int y, int w, int h, int type
 		XDrawLine(dpy, win, scr->menu_item_auxtexture->dark_gc, 0, y + h - 1, w - 1, y + h - 1);
 }
 
-static void paintEntry(WMenu * menu, int index, int selected)
+/*
+ * Draw an entry over its background, which is expected to be in place
+ * already unless it is selected
+ */
+static void drawEntry(WMenu *menu, Drawable win, int index, int selected)
 {
 	WScreen *scr = menu->frame->screen_ptr;
-	Window win = menu->menu->window;
 	WMenuEntry *entry = menu->entries[index];
 	GC light, dim, dark;
 	WMColor *color;
 	int x, y, w, h, tw;
 	int type;
 
-	if (!menu->flags.realized)
-		return;
 	h = menu->entry_height;
 	w = menu->menu->width;
 	y = index * h;
@@ -682,19 +689,10 @@ static void paintEntry(WMenu * menu, int index, int selected)
 	}
 
 	/* paint background */
-	if (selected) {
+	if (selected)
 		XFillRectangle(dpy, win, WMColorGC(scr->select_color), 1, y + 1, w - 2, h - 3);
-		if (scr->menu_item_texture->any.type == WTEX_SOLID)
-			drawFrame(scr, win, y, w, h, type);
-	} else {
-		if (scr->menu_item_texture->any.type == WTEX_SOLID) {
-			XClearArea(dpy, win, 0, y + 1, w - 1, h - 3, False);
-			/* draw the frame */
-			drawFrame(scr, win, y, w, h, type);
-		} else {
-			XClearArea(dpy, win, 0, y, w, h, False);
-		}
-	}
+	if (scr->menu_item_texture->any.type == WTEX_SOLID)
+		drawFrame(scr, win, y, w, h, type);
 
 	if (selected) {
 		if (entry->flags.enabled)
@@ -820,6 +818,120 @@ static void paintEntry(WMenu * menu, int index, int selected)
 	}
 }
 
+/*
+ * Paint the background of the entries from 'y' to 'y + h', the same way the
+ * window background does
+ */
+static void drawBackground(WMenu *menu, Drawable d, int y, int h)
+{
+	WScreen *scr = menu->frame->screen_ptr;
+	WTexture *texture = scr->menu_item_texture;
+	Pixmap tile;
+	int w, i;
+
+	w = menu->menu->width;
+	/* The brother menu uses the texture rendered for the original */
+	tile = menu->flags.brother ? menu->brother->menu_texture_data : menu->menu_texture_data;
+
+	if (texture->any.type == WTEX_SOLID || tile == None) {
+		XFillRectangle(dpy, d, texture->any.gc, 0, y, w, h);
+	} else if (wPreferences.menu_style == MS_NORMAL) {
+		/* rendered for a single entry, and tiled */
+		for (i = y; i < y + h; i += menu->entry_height)
+			XCopyArea(dpy, tile, d, texture->any.gc, 0, 0, w, menu->entry_height, 0, i);
+	} else {
+		XCopyArea(dpy, tile, d, texture->any.gc, 0, y, w, h, 0, y);
+	}
+}
+
+/*
+ * Render all the entries, unselected, in a pixmap that becomes the background
+ * of the menu window: the X server then restores the exposed parts and the
+ * entries that get unselected by itself, without us drawing them again
+ */
+static void renderEntries(WMenu *menu)
+{
+	WScreen *scr = menu->frame->screen_ptr;
+	int w, h, i;
+
+	if (!menu->flags.realized)
+		return;
+
+	w = menu->menu->width;
+	h = menu->menu->height;
+	if (w <= 0 || h <= 0 || menu->entry_no == 0) {
+		releaseEntries(menu);
+		return;
+	}
+
+	/* The size may have changed, and a new one does not cost a round trip */
+	FREE_PIXMAP(menu->entries_pixmap);
+	menu->entries_pixmap = XCreatePixmap(dpy, scr->w_win, w, h, scr->w_depth);
+
+	drawBackground(menu, menu->entries_pixmap, 0, h);
+	for (i = 0; i < menu->entry_no; i++)
+		drawEntry(menu, menu->entries_pixmap, i, False);
+
+	/* The server may have kept a copy of the previous content */
+	XSetWindowBackgroundPixmap(dpy, menu->menu->window, menu->entries_pixmap);
+}
+
+/* Render again a single entry in the background of the window */
+static void renderEntry(WMenu *menu, int index)
+{
+	if (menu->entries_pixmap == None)
+		return;
+
+	drawBackground(menu, menu->entries_pixmap, index * menu->entry_height, menu->entry_height);
+	drawEntry(menu, menu->entries_pixmap, index, False);
+
+	XSetWindowBackgroundPixmap(dpy, menu->menu->window, menu->entries_pixmap);
+}
+
+static void releaseEntries(WMenu *menu)
+{
+	WScreen *scr = menu->frame->screen_ptr;
+	Pixmap tile;
+
+	if (menu->entries_pixmap == None)
+		return;
+
+	tile = menu->flags.brother ? menu->brother->menu_texture_data : menu->menu_texture_data;
+	if (scr->menu_item_texture->any.type != WTEX_SOLID && tile != None)
+		XSetWindowBackgroundPixmap(dpy, menu->menu->window, tile);
+	else
+		XSetWindowBackground(dpy, menu->menu->window, scr->menu_item_texture->any.color.pixel);
+
+	FREE_PIXMAP(menu->entries_pixmap);
+}
+
+static void paintEntry(WMenu *menu, int index, int selected)
+{
+	WScreen *scr = menu->frame->screen_ptr;
+	Window win = menu->menu->window;
+	int y, w, h;
+
+	if (!menu->flags.realized)
+		return;
+	h = menu->entry_height;
+	w = menu->menu->width;
+	y = index * h;
+
+	if (!selected) {
+		if (menu->entries_pixmap != None) {
+			XClearArea(dpy, win, 0, y, w, h, False);
+			return;
+		}
+
+		if (scr->menu_item_texture->any.type == WTEX_SOLID)
+			XClearArea(dpy, win, 0, y + 1, w - 1, h - 3, False);
+		else
+			XClearArea(dpy, win, 0, y, w, h, False);
+	}
+
+	drawEntry(menu, win, index, selected);
+}
+
 static void move_menus(WMenu * menu, int x, int y)
 {
 	while (menu->parent) {
@@ -1116,6 +1228,7 @@ void wMenuMapAt(WMenu * menu, int x, int y, int keyboard)
 		XMoveWindow(dpy, menu->frame->core->window, x, y);
 		menu->frame_x = x;
 		menu->frame_y = y;
+		renderEntries(menu);
 		XMapWindow(dpy, menu->frame->core->window);
 		wRaiseFrame(menu->frame->core);
 		menu->flags.mapped = 1;
@@ -1138,6 +1251,7 @@ void wMenuMap(WMenu * menu)
 		menu->frame_y = menu->frame->screen_ptr->app_menu_y;
 		XMoveWindow(dpy, menu->frame->core->window, menu->frame_x, menu->frame_y);
 	}
+	renderEntries(menu);
 	XMapWindow(dpy, menu->frame->core->window);
 	wRaiseFrame(menu->frame->core);
 	menu->flags.mapped = 1;
@@ -1148,6 +1262,7 @@ void wMenuUnmap(WMenu * menu)
 	int i;
 
 	XUnmapWindow(dpy, menu->frame->core->window);
+	releaseEntries(menu);
 	if (menu->flags.titled && menu->flags.buttoned) {
 		wFrameWindowHideButton(menu->frame, WFF_RIGHT_BUTTON);
 	}
@@ -1171,7 +1286,7 @@ void wMenuUnmap(WMenu * menu)
 	menu->selected_entry = -1;
 }
 
-void wMenuPaint(WMenu * menu)
+static void paintMenu(WMenu *menu)
 {
 	int i;
 
@@ -1179,17 +1294,35 @@ void wMenuPaint(WMenu * menu)
 		return;
 	}
 
+	/* The content may have changed, render the entries again */
+	renderEntries(menu);
+	if (menu->entries_pixmap != None) {
+		XClearWindow(dpy, menu->menu->window);
+		if (menu->selected_entry >= 0)
+			paintEntry(menu, menu->selected_entry, True);
+		return;
+	}
+
 	/* paint entries */
 	for (i = 0; i < menu->entry_no; i++) {
 		paintEntry(menu, i, i == menu->selected_entry);
 	}
 }
 
+void wMenuPaint(WMenu * menu)
+{
+	/* The torn off copy shows the same entries */
+	paintMenu(menu);
+	paintMenu(menu->brother);
+}
+
 void wMenuSetEnabled(WMenu * menu, int index, int enable)
 {
 	if (index >= menu->entry_no)
 		return;
 	menu->entries[index]->flags.enabled = enable;
+	renderEntry(menu, index);
+	renderEntry(menu->brother, index);
 	paintEntry(menu, index, index == menu->selected_entry);
 	paintEntry(menu->brother, index, index == menu->selected_entry);
 }
@@ -1715,10 +1848,21 @@ void wMenuScroll(WMenu *menu)
 
 static void menuExpose(WObjDescriptor * desc, XEvent * event)
 {
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
+	WMenu *menu = desc->parent;
+	int y, h;
 
-	wMenuPaint(desc->parent);
+	if (menu->entries_pixmap == None) {
+		paintMenu(menu);
+		return;
+	}
+
+	/* The server restored the rest from the background */
+	if (menu->selected_entry < 0)
+		return;
+	h = menu->entry_height;
+	y = menu->selected_entry * h;
+	if (event->xexpose.y < y + h && event->xexpose.y + event->xexpose.height > y)
+		paintEntry(menu, menu->selected_entry, True);
 }
 
 typedef struct {
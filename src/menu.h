@@ -74,6 +74,9 @@ typedef struct WMenu {
 	struct WFrameWindow *frame;
 	WCoreWindow *menu;		       /* the window menu */
 	Pixmap menu_texture_data;
+	Pixmap entries_pixmap;		       /* all the entries, unselected;
+						* the background of the window
+						* while it is mapped */
 	int frame_x, frame_y;	       /* position of the frame in root*/
 
 	WMenuEntry **entries;	       /* array of entries. This is shared
@@ -0,0 +1,273 @@
+/* minipreview.c - content of the windows shown in the balloon of their miniwindow
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdio.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
+
+#include <wraster.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "framewin.h"
+#include "window.h"
+#include "icon.h"
+#include "worker.h"
+#include "minipreview.h"
+
+
+#ifdef USE_XDAMAGE
+/*
+ * Minimum delay between two captures of a window that keeps being drawn in,
+ * to keep its preview up to date (in milliseconds)
+ */
+#define PREVIEW_REFRESH_DELAY	2000
+#endif
+
+/*
+ * The content of the window is read from the server in the main thread, as
+ * it has to be done before the window is unmapped, but the conversion and the
+ * scaling are done by the worker thread
+ */
+typedef struct PreviewJob {
+	RContext *rcontext;
+	Window client_win;
+	RXImage *ximage;
+	int size;
+
+	RImage *preview;
+} PreviewJob;
+
+
+static void setPreview(WWindow *wwin, RImage *preview)
+{
+	if (wwin->preview.image)
+		RReleaseImage(wwin->preview.image);
+	wwin->preview.image = RRetainImage(preview);
+
+	if (wwin->icon)
+		set_icon_minipreview(wwin->icon, preview);
+}
+
+/* Called in the worker thread */
+static void scalePreview(void *data)
+{
+	PreviewJob *job = data;
+	RImage *image;
+
+	image = RCreateImageFromXImage(job->rcontext, job->ximage->image, NULL);
+	if (!image)
+		return;
+
+	job->preview = RSmoothScaleImageToFit(image, job->size, job->size, True);
+	RReleaseImage(image);
+}
+
+static void finishPreview(void *data)
+{
+	PreviewJob *job = data;
+	WWindow *wwin;
+
+	RDestroyXImage(job->rcontext, job->ximage);
+
+	/* The window may have been closed in the meantime */
+	wwin = wWindowFor(job->client_win);
+	if (wwin && wwin->client_win == job->client_win) {
+		wwin->preview.pending = False;
+
+		if (job->preview) {
+			setPreview(wwin, job->preview);
+		} else {
+			const char *title;
+			char title_buf[32];
+
+			/* Keep trying next time */
+			wwin->preview.outdated = True;
+
+			if (wwin->frame->title) {
+				title = wwin->frame->title;
+			} else {
+				snprintf(title_buf, sizeof(title_buf), "(id=0x%lx)", wwin->client_win);
+				title = title_buf;
+			}
+			wwarning(_("creation of mini-preview failed for window \"%s\""), title);
+		}
+	}
+
+	if (job->preview)
+		RReleaseImage(job->preview);
+	wfree(job);
+}
+
+/*
+ * Read the visible part of the window; this goes through shared memory when
+ * the server supports it
+ */
+static Bool capturePreview(WWindow *wwin)
+{
+	WScreen *scr = wwin->screen_ptr;
+	XWindowAttributes attribs;
+	PreviewJob *job;
+	RXImage *ximage;
+	unsigned int w, h;
+	int x, y;
+	Window baz;
+
+	if (wwin->preview.pending)
+		return True;
+
+	if (!XGetWindowAttributes(dpy, wwin->client_win, &attribs))
+		return False;
+
+#ifdef USE_XDAMAGE
+	/*
+	 * Get the next notification once the window is drawn in again; this is
+	 * done before reading it, so a change made meanwhile is not missed
+	 */
+	if (wwin->preview.damage != None)
+		XDamageSubtract(dpy, wwin->preview.damage, None, None);
+#endif
+	wwin->preview.outdated = False;
+
+	XTranslateCoordinates(dpy, wwin->client_win, scr->root_win, 0, 0, &x, &y, &baz);
+
+	w = attribs.width;
+	h = attribs.height;
+
+	if (x - attribs.x + attribs.width > scr->scr_width)
+		w = scr->scr_width - x + attribs.x;
+
+	if (y - attribs.y + attribs.height > scr->scr_height)
+		h = scr->scr_height - y + attribs.y;
+
+	ximage = RGetXImage(scr->rcontext, wwin->client_win, 0, 0, w, h);
+	if (!ximage) {
+		wwin->preview.outdated = True;
+		return False;
+	}
+
+	job = wmalloc(sizeof(PreviewJob));
+	job->rcontext = scr->rcontext;
+	job->client_win = wwin->client_win;
+	job->ximage = ximage;
+	job->size = wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER;
+
+	wwin->preview.pending = True;
+	wWorkerRun(scalePreview, finishPreview, job);
+
+	return True;
+}
+
+#ifdef USE_XDAMAGE
+
+static void refreshPreview(void *data)
+{
+	WWindow *wwin = data;
+
+	wwin->preview.timer = NULL;
+
+	/*
+	 * Only the focused window is likely to be fully visible; for the others,
+	 * what is read from the parts covered by other windows is undefined
+	 */
+	if (!wwin->flags.mapped || wwin->flags.miniaturized || !wwin->flags.focused)
+		return;
+
+	capturePreview(wwin);
+}
+
+static void trackDamage(WWindow *wwin)
+{
+	if (wwin->preview.damage != None || !w_global.xext.damage.supported || !wPreferences.miniwin_preview_balloon)
+		return;
+
+	wwin->preview.damage = XDamageCreate(dpy, wwin->client_win, XDamageReportNonEmpty);
+}
+
+void wMiniPreviewHandleDamage(XEvent *event)
+{
+	XDamageNotifyEvent *ev = (XDamageNotifyEvent *) event;
+	WWindow *wwin;
+
+	/* Events may still arrive for the window after we forgot it */
+	wwin = wWindowFor(ev->drawable);
+	if (!wwin || wwin->preview.damage != ev->damage)
+		return;
+
+	wwin->preview.outdated = True;
+
+	/* The damage is not subtracted until the next capture, so we get no more events until then */
+	if (!wwin->preview.timer)
+		wwin->preview.timer = WMAddTimerHandler(PREVIEW_REFRESH_DELAY, refreshPreview, wwin);
+}
+
+#endif /* USE_XDAMAGE */
+
+void wMiniPreviewUpdate(WWindow *wwin)
+{
+	if (!wwin->icon)
+		return;
+
+	/*
+	 * When the window was not drawn in since the last capture, there is no
+	 * need to read it again; this is only known when we are told about it
+	 */
+#ifdef USE_XDAMAGE
+	if (wwin->preview.damage != None && wwin->preview.image && !wwin->preview.outdated) {
+		set_icon_minipreview(wwin->icon, wwin->preview.image);
+		return;
+	}
+#endif
+
+#ifdef USE_XDAMAGE
+	/* Keep the preview up to date for the next time */
+	trackDamage(wwin);
+#endif
+
+	capturePreview(wwin);
+}
+
+void wMiniPreviewForget(WWindow *wwin, Bool destroyed)
+{
+#ifdef USE_XDAMAGE
+	if (wwin->preview.timer) {
+		WMDeleteTimerHandler(wwin->preview.timer);
+		wwin->preview.timer = NULL;
+	}
+	/* The server already released it with the window */
+	if (wwin->preview.damage != None && !destroyed)
+		XDamageDestroy(dpy, wwin->preview.damage);
+	wwin->preview.damage = None;
+#else
+	(void) destroyed;
+#endif
+
+	if (wwin->preview.image) {
+		RReleaseImage(wwin->preview.image);
+		wwin->preview.image = NULL;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMMINIPREVIEW_H_
+#define WMMINIPREVIEW_H_
+
+/*
+ * Give the miniwindow of 'wwin' a preview of its content, to be called while
+ * the window is still mapped; the preview is scaled in the background and
+ * set on the icon when ready
+ */
+void wMiniPreviewUpdate(WWindow *wwin);
+
+/*
+ * Release what is kept for the window, 'destroyed' tells if the client window
+ * does not exist anymore
+ */
+void wMiniPreviewForget(WWindow *wwin, Bool destroyed);
+
+#ifdef USE_XDAMAGE
+void wMiniPreviewHandleDamage(XEvent *event);
+#endif
+
+#endif
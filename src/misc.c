@@ -55,6 +55,7 @@
 #include "main.h"
 #include "event.h"
 #include "shutdown.h"
+#include "persist.h"
 
 
 #define ICON_SIZE wPreferences.icon_size
@@ -1209,7 +1210,7 @@ Bool UpdateDomainFile(WDDomain * domain)
 	struct stat stbuf;
 	char path[PATH_MAX];
 	WMPropList *shared_dict, *dict;
-	Bool result, freeDict = False;
+	Bool freeDict = False;
 
 	dict = domain->dictionary;
 	if (WMIsPLDictionary(domain->dictionary)) {
@@ -1228,13 +1229,13 @@ Bool UpdateDomainFile(WDDomain * domain)
 		}
 	}
 
-	result = WMWritePropListToFile(dict, domain->path);
+	wPersistWrite(domain->path, dict);
 
 	if (freeDict) {
 		WMReleasePropList(dict);
 	}
 
-	return result;
+	return True;
 }
 
 char *StrConcatDot(const char *a, const char *b)
@@ -136,5 +136,9 @@ int MonitorLoop(int argc, char **argv)
 			break;
 	}
 	wfree(child_argv);
+
+	/* Like for the options that only print something, such as --dump-stats */
+	if (!error && WIFEXITED(status))
+		return WEXITSTATUS(status);
 	return 0;
 }
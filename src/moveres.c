@@ -42,6 +42,7 @@
 #include "geomview.h"
 #include "screen.h"
 #include "xinerama.h"
+#include "spatial.h"
 
 #include <WINGs/WINGsP.h>
 
@@ -54,11 +55,6 @@
 #define UP              4
 #define DOWN            8
 
-/* True if window currently has a border. This also includes borderless
- * windows which are currently selected
- */
-#define HAS_BORDER_WITH_SELECT(w) ((w)->flags.selected || HAS_BORDER(w))
-
 
 /*
  *----------------------------------------------------------------------
@@ -629,68 +625,64 @@ typedef struct {
 	} snap;
 } MoveData;
 
-#define WTOP(w) (w)->frame_y
-#define WLEFT(w) (w)->frame_x
-#define WRIGHT(w) ((w)->frame_x + (int)(w)->frame->core->width - 1 + \
-    (HAS_BORDER_WITH_SELECT(w) ? 2*(w)->screen_ptr->frame_border_width : 0))
-#define WBOTTOM(w) ((w)->frame_y + (int)(w)->frame->core->height - 1 + \
-    (HAS_BORDER_WITH_SELECT(w) ? 2*(w)->screen_ptr->frame_border_width : 0))
-
-static int compareWTop(const void *a, const void *b)
+static int edgeTop(WWindow *wwin)
 {
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+	return WTOP(wwin);
+}
 
-	if (WTOP(wwin1) > WTOP(wwin2))
-		return -1;
-	else if (WTOP(wwin1) < WTOP(wwin2))
-		return 1;
-	else
-		return 0;
+static int edgeLeft(WWindow *wwin)
+{
+	return WLEFT(wwin);
 }
 
-static int compareWLeft(const void *a, const void *b)
+static int edgeRight(WWindow *wwin)
 {
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+	return WRIGHT(wwin);
+}
 
-	if (WLEFT(wwin1) > WLEFT(wwin2))
-		return -1;
-	else if (WLEFT(wwin1) < WLEFT(wwin2))
-		return 1;
-	else
-		return 0;
+static int edgeBottom(WWindow *wwin)
+{
+	return WBOTTOM(wwin);
 }
 
-static int compareWRight(const void *a, const void *b)
+/*
+ * Number of windows at the start of the list whose edge is before 'pos',
+ * in the order of the list: as it is sorted, they are all at the start
+ */
+static int countEdgesBefore(WWindow **list, int count, int (*edge)(WWindow *), int pos, Bool ascending)
 {
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+	int low, high, middle;
+
+	low = 0;
+	high = count;
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (ascending ? ((*edge) (list[middle]) < pos) : ((*edge) (list[middle]) > pos))
+			low = middle + 1;
+		else
+			high = middle;
+	}
 
-	if (WRIGHT(wwin1) < WRIGHT(wwin2))
-		return -1;
-	else if (WRIGHT(wwin1) > WRIGHT(wwin2))
-		return 1;
-	else
-		return 0;
+	return low;
 }
 
-static int compareWBottom(const void *a, const void *b)
+/* Index of the window relative to the others, which is kept when it is on an edge */
+static int findEdgeIndex(int index, WWindow **list, int count, int (*edge)(WWindow *), int pos, Bool ascending)
 {
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+	int n;
 
-	if (WBOTTOM(wwin1) < WBOTTOM(wwin2))
-		return -1;
-	else if (WBOTTOM(wwin1) > WBOTTOM(wwin2))
-		return 1;
-	else
+	n = countEdgesBefore(list, count, edge, pos, ascending);
+	if (n > 0)
+		return n;
+
+	if (ascending ? (pos < (*edge) (list[0])) : (pos > (*edge) (list[0])))
 		return 0;
+
+	return index;
 }
 
 static void updateResistance(MoveData *data, int newX, int newY)
 {
-	int i;
 	int newX2 = newX + data->winWidth;
 	int newY2 = newY + data->winHeight;
 	Bool ok = False;
@@ -731,33 +723,14 @@ static void updateResistance(MoveData *data, int newX, int newY)
 	if (!ok)
 		return;
 
-	/* TODO: optimize this */
-	if (data->realY < WBOTTOM(data->bottomList[0])) {
-		data->bottomIndex = 0;
-	}
-	if (data->realX < WRIGHT(data->rightList[0])) {
-		data->rightIndex = 0;
-	}
-	if ((data->realX + data->winWidth) > WLEFT(data->leftList[0])) {
-		data->leftIndex = 0;
-	}
-	if ((data->realY + data->winHeight) > WTOP(data->topList[0])) {
-		data->topIndex = 0;
-	}
-	for (i = 0; i < data->count; i++) {
-		if (data->realY > WBOTTOM(data->bottomList[i])) {
-			data->bottomIndex = i + 1;
-		}
-		if (data->realX > WRIGHT(data->rightList[i])) {
-			data->rightIndex = i + 1;
-		}
-		if ((data->realX + data->winWidth) < WLEFT(data->leftList[i])) {
-			data->leftIndex = i + 1;
-		}
-		if ((data->realY + data->winHeight) < WTOP(data->topList[i])) {
-			data->topIndex = i + 1;
-		}
-	}
+	data->bottomIndex = findEdgeIndex(data->bottomIndex, data->bottomList, data->count,
+					  edgeBottom, data->realY, True);
+	data->rightIndex = findEdgeIndex(data->rightIndex, data->rightList, data->count,
+					 edgeRight, data->realX, True);
+	data->leftIndex = findEdgeIndex(data->leftIndex, data->leftList, data->count,
+					edgeLeft, data->realX + data->winWidth, False);
+	data->topIndex = findEdgeIndex(data->topIndex, data->topList, data->count,
+				       edgeTop, data->realY + data->winHeight, False);
 }
 
 static void freeMoveData(MoveData * data)
@@ -772,25 +745,49 @@ static void freeMoveData(MoveData * data)
 		wfree(data->bottomList);
 }
 
+/* Copy the windows which can stop the move, keeping the order of the index */
+static int copyEdgeList(WWindow *wwin, WWindow **list, int edge, Bool reverse)
+{
+	WScreen *scr = wwin->screen_ptr;
+	WWindow **sorted, *tmp;
+	int i, count, n;
+
+	sorted = wSpatialSortedWindows(scr, scr->current_workspace, edge, &count);
+
+	n = 0;
+	for (i = 0; i < count; i++) {
+		tmp = sorted[reverse ? count - 1 - i : i];
+
+		/* the selected windows are dragged along */
+		if (tmp != wwin && !(tmp->flags.selected && scr->selected_windows)
+		    && !tmp->flags.miniaturized
+		    && !tmp->flags.hidden && !tmp->flags.obscured && !WFLAGP(tmp, sunken))
+			list[n++] = tmp;
+	}
+
+	return n;
+}
+
 static void updateMoveData(WWindow * wwin, MoveData * data)
 {
 	WScreen *scr = wwin->screen_ptr;
-	WWindow *tmp;
-	int i;
+	int count;
+
+	/* The windows of the workspace are kept sorted, no need to do it here */
+	wSpatialSortedWindows(scr, scr->current_workspace, WEDGE_TOP, &count);
 
 	data->count = 0;
-	tmp = scr->focused_window;
-	while (tmp) {
-		if (tmp != wwin && scr->current_workspace == tmp->frame->workspace
-		    && !tmp->flags.miniaturized
-		    && !tmp->flags.hidden && !tmp->flags.obscured && !WFLAGP(tmp, sunken)) {
-			data->topList[data->count] = tmp;
-			data->leftList[data->count] = tmp;
-			data->rightList[data->count] = tmp;
-			data->bottomList[data->count] = tmp;
-			data->count++;
-		}
-		tmp = tmp->prev;
+	if (count > 0) {
+		data->topList = wrealloc(data->topList, sizeof(WWindow *) * count);
+		data->leftList = wrealloc(data->leftList, sizeof(WWindow *) * count);
+		data->rightList = wrealloc(data->rightList, sizeof(WWindow *) * count);
+		data->bottomList = wrealloc(data->bottomList, sizeof(WWindow *) * count);
+
+		/* order from closest to the border of the screen to farthest */
+		data->count = copyEdgeList(wwin, data->topList, WEDGE_TOP, True);
+		copyEdgeList(wwin, data->leftList, WEDGE_LEFT, True);
+		copyEdgeList(wwin, data->rightList, WEDGE_RIGHT, False);
+		copyEdgeList(wwin, data->bottomList, WEDGE_BOTTOM, False);
 	}
 
 	if (data->count == 0) {
@@ -801,65 +798,19 @@ static void updateMoveData(WWindow * wwin, MoveData * data)
 		return;
 	}
 
-	/* order from closest to the border of the screen to farthest */
-
-	qsort(data->topList, data->count, sizeof(data->topList[0]), compareWTop);
-	qsort(data->leftList, data->count, sizeof(data->leftList[0]), compareWLeft);
-	qsort(data->rightList, data->count, sizeof(data->rightList[0]), compareWRight);
-	qsort(data->bottomList, data->count, sizeof(data->bottomList[0]), compareWBottom);
-
 	/* figure the position of the window relative to the others */
 
-	data->topIndex = -1;
-	data->leftIndex = -1;
-	data->rightIndex = -1;
-	data->bottomIndex = -1;
-
-	if (WTOP(wwin) < WBOTTOM(data->bottomList[0])) {
-		data->bottomIndex = 0;
-	}
-	if (WLEFT(wwin) < WRIGHT(data->rightList[0])) {
-		data->rightIndex = 0;
-	}
-	if (WRIGHT(wwin) > WLEFT(data->leftList[0])) {
-		data->leftIndex = 0;
-	}
-	if (WBOTTOM(wwin) > WTOP(data->topList[0])) {
-		data->topIndex = 0;
-	}
-	for (i = 0; i < data->count; i++) {
-		if (WTOP(wwin) >= WBOTTOM(data->bottomList[i])) {
-			data->bottomIndex = i + 1;
-		}
-		if (WLEFT(wwin) >= WRIGHT(data->rightList[i])) {
-			data->rightIndex = i + 1;
-		}
-		if (WRIGHT(wwin) <= WLEFT(data->leftList[i])) {
-			data->leftIndex = i + 1;
-		}
-		if (WBOTTOM(wwin) <= WTOP(data->topList[i])) {
-			data->topIndex = i + 1;
-		}
-	}
+	data->bottomIndex = countEdgesBefore(data->bottomList, data->count, edgeBottom, WTOP(wwin) + 1, True);
+	data->rightIndex = countEdgesBefore(data->rightList, data->count, edgeRight, WLEFT(wwin) + 1, True);
+	data->leftIndex = countEdgesBefore(data->leftList, data->count, edgeLeft, WRIGHT(wwin) - 1, False);
+	data->topIndex = countEdgesBefore(data->topList, data->count, edgeTop, WBOTTOM(wwin) - 1, False);
 }
 
 static void initMoveData(WWindow * wwin, MoveData * data)
 {
-	int i;
-	WWindow *tmp;
-
 	memset(data, 0, sizeof(MoveData));
 
-	for (i = 0, tmp = wwin->screen_ptr->focused_window; tmp != NULL; tmp = tmp->prev, i++) ;
-
-	if (i > 1) {
-		data->topList = wmalloc(sizeof(WWindow *) * i);
-		data->leftList = wmalloc(sizeof(WWindow *) * i);
-		data->rightList = wmalloc(sizeof(WWindow *) * i);
-		data->bottomList = wmalloc(sizeof(WWindow *) * i);
-
-		updateMoveData(wwin, data);
-	}
+	updateMoveData(wwin, data);
 
 	data->realX = wwin->frame_x;
 	data->realY = wwin->frame_y;
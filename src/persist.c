@@ -0,0 +1,367 @@
+/* persist.c - write the state files in the background
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "worker.h"
+#include "persist.h"
+
+
+/* Time to wait for more changes before writing, in ms */
+#define PERSIST_DELAY		1000
+
+/* A file that keeps changing is still written at least this often, in ms */
+#define PERSIST_MAX_DELAY	5000
+
+typedef struct PersistFile {
+	char *path;
+
+	WMPropList *pending;	/* content waiting to be written */
+	WMHandlerID timer;
+	long first_change;	/* when 'pending' was first set, in ms */
+
+	char *written;		/* what we know the file contains, if known */
+	Bool busy;		/* a job is writing it in the background */
+} PersistFile;
+
+typedef struct PersistJob {
+	PersistFile *file;
+	WMPropList *snapshot;
+
+	char *content;
+	char *previous;
+
+	Bool skipped;
+	const char *failed;	/* operation that failed, if any */
+	int error;
+} PersistJob;
+
+static WMArray *persist_files = NULL;
+
+/* Read once from the main thread, as umask() can only be read by changing it */
+static mode_t file_mode;
+
+
+static long now_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+static PersistFile *find_file(const char *path)
+{
+	PersistFile *file;
+	WMArrayIterator iter;
+	mode_t mask;
+
+	if (!persist_files) {
+		persist_files = WMCreateArray(4);
+
+		mask = umask(S_IRWXG | S_IRWXO);
+		umask(mask);
+		file_mode = 0666 & ~mask;
+
+		/* Cached on first call, which must not happen in the worker */
+		(void) wusergnusteppath();
+	}
+
+	WM_ITERATE_ARRAY(persist_files, file, iter) {
+		if (strcmp(file->path, path) == 0)
+			return file;
+	}
+
+	file = wmalloc(sizeof(PersistFile));
+	file->path = wstrdup(path);
+	WMAddToArray(persist_files, file);
+
+	return file;
+}
+
+/*
+ * The functions below are called from the worker thread: they only use the
+ * job and the path, which does not change once the file was registered
+ */
+
+static char *read_file(const char *path)
+{
+	struct stat stbuf;
+	char *data;
+	ssize_t n;
+	off_t done;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &stbuf) < 0 || !S_ISREG(stbuf.st_mode)) {
+		close(fd);
+		return NULL;
+	}
+
+	data = wmalloc(stbuf.st_size + 1);
+	for (done = 0; done < stbuf.st_size; done += n) {
+		n = read(fd, data + done, stbuf.st_size - done);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			break;
+		}
+	}
+	close(fd);
+
+	if (done != stbuf.st_size) {
+		wfree(data);
+		return NULL;
+	}
+	data[done] = '\0';
+
+	return data;
+}
+
+static void write_file(PersistJob *job)
+{
+	const char *path = job->file->path;
+	char *tmp_path;
+	size_t len, done;
+	ssize_t n;
+	int fd;
+
+	if (!wmkdirhier(path)) {
+		job->failed = "mkdir";
+		job->error = errno;
+		return;
+	}
+
+	/* Same directory as the destination, so rename() can replace it */
+	tmp_path = wstrconcat(path, ".XXXXXX");
+	fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		job->failed = "mkstemp";
+		job->error = errno;
+		wfree(tmp_path);
+		return;
+	}
+	(void) fchmod(fd, file_mode);
+
+	len = strlen(job->content);
+	for (done = 0; done < len; done += n) {
+		n = write(fd, job->content + done, len - done);
+		if (n < 0) {
+			if (errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			job->failed = "write";
+			goto failure;
+		}
+	}
+
+	/* Keep the old file if the new one may not be on the disk */
+	if (fsync(fd) != 0) {
+		job->failed = "fsync";
+		goto failure;
+	}
+	if (close(fd) != 0) {
+		fd = -1;
+		job->failed = "close";
+		goto failure;
+	}
+	fd = -1;
+
+	if (rename(tmp_path, path) != 0) {
+		job->failed = "rename";
+		goto failure;
+	}
+
+	wfree(tmp_path);
+	return;
+
+ failure:
+	job->error = errno;
+	if (fd >= 0)
+		close(fd);
+	unlink(tmp_path);
+	wfree(tmp_path);
+}
+
+static void persist_work(void *data)
+{
+	PersistJob *job = data;
+	char *desc;
+
+	desc = WMGetPropListDescription(job->snapshot, True);
+	job->content = wstrconcat(desc, "\n");
+	wfree(desc);
+
+	/* After a restart, compare with what the previous instance wrote */
+	if (!job->previous)
+		job->previous = read_file(job->file->path);
+
+	if (job->previous && strcmp(job->previous, job->content) == 0) {
+		job->skipped = True;
+		return;
+	}
+
+	write_file(job);
+}
+
+/* Back in the main thread */
+
+static void schedule_write(PersistFile *file);
+
+static void persist_done(void *data)
+{
+	PersistJob *job = data;
+	PersistFile *file = job->file;
+
+	WMReleasePropList(job->snapshot);
+
+	if (job->failed) {
+		werror(_("could not save %s (%s: %s)"), file->path, job->failed, strerror(job->error));
+		/* The old content may still be there, or not */
+		wfree(job->content);
+		file->written = NULL;
+	} else {
+		file->written = job->content;
+	}
+	if (job->previous)
+		wfree(job->previous);
+
+	file->busy = False;
+	wfree(job);
+
+	/* Changed again while it was being written */
+	if (file->pending)
+		schedule_write(file);
+}
+
+static PersistJob *make_job(PersistFile *file)
+{
+	PersistJob *job;
+
+	job = wmalloc(sizeof(PersistJob));
+	job->file = file;
+	job->snapshot = file->pending;
+	job->previous = file->written;
+
+	file->pending = NULL;
+	file->written = NULL;
+	file->busy = True;
+
+	return job;
+}
+
+static void start_write(void *data)
+{
+	PersistFile *file = data;
+	PersistJob *job;
+
+	file->timer = NULL;
+
+	job = make_job(file);
+	wWorkerRun(persist_work, persist_done, job);
+}
+
+static void schedule_write(PersistFile *file)
+{
+	long now, delay;
+
+	/* persist_done() will come back here */
+	if (file->busy)
+		return;
+
+	now = now_ms();
+	if (file->timer)
+		WMDeleteTimerHandler(file->timer);
+	else
+		file->first_change = now;
+
+	delay = PERSIST_MAX_DELAY - (now - file->first_change);
+	if (delay > PERSIST_DELAY)
+		delay = PERSIST_DELAY;
+	if (delay < 0)
+		delay = 0;
+
+	file->timer = WMAddTimerHandler(delay, start_write, file);
+}
+
+void wPersistWrite(const char *path, WMPropList *plist)
+{
+	PersistFile *file;
+
+	file = find_file(path);
+
+	if (file->pending)
+		WMReleasePropList(file->pending);
+
+	/*
+	 * The copy is made here, as the original is only safe to use from
+	 * the main thread; formatting it is left to the worker
+	 */
+	file->pending = WMDeepCopyPropList(plist);
+
+	schedule_write(file);
+}
+
+void wPersistFlush(void)
+{
+	PersistFile *file;
+	PersistJob *job;
+	WMArrayIterator iter;
+
+	if (!persist_files)
+		return;
+
+	/* Let the jobs in progress finish first, so they do not overwrite ours */
+	wWorkerFlush();
+
+	WM_ITERATE_ARRAY(persist_files, file, iter) {
+		if (!file->pending)
+			continue;
+
+		if (file->timer) {
+			WMDeleteTimerHandler(file->timer);
+			file->timer = NULL;
+		}
+
+		job = make_job(file);
+		persist_work(job);
+		persist_done(job);
+	}
+}
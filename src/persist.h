@@ -0,0 +1,38 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMPERSIST_H_
+#define WMPERSIST_H_
+
+/*
+ * Save 'plist' in the file 'path' a bit later, from a background thread.
+ *
+ * A copy of 'plist' is taken, so the caller can keep changing it; when the
+ * same file is written again before the delay expires, only the last
+ * content is written, and the file is not touched if it did not change.
+ */
+void wPersistWrite(const char *path, WMPropList *plist);
+
+/*
+ * Write all the pending files now, before exiting or restarting
+ */
+void wPersistFlush(void);
+
+#endif
@@ -29,6 +29,7 @@
 #include <string.h>
 #include "WindowMaker.h"
 #include "pixmap.h"
+#include "stats.h"
 
 /*
  *----------------------------------------------------------------------
@@ -62,6 +63,7 @@ WPixmap *wPixmapCreateFromXPMData(WScreen * scr, char **data)
 
 	RReleaseImage(image);
 
+	wStatsCreated(WSTATS_PIXMAPS);
 	return pix;
 }
 
@@ -95,6 +97,7 @@ WPixmap *wPixmapCreateFromXBMData(WScreen * scr, char *data, char *mask,
 	pix->width = width;
 	pix->height = height;
 	pix->depth = scr->w_depth;
+	wStatsCreated(WSTATS_PIXMAPS);
 	return pix;
 }
 
@@ -116,6 +119,7 @@ WPixmap *wPixmapCreate(Pixmap image, Pixmap mask)
 	pix->width = width;
 	pix->height = height;
 	pix->depth = depth;
+	wStatsCreated(WSTATS_PIXMAPS);
 	return pix;
 }
 
@@ -139,5 +143,6 @@ void wPixmapDestroy(WPixmap * pix)
 			XFreePixmap(dpy, pix->image);
 		}
 	}
+	wStatsFreed(WSTATS_PIXMAPS);
 	wfree(pix);
 }
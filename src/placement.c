@@ -37,6 +37,7 @@
 #include "application.h"
 #include "dock.h"
 #include "xinerama.h"
+#include "spatial.h"
 #include "placement.h"
 
 
@@ -258,34 +259,49 @@ int calcIntersectionArea(int x1, int y1, int w1, int h1, int x2, int y2, int w2,
 	    * calcIntersectionLength(y1, h1, y2, h2);
 }
 
-static int calcSumOfCoveredAreas(WWindow *wwin, int x, int y, int w, int h)
+/* An area being tested for placement, see wSpatialForEachWindow() */
+typedef struct PlacementArea {
+	int x, y, w, h;
+	Bool ignore_sunken;
+	int sum_isect;
+} PlacementArea;
+
+static Bool addCoveredArea(WWindow *test_window, void *data)
 {
-	int sum_isect = 0;
-	WWindow *test_window;
+	PlacementArea *area = data;
 	int tw, tx, ty, th;
 
-	test_window = wwin->screen_ptr->focused_window;
-	for (; test_window != NULL && test_window->prev != NULL;)
-		test_window = test_window->prev;
-
-	for (; test_window != NULL; test_window = test_window->next) {
-		if (test_window->frame->core->stacking->window_level < WMNormalLevel) {
-			continue;
-		}
+	if (test_window->frame->core->stacking->window_level < WMNormalLevel)
+		return False;
 
-		tw = test_window->frame->core->width;
-		th = test_window->frame->core->height;
-		tx = test_window->frame_x;
-		ty = test_window->frame_y;
+	tw = test_window->frame->core->width;
+	th = test_window->frame->core->height;
+	tx = test_window->frame_x;
+	ty = test_window->frame_y;
 
-		if (test_window->flags.mapped || (test_window->flags.shaded &&
-		     test_window->frame->workspace == wwin->screen_ptr->current_workspace &&
-		     !(test_window->flags.miniaturized || test_window->flags.hidden))) {
-			sum_isect += calcIntersectionArea(tx, ty, tw, th, x, y, w, h);
-		}
+	if (test_window->flags.mapped || (test_window->flags.shaded &&
+	     test_window->frame->workspace == test_window->screen_ptr->current_workspace &&
+	     !(test_window->flags.miniaturized || test_window->flags.hidden))) {
+		area->sum_isect += calcIntersectionArea(tx, ty, tw, th, area->x, area->y, area->w, area->h);
 	}
 
-	return sum_isect;
+	return False;
+}
+
+static int calcSumOfCoveredAreas(WWindow *wwin, int x, int y, int w, int h)
+{
+	PlacementArea area;
+
+	area.x = x;
+	area.y = y;
+	area.w = w;
+	area.h = h;
+	area.sum_isect = 0;
+
+	/* only the windows around the area can cover it */
+	wSpatialForEachWindow(wwin->screen_ptr, x, y, w, h, addCoveredArea, &area);
+
+	return area.sum_isect;
 }
 
 static void set_width_height(WWindow *wwin, unsigned int *width, unsigned int *height)
@@ -331,24 +347,25 @@ window_overlaps(WWindow *win, int x, int y, int w, int h, Bool ignore_sunken)
 	return False;
 }
 
+static Bool overlapsArea(WWindow *win, void *data)
+{
+	PlacementArea *area = data;
+
+	return window_overlaps(win, area->x, area->y, area->w, area->h, area->ignore_sunken);
+}
+
 static Bool
 screen_has_space(WScreen *scr, int x, int y, int w, int h, Bool ignore_sunken)
 {
-	WWindow *focused = scr->focused_window, *i;
+	PlacementArea area;
 
-	for (i = focused; i; i = i->next) {
-		if (window_overlaps(i, x, y, w, h, ignore_sunken)) {
-			return False;
-		}
-	}
-
-	for (i = focused; i; i = i->prev) {
-		if (window_overlaps(i, x, y, w, h, ignore_sunken)) {
-			return False;
-		}
-	}
+	area.x = x;
+	area.y = y;
+	area.w = w;
+	area.h = h;
+	area.ignore_sunken = ignore_sunken;
 
-	return True;
+	return !wSpatialForEachWindow(scr, x, y, w, h, overlapsArea, &area);
 }
 
 static void
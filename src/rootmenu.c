@@ -35,6 +35,11 @@
 #include <time.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -65,8 +70,12 @@
 static WMenu *readMenuPipe(WScreen * scr, char **file_name);
 static WMenu *readPLMenuPipe(WScreen * scr, char **file_name);
 static WMenu *readMenuFile(WScreen *scr, const char *file_name);
-static WMenu *readMenuDirectory(WScreen *scr, const char *title, char **file_name, const char *command);
+static WMenu *readMenuDirectory(WScreen *scr, const char *title, char **file_name, const char *command,
+				WMArray **items);
 static void menu_parser_register_macros(WMenuParser parser);
+static void watchMenu(WMenu *menu, char **path, const char *command, Bool directory, WMArray *items);
+static Bool menuIsUpToDate(WMenu *menu);
+static Bool menuIsWatched(WMenu *menu);
 
 typedef struct Shortcut {
 	struct Shortcut *next;
@@ -572,9 +581,14 @@ static void constructMenu(WMenu * menu, WMenuEntry * entry)
 	char **path;
 	char *cmd;
 	char *lpath = NULL;
+	WMArray *items;
 	int i, first = -1;
 	time_t last = 0;
 
+	/* Nothing changed since it was read, no need to look at the files */
+	if (menu->cascades[entry->cascade] && menuIsUpToDate(menu->cascades[entry->cascade]))
+		return;
+
 	separateCommand((char *)entry->clientdata, &path, &cmd);
 	if (path == NULL || *path == NULL || **path == 0) {
 		wwarning(_("invalid OPEN_MENU specification: %s"), (char *)entry->clientdata);
@@ -610,8 +624,12 @@ static void constructMenu(WMenu * menu, WMenuEntry * entry)
 
 		/* try interpreting path as a proplist file */
 		submenu = constructPLMenu(menu->frame->screen_ptr, path[0]);
-		/* if unsuccessful, try it as an old-style file */
-		if (!submenu) {
+		if (submenu) {
+			char *files[2] = { path[0], NULL };
+
+			watchMenu(submenu, files, NULL, False, NULL);
+		} else {
+			/* if unsuccessful, try it as an old-style file */
 
 			i = 0;
 			while (path[i] != NULL) {
@@ -661,13 +679,18 @@ static void constructMenu(WMenu * menu, WMenuEntry * entry)
 			}
 			stat(path[first], &stat_buf);
 			if (!menu->cascades[entry->cascade]
-					|| menu->cascades[entry->cascade]->timestamp < last) {
+					|| menu->cascades[entry->cascade]->timestamp < last
+					/* a watched menu only gets here when it changed */
+					|| menuIsWatched(menu->cascades[entry->cascade])) {
 
 				if (S_ISDIR(stat_buf.st_mode)) {
 					/* menu directory */
-					submenu = readMenuDirectory(menu->frame->screen_ptr, entry->text, path, cmd);
-					if (submenu)
+					submenu = readMenuDirectory(menu->frame->screen_ptr, entry->text, path, cmd,
+								    &items);
+					if (submenu) {
 						submenu->timestamp = last;
+						watchMenu(submenu, path, cmd, True, items);
+					}
 				} else if (S_ISREG(stat_buf.st_mode)) {
 					/* menu file */
 
@@ -676,8 +699,12 @@ static void constructMenu(WMenu * menu, WMenuEntry * entry)
 								(char *)entry->clientdata);
 
 					submenu = readMenuFile(menu->frame->screen_ptr, path[first]);
-					if (submenu)
+					if (submenu) {
+						char *files[2] = { path[first], NULL };
+
 						submenu->timestamp = stat_buf.st_mtime;
+						watchMenu(submenu, files, NULL, False, NULL);
+					}
 				} else {
 					submenu = NULL;
 				}
@@ -817,8 +844,9 @@ static WMenuEntry *addWindowsMenu(WScreen *scr, WMenu *menu, const char *title)
 	return entry;
 }
 
-static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shortcut, const char *command,
-				const char *params, const char *file_name)
+/* Add an entry at 'index' in the menu, or at the end if it is -1 */
+static WMenuEntry *addMenuEntry(WMenu *menu, int index, const char *title, const char *shortcut,
+				const char *command, const char *params, const char *file_name)
 {
 	WScreen *scr;
 	WMenuEntry *entry = NULL;
@@ -840,7 +868,7 @@ static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shor
 			}
 			dummy = wMenuCreate(scr, title, False);
 			dummy->on_destroy = removeShortcutsForMenu;
-			entry = wMenuAddCallback(menu, title, constructMenu, path);
+			entry = wMenuInsertCallback(menu, index, title, constructMenu, path);
 			entry->free_cdata = wfree;
 			wMenuEntrySetCascade(menu, entry, dummy);
 		}
@@ -857,7 +885,7 @@ static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shor
 
 			dummy = wMenuCreate(scr, title, False);
 			dummy->on_destroy = removeShortcutsForMenu;
-			entry = wMenuAddCallback(menu, title, constructPLMenuFromPipe, path);
+			entry = wMenuInsertCallback(menu, index, title, constructPLMenuFromPipe, path);
 			entry->free_cdata = wfree;
 			wMenuEntrySetCascade(menu, entry, dummy);
 		}
@@ -865,7 +893,7 @@ static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shor
 		if (!params)
 			wwarning(_("%s:missing parameter for menu command \"%s\""), file_name, command);
 		else {
-			entry = wMenuAddCallback(menu, title, execCommand, wstrconcat("exec ", params));
+			entry = wMenuInsertCallback(menu, index, title, execCommand, wstrconcat("exec ", params));
 			entry->free_cdata = wfree;
 			shortcutOk = True;
 		}
@@ -873,28 +901,28 @@ static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shor
 		if (!params)
 			wwarning(_("%s:missing parameter for menu command \"%s\""), file_name, command);
 		else {
-			entry = wMenuAddCallback(menu, title, execCommand, wstrdup(params));
+			entry = wMenuInsertCallback(menu, index, title, execCommand, wstrdup(params));
 			entry->free_cdata = wfree;
 			shortcutOk = True;
 		}
 	} else if (strcmp(command, "EXIT") == 0) {
 
 		if (params && strcmp(params, "QUICK") == 0)
-			entry = wMenuAddCallback(menu, title, exitCommand, (void *)M_QUICK);
+			entry = wMenuInsertCallback(menu, index, title, exitCommand, (void *)M_QUICK);
 		else
-			entry = wMenuAddCallback(menu, title, exitCommand, NULL);
+			entry = wMenuInsertCallback(menu, index, title, exitCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "SHUTDOWN") == 0) {
 
 		if (params && strcmp(params, "QUICK") == 0)
-			entry = wMenuAddCallback(menu, title, shutdownCommand, (void *)M_QUICK);
+			entry = wMenuInsertCallback(menu, index, title, shutdownCommand, (void *)M_QUICK);
 		else
-			entry = wMenuAddCallback(menu, title, shutdownCommand, NULL);
+			entry = wMenuInsertCallback(menu, index, title, shutdownCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "REFRESH") == 0) {
-		entry = wMenuAddCallback(menu, title, refreshCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, refreshCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "WORKSPACE_MENU") == 0) {
@@ -906,33 +934,33 @@ static WMenuEntry *addMenuEntry(WMenu *menu, const char *title, const char *shor
 
 		shortcutOk = True;
 	} else if (strcmp(command, "ARRANGE_ICONS") == 0) {
-		entry = wMenuAddCallback(menu, title, arrangeIconsCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, arrangeIconsCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "HIDE_OTHERS") == 0) {
-		entry = wMenuAddCallback(menu, title, hideOthersCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, hideOthersCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "SHOW_ALL") == 0) {
-		entry = wMenuAddCallback(menu, title, showAllCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, showAllCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "RESTART") == 0) {
-		entry = wMenuAddCallback(menu, title, restartCommand, params ? wstrdup(params) : NULL);
+		entry = wMenuInsertCallback(menu, index, title, restartCommand, params ? wstrdup(params) : NULL);
 		entry->free_cdata = wfree;
 		shortcutOk = True;
 	} else if (strcmp(command, "SAVE_SESSION") == 0) {
-		entry = wMenuAddCallback(menu, title, saveSessionCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, saveSessionCommand, NULL);
 
 		shortcutOk = True;
 	} else if (strcmp(command, "CLEAR_SESSION") == 0) {
-		entry = wMenuAddCallback(menu, title, clearSessionCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, clearSessionCommand, NULL);
 		shortcutOk = True;
 	} else if (strcmp(command, "INFO_PANEL") == 0) {
-		entry = wMenuAddCallback(menu, title, infoPanelCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, infoPanelCommand, NULL);
 		shortcutOk = True;
 	} else if (strcmp(command, "LEGAL_PANEL") == 0) {
-		entry = wMenuAddCallback(menu, title, legalPanelCommand, NULL);
+		entry = wMenuInsertCallback(menu, index, title, legalPanelCommand, NULL);
 		shortcutOk = True;
 	} else {
 		wwarning(_("%s:unknown command \"%s\" in menu config."), file_name, command);
@@ -997,7 +1025,7 @@ static WMenu *parseCascade(WScreen * scr, WMenu * menu, WMenuParser parser)
 			return menu;
 		} else {
 			/* normal items */
-			addMenuEntry(menu, M_(title), shortcut, command, params, WMenuParserGetFilename(parser));
+			addMenuEntry(menu, -1, M_(title), shortcut, command, params, WMenuParserGetFilename(parser));
 		}
 		freeline(title, command, params, shortcut);
 	}
@@ -1148,17 +1176,32 @@ static WMenu *readMenuPipe(WScreen * scr, char **file_name)
 
 typedef struct {
 	char *name;
-	int index;
+	int index;		/* of the directory in the path list */
+	Bool is_dir;
 } dir_data;
 
-static int myCompare(const void *d1, const void *d2)
+static void freeDirData(void *data)
 {
-	dir_data *p1 = *(dir_data **) d1;
-	dir_data *p2 = *(dir_data **) d2;
+	dir_data *d = data;
+
+	wfree(d->name);
+	wfree(d);
+}
+
+/* Sub-directories first, then the files, each sorted by name */
+static int compareDirData(const dir_data *p1, const dir_data *p2)
+{
+	if (p1->is_dir != p2->is_dir)
+		return p1->is_dir ? -1 : 1;
 
 	return strcmp(p1->name, p2->name);
 }
 
+static int myCompare(const void *d1, const void *d2)
+{
+	return compareDirData(*(dir_data **) d1, *(dir_data **) d2);
+}
+
 /***** Preset some macro for file parser *****/
 static void menu_parser_register_macros(WMenuParser parser)
 {
@@ -1205,21 +1248,161 @@ static Bool isFilePackage(const char *file)
 	}
 }
 
-static WMenu *readMenuDirectory(WScreen *scr, const char *title, char **path, const char *command)
+enum {
+	DIR_ENTRY_NONE,
+	DIR_ENTRY_MENU,		/* a sub-directory, for a sub-menu */
+	DIR_ENTRY_COMMAND	/* a file to run, or to give to the command */
+};
+
+/* Tell what the file 'name' in 'dir' will show in the menu, if anything */
+static int classifyDirectoryEntry(const char *dir, const char *name, const char *command)
+{
+	struct stat stat_buf;
+	char *buffer;
+	int kind = DIR_ENTRY_NONE;
+	Bool isFilePack = False;
+
+	/* hidden files, and "." and ".." */
+	if (name[0] == '.')
+		return DIR_ENTRY_NONE;
+
+	buffer = malloc(strlen(dir) + strlen(name) + 4);
+	if (!buffer) {
+		werror(_("out of memory while constructing directory menu %s"), dir);
+		return DIR_ENTRY_NONE;
+	}
+
+	strcpy(buffer, dir);
+	strcat(buffer, "/");
+	strcat(buffer, name);
+
+	if (stat(buffer, &stat_buf) != 0) {
+		werror(_("%s:could not stat file \"%s\" in menu directory"), dir, name);
+	} else if (S_ISDIR(stat_buf.st_mode) && !(isFilePack = isFilePackage(name))) {
+		/* access always returns success for user root */
+		if (access(buffer, X_OK) == 0)
+			kind = DIR_ENTRY_MENU;
+	} else if (S_ISREG(stat_buf.st_mode) || isFilePack) {
+		/* Hack because access always returns X_OK success for user root */
+#define S_IXANY (S_IXUSR | S_IXGRP | S_IXOTH)
+		if ((command != NULL && access(buffer, R_OK) == 0) ||
+		    (command == NULL && access(buffer, X_OK) == 0 &&
+		     (stat_buf.st_mode & S_IXANY)))
+			kind = DIR_ENTRY_COMMAND;
+	}
+	free(buffer);
+
+	return kind;
+}
+
+static WMenuEntry *addDirectoryEntry(WMenu *menu, int index, char **path, dir_data *data,
+				     const char *command, int stripExtension)
+{
+	WMenuEntry *entry;
+	char *buffer, *title;
+	int length, have_space;
+
+	have_space = strchr(path[data->index], ' ') != NULL || strchr(data->name, ' ') != NULL;
+
+	if (data->is_dir) {
+		/* New directory. Use same OPEN_MENU command that was used
+		 * for the current directory. */
+		length = strlen(path[data->index]) + strlen(data->name) + 6;
+		if (stripExtension)
+			length += 7;
+		if (command)
+			length += strlen(command) + 6;
+		buffer = malloc(length);
+		if (!buffer) {
+			werror(_("out of memory while constructing directory menu %s"), path[data->index]);
+			return NULL;
+		}
+
+		buffer[0] = '\0';
+		if (stripExtension)
+			strcat(buffer, "-noext ");
+
+		if (have_space)
+			strcat(buffer, "\"");
+		strcat(buffer, path[data->index]);
+
+		strcat(buffer, "/");
+		strcat(buffer, data->name);
+		if (have_space)
+			strcat(buffer, "\"");
+		if (command) {
+			strcat(buffer, " WITH ");
+			strcat(buffer, command);
+		}
+
+		entry = addMenuEntry(menu, index, M_(data->name), NULL, "OPEN_MENU", buffer, path[data->index]);
+
+		free(buffer);
+		return entry;
+	}
+
+	/* executable: add as entry */
+	length = strlen(path[data->index]) + strlen(data->name) + 6;
+	if (command)
+		length += strlen(command);
+
+	buffer = malloc(length);
+	if (!buffer) {
+		werror(_("out of memory while constructing directory menu %s"), path[data->index]);
+		return NULL;
+	}
+
+	if (command != NULL) {
+		strcpy(buffer, command);
+		strcat(buffer, " ");
+		if (have_space)
+			strcat(buffer, "\"");
+		strcat(buffer, path[data->index]);
+	} else {
+		if (have_space) {
+			buffer[0] = '"';
+			buffer[1] = 0;
+			strcat(buffer, path[data->index]);
+		} else {
+			strcpy(buffer, path[data->index]);
+		}
+	}
+	strcat(buffer, "/");
+	strcat(buffer, data->name);
+	if (have_space)
+		strcat(buffer, "\"");
+
+	/* The name is kept as is, to find the entry again */
+	title = wstrdup(data->name);
+	if (stripExtension) {
+		char *ptr = strrchr(title, '.');
+		if (ptr && ptr != title)
+			*ptr = 0;
+	}
+	entry = addMenuEntry(menu, index, M_(title), NULL, "SHEXEC", buffer, path[data->index]);
+
+	wfree(title);
+	free(buffer);
+	return entry;
+}
+
+/*
+ * If 'items' is not NULL, it is set to the array of the dir_data of the
+ * entries, in the order of the menu
+ */
+static WMenu *readMenuDirectory(WScreen *scr, const char *title, char **path, const char *command,
+				WMArray **items)
 {
 	DIR *dir;
 	struct dirent *dentry;
-	struct stat stat_buf;
 	WMenu *menu = NULL;
-	char *buffer;
-	WMArray *dirs = NULL, *files = NULL;
+	WMArray *entries;
 	WMArrayIterator iter;
-	int length, i, have_space = 0;
+	int i, kind;
 	dir_data *data;
 	int stripExtension = 0;
 
-	dirs = WMCreateArray(16);
-	files = WMCreateArray(16);
+	entries = WMCreateArrayWithDestructor(16, freeDirData);
 
 	i = 0;
 	while (path[i] != NULL) {
@@ -1236,168 +1419,429 @@ static WMenu *readMenuDirectory(WScreen *scr, const char *title, char **path, co
 		}
 
 		while ((dentry = readdir(dir))) {
-
-			if (strcmp(dentry->d_name, ".") == 0 || strcmp(dentry->d_name, "..") == 0)
+			kind = classifyDirectoryEntry(path[i], dentry->d_name, command);
+			if (kind == DIR_ENTRY_NONE)
 				continue;
 
-			if (dentry->d_name[0] == '.')
-				continue;
+			data = (dir_data *) wmalloc(sizeof(dir_data));
+			data->name = wstrdup(dentry->d_name);
+			data->index = i;
+			data->is_dir = (kind == DIR_ENTRY_MENU);
 
-			buffer = malloc(strlen(path[i]) + strlen(dentry->d_name) + 4);
-			if (!buffer) {
-				werror(_("out of memory while constructing directory menu %s"), path[i]);
-				break;
-			}
+			WMAddToArray(entries, data);
+		}
 
-			strcpy(buffer, path[i]);
-			strcat(buffer, "/");
-			strcat(buffer, dentry->d_name);
+		closedir(dir);
+		i++;
+	}
 
-			if (stat(buffer, &stat_buf) != 0) {
-				werror(_("%s:could not stat file \"%s\" in menu directory"),
-					  path[i], dentry->d_name);
-			} else {
-				Bool isFilePack = False;
+	if (!WMGetArrayItemCount(entries)) {
+		WMFreeArray(entries);
+		return NULL;
+	}
+
+	WMSortArray(entries, myCompare);
+
+	menu = wMenuCreate(scr, M_(title), False);
+	menu->on_destroy = removeShortcutsForMenu;
 
-				data = NULL;
-				if (S_ISDIR(stat_buf.st_mode)
-				    && !(isFilePack = isFilePackage(dentry->d_name))) {
+	WM_ITERATE_ARRAY(entries, data, iter) {
+		if (!addDirectoryEntry(menu, -1, path, data, command, stripExtension))
+			break;
+	}
 
-					/* access always returns success for user root */
-					if (access(buffer, X_OK) == 0) {
-						/* Directory is accesible. Add to directory list */
+	/* Keep the array the same as the menu if we ran out of memory */
+	while (WMGetArrayItemCount(entries) > menu->entry_no)
+		WMDeleteFromArray(entries, WMGetArrayItemCount(entries) - 1);
 
-						data = (dir_data *) wmalloc(sizeof(dir_data));
-						data->name = wstrdup(dentry->d_name);
-						data->index = i;
+	if (items)
+		*items = entries;
+	else
+		WMFreeArray(entries);
 
-						WMAddToArray(dirs, data);
-					}
-				} else if (S_ISREG(stat_buf.st_mode) || isFilePack) {
-					/* Hack because access always returns X_OK success for user root */
-#define S_IXANY (S_IXUSR | S_IXGRP | S_IXOTH)
-					if ((command != NULL && access(buffer, R_OK) == 0) ||
-					    (command == NULL && access(buffer, X_OK) == 0 &&
-					     (stat_buf.st_mode & S_IXANY))) {
+	return menu;
+}
 
-						data = (dir_data *) wmalloc(sizeof(dir_data));
-						data->name = wstrdup(dentry->d_name);
-						data->index = i;
+/************  Watching the Menu Files and Directories   *************/
 
-						WMAddToArray(files, data);
-					}
-				}
-			}
-			free(buffer);
-		}
+#ifdef HAVE_INOTIFY
 
-		closedir(dir);
-		i++;
-	}
+/*
+ * The menus read from files and directories are watched with inotify. A menu
+ * file that changed is read again the next time the menu is opened, and the
+ * entries of a directory menu are added and removed as its files are, so an
+ * unchanged menu can be opened without looking at the file system at all.
+ */
 
-	if (!WMGetArrayItemCount(dirs) && !WMGetArrayItemCount(files)) {
-		WMFreeArray(dirs);
-		WMFreeArray(files);
+#define MENU_FILE_EVENTS	(IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+#define MENU_DIRECTORY_EVENTS	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB \
+				 | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+typedef struct MenuSource {
+	WMenu *menu;		/* NULL once the menu was destroyed */
+	char **path;		/* NULL terminated */
+	int *wd;		/* watch of each path, -1 if none */
+	Bool stale;		/* has to be read again */
+
+	/* Only for the directory menus */
+	Bool directory;
+	char *command;
+	int strip_extension;
+	WMArray *items;		/* dir_data of each entry, in the same order */
+} MenuSource;
+
+static struct {
+	int fd;
+	Bool failed;
+	WMHandlerID handler;
+	WMArray *sources;
+	Bool has_dead;		/* some sources are waiting to be freed */
+} menu_watch = { -1, False, NULL, NULL, False };
+
+static MenuSource *findMenuSource(WMenu *menu)
+{
+	MenuSource *source;
+	WMArrayIterator iter;
+
+	if (!menu_watch.sources)
 		return NULL;
+
+	WM_ITERATE_ARRAY(menu_watch.sources, source, iter) {
+		if (source->menu == menu)
+			return source;
 	}
+	return NULL;
+}
 
-	WMSortArray(dirs, myCompare);
-	WMSortArray(files, myCompare);
+static Bool menuIsUpToDate(WMenu *menu)
+{
+	MenuSource *source = findMenuSource(menu);
 
-	menu = wMenuCreate(scr, M_(title), False);
-	menu->on_destroy = removeShortcutsForMenu;
+	return source != NULL && !source->stale;
+}
 
-	WM_ITERATE_ARRAY(dirs, data, iter) {
-		/* New directory. Use same OPEN_MENU command that was used
-		 * for the current directory. */
-		length = strlen(path[data->index]) + strlen(data->name) + 6;
-		if (stripExtension)
-			length += 7;
-		if (command)
-			length += strlen(command) + 6;
-		buffer = malloc(length);
-		if (!buffer) {
-			werror(_("out of memory while constructing directory menu %s"), path[data->index]);
-			break;
+static Bool menuIsWatched(WMenu *menu)
+{
+	return findMenuSource(menu) != NULL;
+}
+
+static void releaseWatches(MenuSource *source)
+{
+	MenuSource *other;
+	WMArrayIterator iter;
+	int i, j;
+
+	for (i = 0; source->path[i] != NULL; i++) {
+		Bool used = False;
+
+		if (source->wd[i] < 0)
+			continue;
+
+		/* The same path may be used by another menu, and have the same watch */
+		WM_ITERATE_ARRAY(menu_watch.sources, other, iter) {
+			if (other == source || !other->menu)
+				continue;
+			for (j = 0; other->path[j] != NULL; j++)
+				if (other->wd[j] == source->wd[i])
+					used = True;
 		}
+		if (!used && menu_watch.fd >= 0)
+			inotify_rm_watch(menu_watch.fd, source->wd[i]);
+		source->wd[i] = -1;
+	}
+}
 
-		buffer[0] = '\0';
-		if (stripExtension)
-			strcat(buffer, "-noext ");
+static void freeMenuSource(MenuSource *source)
+{
+	int i;
 
-		have_space = strchr(path[data->index], ' ') != NULL || strchr(data->name, ' ') != NULL;
+	for (i = 0; source->path[i] != NULL; i++)
+		wfree(source->path[i]);
+	wfree(source->path);
+	wfree(source->wd);
+	if (source->command)
+		wfree(source->command);
+	if (source->items)
+		WMFreeArray(source->items);
+	wfree(source);
+}
 
-		if (have_space)
-			strcat(buffer, "\"");
-		strcat(buffer, path[data->index]);
+/*
+ * The sources are only marked when their menu is destroyed, as it can happen
+ * while we go through them, and freed later
+ */
+static void freeDeadSources(void)
+{
+	int i;
 
-		strcat(buffer, "/");
-		strcat(buffer, data->name);
-		if (have_space)
-			strcat(buffer, "\"");
-		if (command) {
-			strcat(buffer, " WITH ");
-			strcat(buffer, command);
+	if (!menu_watch.has_dead)
+		return;
+
+	for (i = WMGetArrayItemCount(menu_watch.sources) - 1; i >= 0; i--) {
+		MenuSource *source = WMGetFromArray(menu_watch.sources, i);
+
+		if (!source->menu) {
+			WMDeleteFromArray(menu_watch.sources, i);
+			freeMenuSource(source);
 		}
+	}
+	menu_watch.has_dead = False;
+}
+
+static void menuSourceDestroyed(WMenu *menu)
+{
+	MenuSource *source = findMenuSource(menu);
 
-		addMenuEntry(menu, M_(data->name), NULL, "OPEN_MENU", buffer, path[data->index]);
+	removeShortcutsForMenu(menu);
 
-		wfree(buffer);
-		wfree(data->name);
-		wfree(data);
+	if (source) {
+		releaseWatches(source);
+		source->menu = NULL;
+		menu_watch.has_dead = True;
 	}
+}
 
-	WM_ITERATE_ARRAY(files, data, iter) {
-		/* executable: add as entry */
-		length = strlen(path[data->index]) + strlen(data->name) + 6;
-		if (command)
-			length += strlen(command);
+/* Go back to checking the time stamps of the files */
+static void stopWatchingMenus(void)
+{
+	MenuSource *source;
+	WMArrayIterator iter;
 
-		buffer = malloc(length);
-		if (!buffer) {
-			werror(_("out of memory while constructing directory menu %s"), path[data->index]);
+	WM_ITERATE_ARRAY(menu_watch.sources, source, iter) {
+		if (source->menu) {
+			source->menu->on_destroy = removeShortcutsForMenu;
+			source->menu = NULL;
+		}
+	}
+	menu_watch.has_dead = True;
+	freeDeadSources();
+
+	if (menu_watch.handler) {
+		WMDeleteInputHandler(menu_watch.handler);
+		menu_watch.handler = NULL;
+	}
+	close(menu_watch.fd);
+	menu_watch.fd = -1;
+	menu_watch.failed = True;
+}
+
+/* Insert or remove the entry for the file 'name' of the directory 'index' */
+static void updateDirectoryMenu(MenuSource *source, int index, const char *name, uint32_t mask)
+{
+	WMenu *menu = source->menu;
+	dir_data *data;
+	int i, pos, kind;
+	Bool changed = False;
+
+	pos = -1;
+	for (i = 0; i < WMGetArrayItemCount(source->items); i++) {
+		data = WMGetFromArray(source->items, i);
+		if (data->index == index && strcmp(data->name, name) == 0) {
+			pos = i;
 			break;
 		}
+	}
 
-		have_space = strchr(path[data->index], ' ') != NULL || strchr(data->name, ' ') != NULL;
-		if (command != NULL) {
-			strcpy(buffer, command);
-			strcat(buffer, " ");
-			if (have_space)
-				strcat(buffer, "\"");
-			strcat(buffer, path[data->index]);
+	kind = DIR_ENTRY_NONE;
+	if (mask & (IN_CREATE | IN_MOVED_TO | IN_ATTRIB))
+		kind = classifyDirectoryEntry(source->path[index], name, source->command);
+
+	if (pos >= 0) {
+		data = WMGetFromArray(source->items, pos);
+		if (kind != DIR_ENTRY_NONE && data->is_dir == (kind == DIR_ENTRY_MENU))
+			return;
+
+		if (kind == DIR_ENTRY_NONE && menu->entry_no == 1) {
+			/* An empty menu cannot be shown, let constructMenu decide */
+			source->stale = True;
+			return;
+		}
+		wMenuRemoveItem(menu, pos);
+		WMDeleteFromArray(source->items, pos);
+		changed = True;
+	}
+
+	if (kind != DIR_ENTRY_NONE) {
+		data = wmalloc(sizeof(dir_data));
+		data->name = wstrdup(name);
+		data->index = index;
+		data->is_dir = (kind == DIR_ENTRY_MENU);
+
+		for (pos = 0; pos < WMGetArrayItemCount(source->items); pos++)
+			if (compareDirData(data, WMGetFromArray(source->items, pos)) < 0)
+				break;
+
+		if (addDirectoryEntry(menu, pos, source->path, data, source->command,
+				      source->strip_extension)) {
+			WMInsertInArray(source->items, pos, data);
+			changed = True;
 		} else {
-			if (have_space) {
-				buffer[0] = '"';
-				buffer[1] = 0;
-				strcat(buffer, path[data->index]);
-			} else {
-				strcpy(buffer, path[data->index]);
+			freeDirData(data);
+			source->stale = True;
+		}
+	}
+
+	if (changed)
+		wMenuRealize(menu);
+}
+
+static void handleMenuEvent(struct inotify_event *event)
+{
+	MenuSource *source;
+	int i, j;
+
+	for (i = 0; i < WMGetArrayItemCount(menu_watch.sources); i++) {
+		source = WMGetFromArray(menu_watch.sources, i);
+		if (!source->menu)
+			continue;
+
+		if (event->mask & IN_Q_OVERFLOW) {
+			/* Events were lost, we do not know what changed */
+			source->stale = True;
+			continue;
+		}
+
+		for (j = 0; source->path[j] != NULL; j++) {
+			if (source->wd[j] != event->wd)
+				continue;
+
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) {
+				/* Replaced by an editor, or removed */
+				source->stale = True;
+				if (event->mask & IN_IGNORED)
+					source->wd[j] = -1;
+			} else if (!source->directory) {
+				source->stale = True;
+			} else if (event->len > 0 && !source->stale) {
+				updateDirectoryMenu(source, j, event->name, event->mask);
 			}
+
+			/* The source may have been destroyed with an entry */
+			if (!source->menu)
+				break;
 		}
-		strcat(buffer, "/");
-		strcat(buffer, data->name);
-		if (have_space)
-			strcat(buffer, "\"");
+	}
+}
+
+static void handleMenuEvents(int fd, int mask, void *data)
+{
+	/* Make room for a few events at once, with their file names */
+	char buff[(sizeof(struct inotify_event) + NAME_MAX + 1) * 8];
+	ssize_t length;
+	size_t i;
+
+	/* Called by WINGs when there is something to read */
+	(void) mask;
+	(void) data;
+
+	length = read(fd, buff, sizeof(buff));
+	if (length < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		wwarning(_("read problem when trying to get the inotify events of the menus: %s"),
+			 strerror(errno));
+		stopWatchingMenus();
+		return;
+	}
+
+	for (i = 0; i < length; i += sizeof(struct inotify_event) + ((struct inotify_event *) &buff[i])->len)
+		handleMenuEvent((struct inotify_event *) &buff[i]);
+
+	freeDeadSources();
+}
+
+/*
+ * Watch the files or directories in 'path' that 'menu' was read from. For a
+ * directory menu, 'items' is the list of its entries and is kept by the
+ * source; the menu is not watched if any of the paths cannot be
+ */
+static void watchMenu(WMenu *menu, char **path, const char *command, Bool directory, WMArray *items)
+{
+	MenuSource *source;
+	int i, count;
 
-		if (stripExtension) {
-			char *ptr = strrchr(data->name, '.');
-			if (ptr && ptr != data->name)
-				*ptr = 0;
+	if (menu_watch.fd < 0 && !menu_watch.failed) {
+		menu_watch.fd = inotify_init();
+		if (menu_watch.fd < 0) {
+			wwarning(_("could not initialise an inotify instance for the menus: %s"), strerror(errno));
+			menu_watch.failed = True;
+		} else {
+			/* Not for the programs started from the menu */
+			(void) fcntl(menu_watch.fd, F_SETFD, FD_CLOEXEC);
+			menu_watch.handler = WMAddInputHandler(menu_watch.fd, WIReadMask, handleMenuEvents, NULL);
+			menu_watch.sources = WMCreateArray(8);
 		}
-		addMenuEntry(menu, M_(data->name), NULL, "SHEXEC", buffer, path[data->index]);
+	}
+	if (menu_watch.fd < 0) {
+		if (items)
+			WMFreeArray(items);
+		return;
+	}
+
+	freeDeadSources();
+
+	for (count = 0; path[count] != NULL; count++)
+		;
+
+	source = wmalloc(sizeof(MenuSource));
+	source->menu = menu;
+	source->path = wmalloc((count + 1) * sizeof(char *));
+	source->wd = wmalloc((count + 1) * sizeof(int));
+	source->directory = directory;
+	source->command = command ? wstrdup(command) : NULL;
+	source->items = items;
 
-		wfree(buffer);
-		wfree(data->name);
-		wfree(data);
+	for (i = 0; i < count; i++) {
+		source->path[i] = wstrdup(path[i]);
+		source->wd[i] = -1;
+
+		if (strcmp(path[i], "-noext") == 0) {
+			source->strip_extension = 1;
+			continue;
+		}
+
+		source->wd[i] = inotify_add_watch(menu_watch.fd, path[i],
+						  directory ? MENU_DIRECTORY_EVENTS : MENU_FILE_EVENTS);
+		if (source->wd[i] < 0) {
+			/* Not there, or too many watches: check the time stamps instead */
+			source->path[i + 1] = NULL;
+			releaseWatches(source);
+			freeMenuSource(source);
+			return;
+		}
 	}
 
-	WMFreeArray(files);
-	WMFreeArray(dirs);
+	menu->on_destroy = menuSourceDestroyed;
+	WMAddToArray(menu_watch.sources, source);
+}
 
-	return menu;
+#else /* HAVE_INOTIFY */
+
+static void watchMenu(WMenu *menu, char **path, const char *command, Bool directory, WMArray *items)
+{
+	(void) menu;
+	(void) path;
+	(void) command;
+	(void) directory;
+
+	if (items)
+		WMFreeArray(items);
 }
 
+static Bool menuIsUpToDate(WMenu *menu)
+{
+	(void) menu;
+	return False;
+}
+
+static Bool menuIsWatched(WMenu *menu)
+{
+	(void) menu;
+	return False;
+}
+
+#endif /* HAVE_INOTIFY */
+
 /************  Menu Configuration From WMRootMenu   *************/
 
 static WMenu *makeDefaultMenu(WScreen * scr)
@@ -1432,6 +1876,11 @@ WMenu *configureMenu(WScreen *scr, WMPropList *definition)
 		char *path = NULL;
 		Bool menu_is_default = False;
 
+		/* Neither the file nor the pointer to it in WMRootMenu changed */
+		if (scr->root_menu && menuIsUpToDate(scr->root_menu)
+		    && w_global.domain.root_menu->timestamp <= scr->root_menu->timestamp)
+			return NULL;
+
 		/* menu definition is a string. Probably a path, so parse the file */
 
 		tmp = wexpandpath(WMGetFromPLString(definition));
@@ -1478,8 +1927,12 @@ WMenu *configureMenu(WScreen *scr, WMPropList *definition)
 				WMReleasePropList(menu_from_file);
 			}
 
-			if (menu)
+			if (menu) {
+				char *files[2] = { path, NULL };
+
 				menu->timestamp = WMAX(stat_buf.st_mtime, w_global.domain.root_menu->timestamp);
+				watchMenu(menu, files, NULL, False, NULL);
+			}
 		} else {
 			menu = NULL;
 		}
@@ -1547,7 +2000,7 @@ WMenu *configureMenu(WScreen *scr, WMPropList *definition)
 			if (!title || !command)
 				goto error;
 
-			addMenuEntry(menu, M_(WMGetFromPLString(title)),
+			addMenuEntry(menu, -1, M_(WMGetFromPLString(title)),
 				     shortcut ? WMGetFromPLString(shortcut) : NULL,
 				     WMGetFromPLString(command),
 				     params ? WMGetFromPLString(params) : NULL, "WMRootMenu");
@@ -51,6 +51,10 @@
 #include "actions.h"
 #include "properties.h"
 #include "dock.h"
+#include "iconprefetch.h"
+#include "worker.h"
+#include "persist.h"
+#include "trace.h"
 #include "resources.h"
 #include "workspace.h"
 #include "session.h"
@@ -61,6 +65,7 @@
 #include "misc.h"
 
 #include "xinerama.h"
+#include "spatial.h"
 
 #include <WINGs/WUtil.h>
 #include <WINGs/WINGsP.h>
@@ -632,6 +637,7 @@ WScreen *wScreenInit(int screen_number)
 	scr->scr_height = HeightOfScreen(ScreenOfDisplay(dpy, screen_number));
 
 	wInitXinerama(scr);
+	wSpatialInit(scr);
 
 	scr->usableArea = (WArea *) wmalloc(sizeof(WArea) * wXineramaHeads(scr));
 	scr->totalUsableArea = (WArea *) wmalloc(sizeof(WArea) * wXineramaHeads(scr));
@@ -916,14 +922,22 @@ void wScreenRestoreState(WScreen * scr)
 	if (!scr->session_state)
 		scr->session_state = WMCreatePLDictionary(NULL, NULL);
 
+	wTraceBegin("wDockPrefetchIcons");
+	wDockPrefetchIcons(scr);
+	wTraceEnd("wDockPrefetchIcons");
+
 	if (!wPreferences.flags.nodock) {
+		wTraceBegin("wDockRestoreState");
 		state = WMGetFromPLDictionary(scr->session_state, dDock);
 		scr->dock = wDockRestoreState(scr, state, WM_DOCK);
+		wTraceEnd("wDockRestoreState");
 	}
 
 	if (!wPreferences.flags.noclip) {
+		wTraceBegin("wClipRestoreState");
 		state = WMGetFromPLDictionary(scr->session_state, dClip);
 		scr->clip_icon = wClipRestoreState(scr, state);
+		wTraceEnd("wClipRestoreState");
 	}
 
 	if (!wPreferences.flags.nodrawer) {
@@ -935,10 +949,18 @@ void wScreenRestoreState(WScreen * scr)
 			RReleaseImage(scr->drawer_tile);
 			scr->drawer_tile = wDrawerMakeTile(scr, scr->icon_tile);
 		}
+		wTraceBegin("wDrawersRestoreState");
 		wDrawersRestoreState(scr);
+		wTraceEnd("wDrawersRestoreState");
 	}
 
+	wTraceBegin("wWorkspaceRestoreState");
 	wWorkspaceRestoreState(scr);
+	wTraceEnd("wWorkspaceRestoreState");
+
+	/* All the docked icons are created now */
+	wIconPrefetchRelease();
+
 	wDockApplyOpacity(scr);
 	wScreenUpdateUsableArea(scr);
 }
@@ -1017,9 +1039,7 @@ void wScreenSaveState(WScreen * scr)
 		snprintf(buf, sizeof(buf), "WMState.%i", scr->screen);
 		str = wdefaultspathfordomain(buf);
 	}
-	if (!WMWritePropListToFile(scr->session_state, str)) {
-		werror(_("could not save session state in %s"), str);
-	}
+	wPersistWrite(str, scr->session_state);
 	wfree(str);
 	WMReleasePropList(old_state);
 }
@@ -1124,7 +1144,10 @@ int wScreenKeepInside(WScreen * scr, int *x, int *y, int width, int height)
 	return moved;
 }
 
-static XImage *imageCaptureArea(WScreen *scr)
+/*
+ * Let the user select an area of the screen with the mouse
+ */
+static Bool imageCaptureArea(WScreen *scr, int *px, int *py, int *pw, int *ph)
 {
 	XEvent event;
 	int quit = 0;
@@ -1136,7 +1159,7 @@ static XImage *imageCaptureArea(WScreen *scr)
 	if (XGrabPointer(dpy, scr->root_win, False, ButtonMotionMask
 			| ButtonReleaseMask | ButtonPressMask, GrabModeAsync,
 			GrabModeAsync, None, wPreferences.cursor[WCUR_CAPTURE], CurrentTime) != Success) {
-		return NULL;
+		return False;
 	}
 
 	XGrabServer(dpy);
@@ -1158,7 +1181,11 @@ static XImage *imageCaptureArea(WScreen *scr)
 					XDrawRectangle(dpy, scr->root_win, scr->frame_gc, x, y, w, h);
 					XUngrabServer(dpy);
 					XUngrabPointer(dpy, CurrentTime);
-					return XGetImage(dpy, scr->root_win, x, y, w, h, AllPlanes, ZPixmap);
+					*px = x;
+					*py = y;
+					*pw = w;
+					*ph = h;
+					return True;
 				}
 			}
 			break;
@@ -1192,7 +1219,7 @@ static XImage *imageCaptureArea(WScreen *scr)
 
 	XUngrabServer(dpy);
 	XUngrabPointer(dpy, CurrentTime);
-	return NULL;
+	return False;
 }
 
 static void hideMiniScreenshot(void *data)
@@ -1235,6 +1262,123 @@ static void showMiniScreenshot(WScreen *scr, RImage *img)
 	scr->mini_screenshot_timer = WMAddTimerHandler(WORKSPACE_NAME_FADE_DELAY, hideMiniScreenshot, scr);
 }
 
+/* Number of screenshots that can wait to be written before we block */
+#define SCREENSHOT_QUEUE_SIZE	4
+
+/*
+ * Screenshots are big and taken to be looked at later, so writing them
+ * quickly matters more than the last bytes of the file
+ */
+#define SCREENSHOT_COMPRESSION	1
+
+typedef struct ScreenshotJob {
+	WScreen *scr;
+	RImage *image;
+	char *filepath;
+	const char *format;
+
+	/* Set once the file is written */
+	Bool saved;
+	int error;
+	RImage *thumbnail;
+
+	struct ScreenshotJob *next;
+} ScreenshotJob;
+
+/*
+ * Screenshots given to the worker thread and not reported as saved yet; their
+ * file may not exist yet but the name is taken
+ */
+static ScreenshotJob *pending_screenshots = NULL;
+static int pending_screenshot_count = 0;
+
+/* Called in the worker thread */
+static void saveScreenshot(void *data)
+{
+	ScreenshotJob *job = data;
+
+	job->saved = RSaveCompressedImage(job->image, job->filepath, job->format,
+	                                  "Screenshot from Window Maker", SCREENSHOT_COMPRESSION);
+	if (job->saved)
+		job->thumbnail = RSmoothScaleImage(job->image, job->scr->scr_width / 10, job->scr->scr_height / 10);
+	else
+		job->error = RErrorCode;
+}
+
+static void finishScreenshot(void *data)
+{
+	ScreenshotJob *job = data;
+	ScreenshotJob **ptr;
+
+	for (ptr = &pending_screenshots; *ptr; ptr = &(*ptr)->next) {
+		if (*ptr == job) {
+			*ptr = job->next;
+			break;
+		}
+	}
+	pending_screenshot_count--;
+
+	if (job->saved) {
+		if (job->thumbnail) {
+			showMiniScreenshot(job->scr, job->thumbnail);
+			RReleaseImage(job->thumbnail);
+		}
+#ifdef DEBUG
+		wmessage("screenshot filepath: %s", job->filepath);
+#endif
+	} else {
+		werror(_("could not save screenshot \"%s\": %s"), job->filepath, RMessageForError(job->error));
+	}
+
+	RReleaseImage(job->image);
+	wfree(job->filepath);
+	wfree(job);
+}
+
+/*
+ * The encoding and the writing of the file are done in the background, so
+ * the user can go on while it happens
+ */
+static void queueScreenshot(ScreenshotJob *job)
+{
+	/* Each waiting screenshot is a full copy of the screen, do not pile them up */
+	if (pending_screenshot_count >= SCREENSHOT_QUEUE_SIZE)
+		wWorkerFlush();
+
+	job->next = pending_screenshots;
+	pending_screenshots = job;
+	pending_screenshot_count++;
+
+	wWorkerRun(saveScreenshot, finishScreenshot, job);
+}
+
+static Bool isScreenshotPending(const char *filepath)
+{
+	ScreenshotJob *job;
+
+	for (job = pending_screenshots; job; job = job->next)
+		if (strcmp(job->filepath, filepath) == 0)
+			return True;
+
+	return False;
+}
+
+static RImage *captureArea(WScreen *scr, int x, int y, unsigned int width, unsigned int height)
+{
+	RXImage *ximg;
+	RImage *img;
+
+	/* Goes through shared memory when possible */
+	ximg = RGetXImage(scr->rcontext, scr->root_win, x, y, width, height);
+	if (!ximg)
+		return NULL;
+
+	img = RCreateImageFromXImage(scr->rcontext, ximg->image, None);
+	RDestroyXImage(scr->rcontext, ximg);
+
+	return img;
+}
+
 void ScreenCapture(WScreen *scr, int mode)
 {
 	time_t s;
@@ -1246,7 +1390,7 @@ void ScreenCapture(WScreen *scr, int mode)
 	char *filepath;
 	char *screenshot_dir;
 	RImage *img = NULL;
-	RImage *scale_img = NULL;
+	ScreenshotJob *job;
 
 #ifdef USE_PNG
 	char *filetype = ".png";
@@ -1275,8 +1419,9 @@ void ScreenCapture(WScreen *scr, int mode)
 	strftime(filename_date_part, sizeof(filename_date_part), "screenshot_%Y-%m-%d_at_%H:%M:%S", tm_info);
 	strcpy(filename, filename_date_part);
 
+	/* the file of a screenshot still being saved may not exist yet */
 	filepath = wstrconcat(screenshot_dir, strcat(filename, filetype));
-	while (access(filepath, F_OK) == 0 && i < 600) {
+	while ((access(filepath, F_OK) == 0 || isScreenshotPending(filepath)) && i < 600) {
 		i++;
 		strcpy(filename, filename_date_part);
 		sprintf(index_str, "_%d", i);
@@ -1295,7 +1440,7 @@ void ScreenCapture(WScreen *scr, int mode)
 
 	switch (mode) {
 		WWindow *wwin;
-		XImage *pimg;
+		int x, y, w, h;
 
 		case PRINT_WINDOW:
 			wwin = scr->focused_window;
@@ -1324,24 +1469,15 @@ void ScreenCapture(WScreen *scr, int mode)
 					if (wwin->client.y + wwin->client.height > scr->scr_height)
 						h_crop = scr->scr_height - wwin->client.y;
 
-					pimg = XGetImage(dpy, scr->root_win, x_crop, y_crop,
+					img = captureArea(scr, x_crop, y_crop,
 							(wwin->client.x > 0)?w_crop:w_crop + wwin->client.x,
-							(wwin->client.y > 0)?h_crop:h_crop + wwin->client.y,
-							AllPlanes, ZPixmap);
-
-					if (pimg) {
-						img = RCreateImageFromXImage(scr->rcontext, pimg, None);
-						XDestroyImage(pimg);
-					}
+							(wwin->client.y > 0)?h_crop:h_crop + wwin->client.y);
 				}
 			}
 			break;
 		case PRINT_PARTIAL:
-			pimg = imageCaptureArea(scr);
-			if (pimg) {
-				img = RCreateImageFromXImage(scr->rcontext, pimg, None);
-				XDestroyImage(pimg);
-			}
+			if (imageCaptureArea(scr, &x, &y, &w, &h))
+				img = captureArea(scr, x, y, w, h);
 			break;
 		default:
 			/* PRINT_SCREEN*/
@@ -1349,16 +1485,14 @@ void ScreenCapture(WScreen *scr, int mode)
 	}
 
 	if (img) {
-		if (RSaveTitledImage(img, filepath, (char *)(filetype + 1), "Screenshot from Window Maker")) {
-			scale_img = RSmoothScaleImage(img, scr->scr_width / 10, scr->scr_height / 10);
-			showMiniScreenshot(scr, scale_img);
-			RReleaseImage(scale_img);
-#ifdef DEBUG
-			wmessage("screenshot filepath: %s", filepath);
-#endif
-		}
-		RReleaseImage(img);
+		job = wmalloc(sizeof(ScreenshotJob));
+		job->scr = scr;
+		job->image = img;
+		job->filepath = filepath;
+		job->format = filetype + 1;
+		queueScreenshot(job);
+	} else {
+		wfree(filepath);
 	}
-	wfree(filepath);
 	wfree(screenshot_dir);
 }
@@ -100,6 +100,15 @@ typedef struct _WScreen {
                                         * another window entered fullscreen
                                         */
 
+    struct {
+        struct WWindow *newest;        /* windows of each workspace, in */
+        struct WWindow *oldest;        /* the order of the focus list */
+    } workspace_windows[MAX_WORKSPACES];
+    long focus_serial_newest;          /* focus_serial of both ends of */
+    long focus_serial_oldest;          /* the focus list */
+
+    struct WSpatialGrid *spatial_grid; /* windows by position, see spatial.h */
+
     WMArray *selected_windows;
 
     WMArray *fakeGroupLeaders;         /* list of fake window group ids */
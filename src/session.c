@@ -82,10 +82,32 @@
 #include "appicon.h"
 #include "dock.h"
 #include "misc.h"
+#include "trace.h"
 
 #include <WINGs/WUtil.h>
 
 
+/*
+ * Time after which an application of the session whose window did not
+ * show up no longer counts in the launch limit, in ms
+ */
+#define SESSION_LAUNCH_TIMEOUT	10000
+
+typedef struct SessionLaunch {
+	WScreen *scr;
+	char *command;
+	char *instance;
+	char *class;
+	WSavedState *state;
+
+	pid_t pid;
+	WMHandlerID timer;
+} SessionLaunch;
+
+static WMArray *pending_launches = NULL;	/* not started yet */
+static WMArray *running_launches = NULL;	/* started, waiting for their window */
+
+
 static WMPropList *sApplications = NULL;
 static WMPropList *sCommand;
 static WMPropList *sName;
@@ -470,12 +492,110 @@ static inline int is_same(const char *x, const char *y)
 		return 0;
 }
 
+/*
+ * The applications of the session are launched a few at a time, to not
+ * have them all compete for the machine: the next one is started when the
+ * window of one shows up, it exits, or it took too long
+ */
+
+static void queueLaunch(WScreen *scr, char *command, char *instance, char *class, WSavedState *state)
+{
+	SessionLaunch *launch;
+
+	launch = wmalloc(sizeof(SessionLaunch));
+	launch->scr = scr;
+	launch->command = wstrdup(command);
+	launch->instance = instance;
+	launch->class = class;
+	launch->state = state;
+
+	if (!pending_launches) {
+		pending_launches = WMCreateArray(16);
+		running_launches = WMCreateArray(16);
+	}
+	WMAddToArray(pending_launches, launch);
+}
+
+static void launchNextApplications(void);
+
+static void finishLaunch(SessionLaunch *launch)
+{
+	WMRemoveFromArray(running_launches, launch);
+	if (launch->timer)
+		WMDeleteTimerHandler(launch->timer);
+	wfree(launch);
+
+	launchNextApplications();
+}
+
+static void launchTimeout(void *data)
+{
+	SessionLaunch *launch = data;
+
+	launch->timer = NULL;
+	finishLaunch(launch);
+}
+
+static void launchNextApplications(void)
+{
+	SessionLaunch *launch;
+
+	if (!pending_launches)
+		return;
+
+	while (WMGetArrayItemCount(pending_launches) > 0) {
+		if (wPreferences.session_launch_limit > 0 &&
+		    WMGetArrayItemCount(running_launches) >= wPreferences.session_launch_limit)
+			break;
+
+		launch = WMGetFromArray(pending_launches, 0);
+		WMDeleteFromArray(pending_launches, 0);
+
+		launch->pid = execCommand(launch->scr, launch->command);
+		if (launch->pid > 0) {
+			wWindowAddSavedState(launch->instance, launch->class, launch->command,
+					     launch->pid, launch->state);
+			launch->timer = WMAddTimerHandler(SESSION_LAUNCH_TIMEOUT, launchTimeout, launch);
+			WMAddToArray(running_launches, launch);
+		} else {
+			wfree(launch->state);
+		}
+
+		wfree(launch->command);
+		if (launch->instance)
+			wfree(launch->instance);
+		if (launch->class)
+			wfree(launch->class);
+		if (launch->pid <= 0)
+			wfree(launch);
+	}
+
+	wTraceCounter("session pending", "count", WMGetArrayItemCount(pending_launches));
+	wTraceCounter("session starting", "count", WMGetArrayItemCount(running_launches));
+}
+
+/* The window of an application was matched with its state, or it exited */
+void wSessionLaunchFinished(pid_t pid)
+{
+	SessionLaunch *launch;
+	WMArrayIterator iter;
+
+	if (!running_launches)
+		return;
+
+	WM_ITERATE_ARRAY(running_launches, launch, iter) {
+		if (launch->pid == pid) {
+			finishLaunch(launch);
+			return;
+		}
+	}
+}
+
 void wSessionRestoreState(WScreen *scr)
 {
 	WSavedState *state;
 	char *instance, *class, *command;
 	WMPropList *win_info, *apps, *cmd, *value;
-	pid_t pid;
 	int i, count;
 	WDock *dock;
 	WAppIcon *btn = NULL;
@@ -568,19 +688,19 @@ void wSessionRestoreState(WScreen *scr)
 
 		if (found) {
 			wDockLaunchWithState(btn, state);
-		} else if ((pid = execCommand(scr, command)) > 0) {
-			wWindowAddSavedState(instance, class, command, pid, state);
+
+			if (instance)
+				wfree(instance);
+			if (class)
+				wfree(class);
 		} else {
-			wfree(state);
+			queueLaunch(scr, command, instance, class, state);
 		}
-
-		if (instance)
-			wfree(instance);
-		if (class)
-			wfree(class);
 	}
 	/* clean up */
 	WMPLSetCaseSensitive(False);
+
+	launchNextApplications();
 }
 
 void wSessionRestoreLastWorkspace(WScreen * scr)
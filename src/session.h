@@ -26,4 +26,5 @@ void wSessionSaveState(WScreen *scr);
 void wSessionClearState(WScreen *scr);
 void wSessionRestoreState(WScreen *scr);
 void wSessionRestoreLastWorkspace(WScreen *scr);
+void wSessionLaunchFinished(pid_t pid);
 #endif
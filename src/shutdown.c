@@ -37,6 +37,8 @@
 #include "wmspec.h"
 #include "colormap.h"
 #include "shutdown.h"
+#include "worker.h"
+#include "persist.h"
 
 
 static void wipeDesktop(WScreen * scr);
@@ -55,6 +57,9 @@ void Shutdown(WShutdownMode mode)
 {
 	int i;
 
+	/* Do not lose what is being done in the background, like screenshots */
+	wWorkerFlush();
+
 	switch (mode) {
 	case WSLogoutMode:
 	case WSKillMode:
@@ -62,6 +67,10 @@ void Shutdown(WShutdownMode mode)
 		/* if there is no session manager, send SAVE_YOURSELF to
 		 * the clients */
 #ifdef HAVE_INOTIFY
+		if (w_global.inotify.handler) {
+			WMDeleteInputHandler(w_global.inotify.handler);
+			w_global.inotify.handler = NULL;
+		}
 		if (w_global.inotify.fd_event_queue >= 0) {
 			close(w_global.inotify.fd_event_queue);
 			w_global.inotify.fd_event_queue = -1;
@@ -83,6 +92,7 @@ void Shutdown(WShutdownMode mode)
 					RestoreDesktop(scr);
 			}
 		}
+		wPersistFlush();
 		ExecExitScript();
 		Exit(0);
 		break;
@@ -92,6 +102,10 @@ void Shutdown(WShutdownMode mode)
 			WScreen *scr;
 
 #ifdef HAVE_INOTIFY
+			if (w_global.inotify.handler) {
+				WMDeleteInputHandler(w_global.inotify.handler);
+				w_global.inotify.handler = NULL;
+			}
 			if (w_global.inotify.fd_event_queue >= 0) {
 				close(w_global.inotify.fd_event_queue);
 				w_global.inotify.fd_event_queue = -1;
@@ -105,6 +119,7 @@ void Shutdown(WShutdownMode mode)
 				RestoreDesktop(scr);
 			}
 		}
+		wPersistFlush();
 		break;
 	}
 }
@@ -0,0 +1,282 @@
+/* spatial.c - index of the windows by position on the screen
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "window.h"
+#include "framewin.h"
+#include "spatial.h"
+
+
+/*
+ * The screen is cut in a grid of cells, each one knowing the windows whose
+ * frame covers it; the parts of the frames out of the screen are counted
+ * in the cells of the border, so any window can be found
+ */
+#define SPATIAL_CELL_SIZE	128
+
+/*
+ * The windows of each workspace are also kept sorted by the position of
+ * each of their edges, for the edge resistance and attraction
+ */
+typedef struct WEdgeList {
+	int *positions;
+	WWindow **windows;
+	int count;
+	int size;
+} WEdgeList;
+
+typedef struct WSpatialGrid {
+	int columns;
+	int rows;
+	WMArray **cells;	/* columns * rows, created when first used */
+
+	unsigned int stamp;	/* to report each window once per search */
+
+	WEdgeList edges[MAX_WORKSPACES][WEDGE_COUNT];
+} WSpatialGrid;
+
+
+static void getCellRange(WSpatialGrid *grid, int x, int y, int width, int height,
+			 int *x1, int *y1, int *x2, int *y2)
+{
+	if (width < 1)
+		width = 1;
+	if (height < 1)
+		height = 1;
+
+	*x1 = WMIN(WMAX(x / SPATIAL_CELL_SIZE, 0), grid->columns - 1);
+	*y1 = WMIN(WMAX(y / SPATIAL_CELL_SIZE, 0), grid->rows - 1);
+	*x2 = WMIN(WMAX((x + width - 1) / SPATIAL_CELL_SIZE, 0), grid->columns - 1);
+	*y2 = WMIN(WMAX((y + height - 1) / SPATIAL_CELL_SIZE, 0), grid->rows - 1);
+}
+
+void wSpatialInit(WScreen *scr)
+{
+	WSpatialGrid *grid;
+
+	grid = wmalloc(sizeof(WSpatialGrid));
+	grid->columns = (scr->scr_width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	grid->rows = (scr->scr_height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	if (grid->columns < 1)
+		grid->columns = 1;
+	if (grid->rows < 1)
+		grid->rows = 1;
+	grid->cells = wmalloc(grid->columns * grid->rows * sizeof(WMArray *));
+
+	scr->spatial_grid = grid;
+}
+
+static void removeFromCells(WSpatialGrid *grid, WWindow *wwin)
+{
+	int i, j;
+
+	for (j = wwin->spatial.y1; j <= wwin->spatial.y2; j++) {
+		for (i = wwin->spatial.x1; i <= wwin->spatial.x2; i++)
+			WMRemoveFromArray(grid->cells[j * grid->columns + i], wwin);
+	}
+	wwin->spatial.indexed = False;
+}
+
+/* Index of the first edge not before 'position' */
+static int findEdge(WEdgeList *list, int position)
+{
+	int low, high, middle;
+
+	low = 0;
+	high = list->count;
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (list->positions[middle] < position)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static void removeEdge(WEdgeList *list, WWindow *wwin, int position)
+{
+	int i;
+
+	for (i = findEdge(list, position); i < list->count; i++) {
+		if (list->windows[i] == wwin)
+			break;
+	}
+	if (i == list->count)
+		return;
+
+	list->count--;
+	memmove(&list->positions[i], &list->positions[i + 1], (list->count - i) * sizeof(int));
+	memmove(&list->windows[i], &list->windows[i + 1], (list->count - i) * sizeof(WWindow *));
+}
+
+static void insertEdge(WEdgeList *list, WWindow *wwin, int position)
+{
+	int i;
+
+	if (list->count == list->size) {
+		list->size = list->size ? list->size * 2 : 16;
+		list->positions = wrealloc(list->positions, list->size * sizeof(int));
+		list->windows = wrealloc(list->windows, list->size * sizeof(WWindow *));
+	}
+
+	i = findEdge(list, position);
+	memmove(&list->positions[i + 1], &list->positions[i], (list->count - i) * sizeof(int));
+	memmove(&list->windows[i + 1], &list->windows[i], (list->count - i) * sizeof(WWindow *));
+	list->positions[i] = position;
+	list->windows[i] = wwin;
+	list->count++;
+}
+
+static void removeFromEdges(WSpatialGrid *grid, WWindow *wwin)
+{
+	int i;
+
+	for (i = 0; i < WEDGE_COUNT; i++)
+		removeEdge(&grid->edges[wwin->spatial.workspace][i], wwin, wwin->spatial.edges[i]);
+}
+
+static void updateEdges(WSpatialGrid *grid, WWindow *wwin)
+{
+	int workspace = wwin->frame->workspace;
+	int edges[WEDGE_COUNT];
+	int i;
+
+	if (workspace < 0 || workspace >= MAX_WORKSPACES)
+		return;
+
+	edges[WEDGE_TOP] = WTOP(wwin);
+	edges[WEDGE_LEFT] = WLEFT(wwin);
+	edges[WEDGE_RIGHT] = WRIGHT(wwin);
+	edges[WEDGE_BOTTOM] = WBOTTOM(wwin);
+
+	for (i = 0; i < WEDGE_COUNT; i++) {
+		if (wwin->spatial.indexed && wwin->spatial.workspace == workspace &&
+		    wwin->spatial.edges[i] == edges[i])
+			continue;
+
+		if (wwin->spatial.indexed)
+			removeEdge(&grid->edges[wwin->spatial.workspace][i], wwin, wwin->spatial.edges[i]);
+		insertEdge(&grid->edges[workspace][i], wwin, edges[i]);
+		wwin->spatial.edges[i] = edges[i];
+	}
+	wwin->spatial.workspace = workspace;
+}
+
+void wSpatialUpdate(WWindow *wwin)
+{
+	WSpatialGrid *grid = wwin->screen_ptr->spatial_grid;
+	int x1, y1, x2, y2;
+	int i, j;
+
+	if (!grid || !wwin->frame)
+		return;
+
+	updateEdges(grid, wwin);
+
+	getCellRange(grid, wwin->frame_x, wwin->frame_y,
+		     wwin->frame->core->width, wwin->frame->core->height, &x1, &y1, &x2, &y2);
+
+	if (wwin->spatial.indexed) {
+		/* Most moves stay in the same cells */
+		if (x1 == wwin->spatial.x1 && y1 == wwin->spatial.y1 &&
+		    x2 == wwin->spatial.x2 && y2 == wwin->spatial.y2)
+			return;
+
+		removeFromCells(grid, wwin);
+	}
+
+	for (j = y1; j <= y2; j++) {
+		for (i = x1; i <= x2; i++) {
+			WMArray **cell = &grid->cells[j * grid->columns + i];
+
+			if (!*cell)
+				*cell = WMCreateArray(4);
+			WMAddToArray(*cell, wwin);
+		}
+	}
+
+	wwin->spatial.x1 = x1;
+	wwin->spatial.y1 = y1;
+	wwin->spatial.x2 = x2;
+	wwin->spatial.y2 = y2;
+	wwin->spatial.indexed = True;
+}
+
+void wSpatialRemove(WWindow *wwin)
+{
+	WSpatialGrid *grid = wwin->screen_ptr->spatial_grid;
+
+	if (grid && wwin->spatial.indexed) {
+		removeFromEdges(grid, wwin);
+		removeFromCells(grid, wwin);
+	}
+}
+
+WWindow **wSpatialSortedWindows(WScreen *scr, int workspace, int edge, int *count)
+{
+	WEdgeList *list = &scr->spatial_grid->edges[workspace][edge];
+
+	*count = list->count;
+	return list->windows;
+}
+
+Bool wSpatialForEachWindow(WScreen *scr, int x, int y, int width, int height,
+			   WSpatialProc *proc, void *data)
+{
+	WSpatialGrid *grid = scr->spatial_grid;
+	WMArrayIterator iter;
+	WWindow *wwin;
+	int x1, y1, x2, y2;
+	int i, j;
+
+	getCellRange(grid, x, y, width, height, &x1, &y1, &x2, &y2);
+
+	/* A window covering several cells is only reported the first time */
+	grid->stamp++;
+
+	for (j = y1; j <= y2; j++) {
+		for (i = x1; i <= x2; i++) {
+			WMArray *cell = grid->cells[j * grid->columns + i];
+
+			if (!cell)
+				continue;
+
+			WM_ITERATE_ARRAY(cell, wwin, iter) {
+				if (wwin->spatial.stamp == grid->stamp)
+					continue;
+				wwin->spatial.stamp = grid->stamp;
+
+				if ((*proc) (wwin, data))
+					return True;
+			}
+		}
+	}
+
+	return False;
+}
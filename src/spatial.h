@@ -0,0 +1,82 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef WMSPATIAL_H_
+#define WMSPATIAL_H_
+
+/*
+ * Index of the frames of the windows by position on the screen, so the
+ * code looking for the windows in some area only has to check the windows
+ * around it instead of all of them.
+ *
+ * It is updated when the window is configured, moved, shaded or unshaded,
+ * and when its border or the height of its shaded frame changes; it only
+ * has to cover the actual frame: the caller still checks the exact geometry.
+ */
+
+/* True if window currently has a border. This also includes borderless
+ * windows which are currently selected
+ */
+#define HAS_BORDER_WITH_SELECT(w) ((w)->flags.selected || HAS_BORDER(w))
+
+/* Position of the edges of the frame, border included */
+#define WTOP(w) (w)->frame_y
+#define WLEFT(w) (w)->frame_x
+#define WRIGHT(w) ((w)->frame_x + (int)(w)->frame->core->width - 1 + \
+    (HAS_BORDER_WITH_SELECT(w) ? 2*(w)->screen_ptr->frame_border_width : 0))
+#define WBOTTOM(w) ((w)->frame_y + (int)(w)->frame->core->height - 1 + \
+    (HAS_BORDER_WITH_SELECT(w) ? 2*(w)->screen_ptr->frame_border_width : 0))
+
+enum {
+	WEDGE_TOP,
+	WEDGE_LEFT,
+	WEDGE_RIGHT,
+	WEDGE_BOTTOM,
+
+	WEDGE_COUNT
+};
+
+/* Return True to stop looking */
+typedef Bool WSpatialProc(struct WWindow *wwin, void *data);
+
+void wSpatialInit(WScreen *scr);
+
+/* The window was moved, resized, changed workspace or border */
+void wSpatialUpdate(struct WWindow *wwin);
+
+void wSpatialRemove(struct WWindow *wwin);
+
+/*
+ * Call 'proc' once for each window whose frame may intersect the area,
+ * in no particular order; return True if 'proc' stopped the search.
+ * The windows must not be moved from 'proc'
+ */
+Bool wSpatialForEachWindow(WScreen *scr, int x, int y, int width, int height,
+			   WSpatialProc *proc, void *data);
+
+/*
+ * Windows of a workspace, sorted by increasing position of one of their
+ * edges (WEDGE_*); the array belongs to the index and is only valid until
+ * a window is changed
+ */
+struct WWindow **wSpatialSortedWindows(WScreen *scr, int workspace, int edge, int *count);
+
+#endif
@@ -50,6 +50,12 @@
 #ifdef USE_RANDR
 #include <X11/extensions/Xrandr.h>
 #endif
+#ifdef USE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
 
 #include "WindowMaker.h"
 #include "GNUstep.h"
@@ -77,6 +83,7 @@
 #endif
 
 #include "xutil.h"
+#include "trace.h"
 #include <WINGs/WUtil.h>
 
 /* for SunOS */
@@ -575,6 +582,7 @@ void StartUp(Bool defaultScreenOnly)
 	WMHookEventHandler(DispatchEvent);
 
 	/* initialize defaults stuff */
+	wTraceBegin("ReadDefaultsDomains");
 	w_global.domain.wmaker = wDefaultsInitDomain("WindowMaker", True);
 	if (!w_global.domain.wmaker->dictionary)
 		wwarning(_("could not read domain \"%s\" from defaults database"), "WindowMaker");
@@ -600,6 +608,7 @@ void StartUp(Bool defaultScreenOnly)
 	w_global.domain.window_attr = wDefaultsInitDomain("WMWindowAttributes", True);
 	if (!w_global.domain.window_attr->dictionary)
 		wwarning(_("could not read domain \"%s\" from defaults database"), "WMWindowAttributes");
+	wTraceEnd("ReadDefaultsDomains");
 
 	XSetErrorHandler((XErrorHandler) catchXError);
 
@@ -612,6 +621,22 @@ void StartUp(Bool defaultScreenOnly)
 	w_global.xext.randr.supported = XRRQueryExtension(dpy, &w_global.xext.randr.event_base, &j);
 #endif
 
+#ifdef USE_XRENDER
+	{
+		int event_base, error_base;
+
+		w_global.xext.render.supported = XRenderQueryExtension(dpy, &event_base, &error_base);
+	}
+#endif
+
+#ifdef USE_XDAMAGE
+	{
+		int error_base;
+
+		w_global.xext.damage.supported = XDamageQueryExtension(dpy, &w_global.xext.damage.event_base, &error_base);
+	}
+#endif
+
 #ifdef KEEP_XKB_LOCK_STATUS
 	w_global.xext.xkb.supported = XkbQueryExtension(dpy, NULL, &w_global.xext.xkb.event_base, NULL, NULL, NULL);
 	if (wPreferences.modelock && !w_global.xext.xkb.supported) {
@@ -642,6 +667,7 @@ void StartUp(Bool defaultScreenOnly)
 
 	/* manage the screens */
 	for (j = 0; j < max; j++) {
+		wTraceBeginArg("wScreenInit", "screen", j);
 		if (defaultScreenOnly || max == 1) {
 			wScreen[w_global.screen_count] = wScreenInit(DefaultScreen(dpy));
 			if (!wScreen[w_global.screen_count]) {
@@ -652,10 +678,12 @@ void StartUp(Bool defaultScreenOnly)
 			wScreen[w_global.screen_count] = wScreenInit(j);
 			if (!wScreen[w_global.screen_count]) {
 				wwarning(_("could not manage screen %i"), j);
+				wTraceEnd("wScreenInit");
 				continue;
 			}
 		}
 		w_global.screen_count++;
+		wTraceEnd("wScreenInit");
 	}
 
 	InitializeSwitchMenu();
@@ -666,22 +694,30 @@ void StartUp(Bool defaultScreenOnly)
 
 		lastDesktop = wNETWMGetCurrentDesktopFromHint(wScreen[j]);
 
+		wTraceBegin("wScreenRestoreState");
 		wScreenRestoreState(wScreen[j]);
+		wTraceEnd("wScreenRestoreState");
 
 		/* manage all windows that were already here before us */
 		if (!wPreferences.flags.nodock && wScreen[j]->dock)
 			wScreen[j]->last_dock = wScreen[j]->dock;
 
+		wTraceBegin("manageAllWindows");
 		manageAllWindows(wScreen[j], wPreferences.flags.restarting == 2);
+		wTraceEnd("manageAllWindows");
 
 		/* restore saved menus */
 		wMenuRestoreState(wScreen[j]);
 
 		/* If we're not restarting, restore session */
-		if (wPreferences.flags.restarting == 0 && !wPreferences.flags.norestore)
+		if (wPreferences.flags.restarting == 0 && !wPreferences.flags.norestore) {
+			wTraceBegin("wSessionRestoreState");
 			wSessionRestoreState(wScreen[j]);
+			wTraceEnd("wSessionRestoreState");
+		}
 
 		if (!wPreferences.flags.noautolaunch) {
+			wTraceBegin("AutoLaunch");
 			/* auto-launch apps */
 			if (!wPreferences.flags.nodock && wScreen[j]->dock) {
 				wScreen[j]->last_dock = wScreen[j]->dock;
@@ -705,6 +741,7 @@ void StartUp(Bool defaultScreenOnly)
 					wDockDoAutoLaunch(dc->adrawer, 0);
 				}
 			}
+			wTraceEnd("AutoLaunch");
 		}
 
 		/* go to workspace where we were before restart */
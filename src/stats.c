@@ -0,0 +1,226 @@
+/* stats.c - counters of the objects created, to track the leaks
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#ifdef USE_XRES
+#include <X11/extensions/XRes.h>
+#endif
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "stats.h"
+
+
+WStatsCounter wStatsCounters[WSTATS_KIND_COUNT];
+
+static const char *const kind_names[WSTATS_KIND_COUNT] = {
+	[WSTATS_ICONS] = "icons",
+	[WSTATS_TEXTURES] = "textures",
+	[WSTATS_MENUS] = "menus",
+	[WSTATS_PIXMAPS] = "pixmaps"
+};
+
+
+static void write_counter(FILE *file, const char *name, unsigned long created, unsigned long freed)
+{
+	fprintf(file, "    \"%s\": { \"created\": %lu, \"freed\": %lu, \"live\": %ld },\n",
+		name, created, freed, (long) (created - freed));
+}
+
+#ifdef USE_XRES
+/*
+ * What the X server holds for us, including the pixmaps that are not
+ * counted above because they are created directly with Xlib
+ */
+static void write_server_stats(FILE *file)
+{
+	WScreen *scr = wScreenWithNumber(0);
+	XResType *types = NULL;
+	unsigned long pixmap_bytes = 0;
+	unsigned int pixmaps = 0, windows = 0;
+	int event_base, error_base, num_types, i;
+
+	if (!scr || !XResQueryExtension(dpy, &event_base, &error_base))
+		return;
+
+	/*
+	 * Any resource we created identifies our client; unlike the newer
+	 * XResQueryClientIds, these two return non-zero on success
+	 */
+	if (!XResQueryClientResources(dpy, scr->info_window, &num_types, &types))
+		return;
+
+	for (i = 0; i < num_types; i++) {
+		if (types[i].resource_type == XA_PIXMAP)
+			pixmaps = types[i].count;
+		else if (types[i].resource_type == XA_WINDOW)
+			windows = types[i].count;
+	}
+	if (types)
+		XFree(types);
+
+	if (!XResQueryClientPixmapBytes(dpy, scr->info_window, &pixmap_bytes))
+		pixmap_bytes = 0;
+
+	fprintf(file, "  \"x_server\": { \"pixmaps\": %u, \"pixmap_bytes\": %lu, \"windows\": %u },\n",
+		pixmaps, pixmap_bytes, windows);
+}
+#endif
+
+void wStatsDump(void)
+{
+	RImageStats images;
+	unsigned long created, freed;
+	char *path;
+	FILE *file;
+	int i;
+
+	path = wstrconcat(wusergnusteppath(), STATS_FILE);
+	if (!wmkdirhier(path) || !(file = fopen(path, "w"))) {
+		werror(_("could not write the statistics in %s: %s"), path, strerror(errno));
+		wfree(path);
+		return;
+	}
+
+	fprintf(file, "{\n  \"pid\": %d,\n  \"objects\": {\n", (int) getpid());
+	for (i = 0; i < WSTATS_KIND_COUNT; i++)
+		write_counter(file, kind_names[i], wStatsCounters[i].created, wStatsCounters[i].freed);
+
+	WMGetPropListStats(&created, &freed);
+	write_counter(file, "proplists", created, freed);
+
+	RGetImageStats(&images);
+	fprintf(file, "    \"images\": { \"live\": %lu }\n  },\n", images.images);
+
+#ifdef USE_XRES
+	write_server_stats(file);
+#endif
+
+	fprintf(file, "  \"image_buffers\": { \"live\": %lu, \"bytes\": %lu, \"peak_bytes\": %lu,"
+		" \"shared_clones\": %lu, \"copies_on_write\": %lu }\n}\n",
+		images.buffers, images.buffer_bytes, images.peak_buffer_bytes,
+		images.shared_clones, images.copies_on_write);
+
+	if (fclose(file) != 0)
+		werror(_("could not write the statistics in %s: %s"), path, strerror(errno));
+	else
+		wmessage(_("statistics written in %s"), path);
+
+	wfree(path);
+}
+
+static int ignoreErrors(Display *display, XErrorEvent *error)
+{
+	(void) display;
+	(void) error;
+
+	return 0;
+}
+
+static Window getNoticeboard(Display *display, Window window, Atom noticeboard)
+{
+	Window result = None;
+	Atom type;
+	int format;
+	unsigned long count, left;
+	unsigned char *data = NULL;
+
+	if (XGetWindowProperty(display, window, noticeboard, 0, 1, False, XA_WINDOW,
+			       &type, &format, &count, &left, &data) == Success && data) {
+		if (type == XA_WINDOW && format == 32 && count == 1)
+			result = *(Window *) data;
+		XFree(data);
+	}
+
+	return result;
+}
+
+/*
+ * Window Maker puts the id of its info window in the noticeboard property of
+ * the root window and of that window; the property of the root window can be
+ * left behind by a crash, so check that the window is still there
+ */
+static Bool isWindowMakerRunning(Display *display)
+{
+	XErrorHandler old_handler;
+	Atom noticeboard;
+	Window info_window;
+	Bool running;
+
+	noticeboard = XInternAtom(display, "_WINDOWMAKER_NOTICEBOARD", True);
+	if (noticeboard == None)
+		return False;
+
+	info_window = getNoticeboard(display, DefaultRootWindow(display), noticeboard);
+	if (info_window == None)
+		return False;
+
+	XSync(display, False);
+	old_handler = XSetErrorHandler(ignoreErrors);
+	running = (getNoticeboard(display, info_window, noticeboard) == info_window);
+	XSync(display, False);
+	XSetErrorHandler(old_handler);
+
+	return running;
+}
+
+Bool wStatsRequestDump(const char *display_name)
+{
+	Display *display;
+	Atom command;
+	XEvent ev;
+
+	display = XOpenDisplay(display_name);
+	if (!display) {
+		werror(_("could not open display \"%s\""), XDisplayName(display_name));
+		return False;
+	}
+
+	command = XInternAtom(display, "_WINDOWMAKER_COMMAND", True);
+	if (command == None || !isWindowMakerRunning(display)) {
+		werror(_("Window Maker is not running on display \"%s\""), XDisplayName(display_name));
+		XCloseDisplay(display);
+		return False;
+	}
+
+	memset(&ev, 0, sizeof(XEvent));
+	ev.xclient.type = ClientMessage;
+	ev.xclient.message_type = command;
+	ev.xclient.window = DefaultRootWindow(display);
+	ev.xclient.format = 8;
+	strncpy(ev.xclient.data.b, "DumpStats", sizeof(ev.xclient.data.b));
+
+	XSendEvent(display, DefaultRootWindow(display), False, SubstructureRedirectMask, &ev);
+	XCloseDisplay(display);
+
+	printf(_("Window Maker will write its statistics in %s%s\n"), wusergnusteppath(), STATS_FILE);
+
+	return True;
+}
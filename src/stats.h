@@ -0,0 +1,61 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMSTATS_H_
+#define WMSTATS_H_
+
+/*
+ * Counters of the objects created and freed, to find what is leaking.
+ *
+ * They are written in JSON by wStatsDump(), which a running wmaker does when
+ * it receives the "DumpStats" _WINDOWMAKER_COMMAND, as sent by
+ * "wmaker --dump-stats".
+ */
+
+/* Where the counters are written, in the user's GNUstep directory */
+#define STATS_FILE	"/.AppInfo/" PACKAGE_TARNAME "/Stats.json"
+
+typedef enum {
+	WSTATS_ICONS,
+	WSTATS_TEXTURES,
+	WSTATS_MENUS,
+	WSTATS_PIXMAPS,
+
+	WSTATS_KIND_COUNT
+} WStatsKind;
+
+typedef struct WStatsCounter {
+	unsigned long created;
+	unsigned long freed;
+} WStatsCounter;
+
+extern WStatsCounter wStatsCounters[WSTATS_KIND_COUNT];
+
+/* Only used from the main thread, so a plain increment is enough */
+#define wStatsCreated(kind)	(wStatsCounters[(kind)].created++)
+#define wStatsFreed(kind)	(wStatsCounters[(kind)].freed++)
+
+/* Write all the counters in the stats file */
+void wStatsDump(void);
+
+/* Ask the wmaker running on the display to write its counters */
+Bool wStatsRequestDump(const char *display_name);
+
+#endif
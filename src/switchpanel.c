@@ -34,6 +34,7 @@
 #include "switchpanel.h"
 #include "misc.h"
 #include "xinerama.h"
+#include "workspace.h"
 
 
 #ifdef USE_XSHAPE
@@ -76,6 +77,38 @@ static short int label_height;
 
 #define ICON_SELECTED (1<<1)
 #define ICON_DIM (1<<2)
+/* Out of the visible part of the strip, the state was not drawn */
+#define ICON_UNDRAWN (1<<3)
+
+/*
+ * The background and the tile only depend on the theme and on the size of
+ * the panel, which are most often the same from one Alt-Tab to the next,
+ * while building them means scaling and maybe blurring big images
+ */
+#define BACK_CACHE_SIZE 4
+
+typedef struct BackCacheEntry {
+	WScreen *scr;
+	int width, height;
+	int blur;
+
+	RImage *image;
+	Pixmap pixmap;
+	Pixmap mask;
+
+	unsigned long last_used;
+} BackCacheEntry;
+
+static struct {
+	BackCacheEntry back[BACK_CACHE_SIZE];
+	unsigned long clock;
+
+	RImage *tile;
+	int tile_size;
+
+	/* Changed when the icons of the windows may have to be loaded again */
+	unsigned int icon_generation;
+} cache;
 
 static int canReceiveFocus(WWindow *wwin)
 {
@@ -109,6 +142,43 @@ static Bool sameWindowClass(WWindow *wwin, WWindow *curwin)
 	return True;
 }
 
+/*
+ * Returns the icon of the window at the size of the panel, which is kept in
+ * the window for the next time as long as the icon does not change
+ */
+static RImage *getWindowIcon(WSwitchPanel *panel, WWindow *wwin)
+{
+	RImage *source = NULL;
+	RImage *image;
+
+	if (!WFLAGP(wwin, always_user_icon) && wwin->net_icon_image)
+		source = wwin->net_icon_image;
+
+	if (wwin->switch_icon.image && wwin->switch_icon.source == source &&
+	    wwin->switch_icon.size == icon_size && wwin->switch_icon.generation == cache.icon_generation)
+		return RRetainImage(wwin->switch_icon.image);
+
+	wSwitchPanelForgetWindow(wwin);
+
+	/* get_icon_image() includes the default icon image */
+	if (source)
+		image = RRetainImage(source);
+	else
+		image = get_icon_image(panel->scr, wwin->wm_instance, wwin->wm_class, icon_tile_size);
+
+	/* We must resize the icon size (~64) to the switch panel icon size (~48) */
+	image = wIconValidateIconSize(image, icon_size);
+	if (!image)
+		return NULL;
+
+	wwin->switch_icon.image = RRetainImage(image);
+	wwin->switch_icon.source = source ? RRetainImage(source) : NULL;
+	wwin->switch_icon.size = icon_size;
+	wwin->switch_icon.generation = cache.icon_generation;
+
+	return image;
+}
+
 static void changeImage(WSwitchPanel *panel, int idecks, int selected, Bool dim, Bool force)
 {
 	WMFrame *icon = NULL;
@@ -121,7 +191,6 @@ static void changeImage(WSwitchPanel *panel, int idecks, int selected, Bool dim,
 		return;
 
 	icon = WMGetFromArray(panel->icons, idecks);
-	image = WMGetFromArray(panel->images, idecks);
 	flags = (int) (uintptr_t) WMGetFromArray(panel->flags, idecks);
 
 	if (selected)
@@ -132,8 +201,20 @@ static void changeImage(WSwitchPanel *panel, int idecks, int selected, Bool dim,
 	if (flags == desired && !force)
 		return;
 
+	/* With many windows most icons are hidden, scrollIcons() draws them when they show up */
+	if (idecks < panel->firstVisible || idecks >= panel->firstVisible + panel->visibleCount) {
+		WMReplaceInArray(panel->flags, idecks, (void *) (uintptr_t) (desired | ICON_UNDRAWN));
+		return;
+	}
+
 	WMReplaceInArray(panel->flags, idecks, (void *) (uintptr_t) desired);
 
+	image = WMGetFromArray(panel->images, idecks);
+	if (!image) {
+		image = getWindowIcon(panel, WMGetFromArray(panel->windows, idecks));
+		WMReplaceInArray(panel->images, idecks, image);
+	}
+
 	if (!panel->bg && !panel->tile && !selected)
 		WMSetFrameRelief(icon, WRFlat);
 
@@ -182,26 +263,16 @@ static void changeImage(WSwitchPanel *panel, int idecks, int selected, Bool dim,
 		WMSetFrameRelief(icon, WRSimple);
 }
 
-static void addIconForWindow(WSwitchPanel *panel, WMWidget *parent, WWindow *wwin, int x, int y)
+static void addIconForWindow(WSwitchPanel *panel, WMWidget *parent, int x, int y)
 {
 	WMFrame *icon = WMCreateFrame(parent);
-	RImage *image = NULL;
 
 	WMSetFrameRelief(icon, WRFlat);
 	WMResizeWidget(icon, icon_tile_size, icon_tile_size);
 	WMMoveWidget(icon, x, y);
 
-	if (!WFLAGP(wwin, always_user_icon) && wwin->net_icon_image)
-		image = RRetainImage(wwin->net_icon_image);
-
-	/* get_icon_image() includes the default icon image */
-	if (!image)
-		image = get_icon_image(panel->scr, wwin->wm_instance, wwin->wm_class, icon_tile_size);
-
-	/* We must resize the icon size (~64) to the switch panel icon size (~48) */
-	image = wIconValidateIconSize(image, icon_size);
-
-	WMAddToArray(panel->images, image);
+	/* The image is only loaded when the icon is drawn */
+	WMAddToArray(panel->images, NULL);
 	WMAddToArray(panel->icons, icon);
 }
 
@@ -285,6 +356,8 @@ static RImage *assemblePuzzleImage(RImage **images, int width, int height)
 
 	/* center */
 	tmp = RSmoothScaleImage(images[4], tw, th);
+	if (wPreferences.switch_panel_blur > 0)
+		RGaussianBlurImage(tmp, wPreferences.switch_panel_blur);
 	RCopyArea(img, tmp, 0, 0, tmp->width, tmp->height, images[0]->width, images[0]->height);
 	RReleaseImage(tmp);
 
@@ -298,23 +371,63 @@ static RImage *assemblePuzzleImage(RImage **images, int width, int height)
 	return img;
 }
 
-static RImage *createBackImage(int width, int height)
+static BackCacheEntry *getBackImage(WScreen *scr, int width, int height)
 {
-	return assemblePuzzleImage(wPreferences.swbackImage, width, height);
+	BackCacheEntry *entry, *oldest;
+	int i;
+
+	oldest = &cache.back[0];
+	for (i = 0; i < BACK_CACHE_SIZE; i++) {
+		entry = &cache.back[i];
+		if (entry->image && entry->scr == scr && entry->width == width &&
+		    entry->height == height && entry->blur == wPreferences.switch_panel_blur) {
+			entry->last_used = ++cache.clock;
+			return entry;
+		}
+		if (!entry->image || (oldest->image && entry->last_used < oldest->last_used))
+			oldest = entry;
+	}
+
+	entry = oldest;
+	if (entry->image) {
+		RReleaseImage(entry->image);
+		if (entry->pixmap)
+			XFreePixmap(dpy, entry->pixmap);
+		if (entry->mask)
+			XFreePixmap(dpy, entry->mask);
+	}
+	memset(entry, 0, sizeof(*entry));
+
+	entry->image = assemblePuzzleImage(wPreferences.swbackImage, width, height);
+	if (!entry->image)
+		return NULL;
+
+	RConvertImageMask(scr->rcontext, entry->image, &entry->pixmap, &entry->mask, 250);
+	entry->scr = scr;
+	entry->width = width;
+	entry->height = height;
+	entry->blur = wPreferences.switch_panel_blur;
+	entry->last_used = ++cache.clock;
+
+	return entry;
 }
 
 static RImage *getTile(void)
 {
-	RImage *stile;
-
 	if (!wPreferences.swtileImage)
 		return NULL;
 
-	stile = RScaleImage(wPreferences.swtileImage, icon_tile_size, icon_tile_size);
-	if (!stile)
-		return wPreferences.swtileImage;
+	if (!cache.tile || cache.tile_size != icon_tile_size) {
+		if (cache.tile)
+			RReleaseImage(cache.tile);
 
-	return stile;
+		cache.tile = RScaleImage(wPreferences.swtileImage, icon_tile_size, icon_tile_size);
+		if (!cache.tile)
+			cache.tile = RRetainImage(wPreferences.swtileImage);
+		cache.tile_size = icon_tile_size;
+	}
+
+	return RRetainImage(cache.tile);
 }
 
 static void drawTitle(WSwitchPanel *panel, int idecks, const char *title)
@@ -361,23 +474,37 @@ static void drawTitle(WSwitchPanel *panel, int idecks, const char *title)
 		free(ntitle);
 }
 
+/* Next window to consider, in the list makeWindowListArray started with */
+static WWindow *nextWindow(WWindow *wwin)
+{
+	if (wPreferences.cycle_all_workspaces)
+		return wwin->prev;
+	return wwin->prev_in_workspace;
+}
+
 static WMArray *makeWindowListArray(WScreen *scr, int include_unmapped, Bool class_only)
 {
 	WMArray *windows = WMCreateArray(10);
-	WWindow *wwin = scr->focused_window;
+	WWindow *wwin;
+
+	/* the other workspaces are filtered out, no need to go through them */
+	if (wPreferences.cycle_all_workspaces)
+		wwin = scr->focused_window;
+	else
+		wwin = scr->workspace_windows[scr->current_workspace].newest;
 
 	while (wwin) {
 		if ((canReceiveFocus(wwin) != 0) &&
 		    (wwin->flags.mapped || wwin->flags.shaded || include_unmapped)) {
 			if (class_only)
 				if (!sameWindowClass(scr->focused_window, wwin)) {
-					wwin = wwin->prev;
+					wwin = nextWindow(wwin);
 					continue;
 				}
 			if (!WFLAGP(wwin, skip_switchpanel))
 				WMAddToArray(windows, wwin);
 		}
-		wwin = wwin->prev;
+		wwin = nextWindow(wwin);
 	}
 	return windows;
 }
@@ -403,9 +530,9 @@ WSwitchPanel *wInitSwitchPanel(WScreen *scr, WWindow *curwin, Bool class_only)
 	border_space = WMScaleY(10);
 	label_height = WMScaleY(25);
 
-	WWindow *wwin;
 	WSwitchPanel *panel = wmalloc(sizeof(WSwitchPanel));
 	WMFrame *viewport;
+	BackCacheEntry *back = NULL;
 	int i, width, height, iconsThatFitCount, count;
 	WMRect rect = wGetRectForHead(scr, wGetHeadForPointerLocation(scr));
 
@@ -438,8 +565,11 @@ WSwitchPanel *wInitSwitchPanel(WScreen *scr, WWindow *curwin, Bool class_only)
 
 	panel->tileTmp = RCreateImage(icon_tile_size, icon_tile_size, 1);
 	panel->tile = getTile();
-	if (panel->tile && wPreferences.swbackImage[8])
-		panel->bg = createBackImage(width + 2 * border_space, height + 2 * border_space);
+	if (panel->tile && wPreferences.swbackImage[8]) {
+		back = getBackImage(scr, width + 2 * border_space, height + 2 * border_space);
+		if (back)
+			panel->bg = RRetainImage(back->image);
+	}
 
 	if (!panel->tileTmp || !panel->tile) {
 		if (panel->bg)
@@ -491,33 +621,23 @@ WSwitchPanel *wInitSwitchPanel(WScreen *scr, WWindow *curwin, Bool class_only)
 	WMResizeWidget(panel->iconBox, icon_tile_size* count, icon_tile_size);
 	WMSetFrameRelief(panel->iconBox, WRFlat);
 
-	WM_ITERATE_ARRAY(panel->windows, wwin, i) {
-		addIconForWindow(panel, panel->iconBox, wwin, i * icon_tile_size, 0);
-	}
+	for (i = 0; i < count; i++)
+		addIconForWindow(panel, panel->iconBox, i * icon_tile_size, 0);
 
 	WMMapSubwidgets(panel->win);
 	WMRealizeWidget(panel->win);
 
-	WM_ITERATE_ARRAY(panel->windows, wwin, i) {
+	for (i = 0; i < count; i++)
 		changeImage(panel, i, 0, False, True);
-	}
 
 	if (panel->bg) {
-		Pixmap pixmap, mask;
-
-		RConvertImageMask(scr->rcontext, panel->bg, &pixmap, &mask, 250);
-
-		XSetWindowBackgroundPixmap(dpy, WMWidgetXID(panel->win), pixmap);
+		/* The pixmaps stay in the cache, the server keeps its own reference for the window */
+		XSetWindowBackgroundPixmap(dpy, WMWidgetXID(panel->win), back->pixmap);
 
 #ifdef USE_XSHAPE
-		if (mask && w_global.xext.shape.supported)
-			XShapeCombineMask(dpy, WMWidgetXID(panel->win), ShapeBounding, 0, 0, mask, ShapeSet);
+		if (back->mask && w_global.xext.shape.supported)
+			XShapeCombineMask(dpy, WMWidgetXID(panel->win), ShapeBounding, 0, 0, back->mask, ShapeSet);
 #endif
-		if (pixmap)
-			XFreePixmap(dpy, pixmap);
-
-		if (mask)
-			XFreePixmap(dpy, mask);
 	}
 
 	{
@@ -733,3 +853,39 @@ Window wSwitchPanelGetWindow(WSwitchPanel *swpanel)
 
 	return WMWidgetXID(swpanel->win);
 }
+
+void wSwitchPanelFlushCache(void)
+{
+	int i;
+
+	for (i = 0; i < BACK_CACHE_SIZE; i++) {
+		BackCacheEntry *entry = &cache.back[i];
+
+		if (!entry->image)
+			continue;
+
+		RReleaseImage(entry->image);
+		if (entry->pixmap)
+			XFreePixmap(dpy, entry->pixmap);
+		if (entry->mask)
+			XFreePixmap(dpy, entry->mask);
+		memset(entry, 0, sizeof(*entry));
+	}
+
+	if (cache.tile)
+		RReleaseImage(cache.tile);
+	cache.tile = NULL;
+
+	/* The windows compare it with the one their icon was made for */
+	cache.icon_generation++;
+}
+
+void wSwitchPanelForgetWindow(WWindow *wwin)
+{
+	if (wwin->switch_icon.image)
+		RReleaseImage(wwin->switch_icon.image);
+	if (wwin->switch_icon.source)
+		RReleaseImage(wwin->switch_icon.source);
+	wwin->switch_icon.image = NULL;
+	wwin->switch_icon.source = NULL;
+}
@@ -34,4 +34,13 @@ WWindow *wSwitchPanelHandleEvent(WSwitchPanel *panel, XEvent *event);
 
 Window wSwitchPanelGetWindow(WSwitchPanel *swpanel);
 
+/*
+ * Forget the images kept from one showing of the panel to the next, to be
+ * called when the switch panel images or the icons of the windows change
+ */
+void wSwitchPanelFlushCache(void);
+
+/* Release the icon cached for the window */
+void wSwitchPanelForgetWindow(WWindow *wwin);
+
 #endif /* _SWITCHPANEL_H_ */
@@ -33,6 +33,8 @@
 #include "texture.h"
 #include "window.h"
 #include "misc.h"
+#include "trace.h"
+#include "stats.h"
 
 
 static void bevelImage(RImage * image, int relief);
@@ -45,6 +47,7 @@ WTexSolid *wTextureMakeSolid(WScreen * scr, XColor * color)
 	XGCValues gcv;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 
 	texture->type = WTEX_SOLID;
 	texture->subtype = 0;
@@ -174,6 +177,7 @@ void wTextureDestroy(WScreen * scr, WTexture * texture)
 		XSetErrorHandler(oldhandler);
 	}
 	XFreeGC(dpy, texture->any.gc);
+	wStatsFreed(WSTATS_TEXTURES);
 	wfree(texture);
 #undef CANFREE
 }
@@ -184,6 +188,7 @@ WTexGradient *wTextureMakeGradient(WScreen *scr, int style, const RColor *from,
 	XGCValues gcv;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 	texture->type = style;
 	texture->subtype = 0;
 
@@ -210,6 +215,7 @@ WTexIGradient *wTextureMakeIGradient(WScreen *scr, int thickness1, const RColor
 	int i;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 	texture->type = WTEX_IGRADIENT;
 	for (i = 0; i < 2; i++) {
 		texture->colors1[i] = colors1[i];
@@ -241,6 +247,7 @@ WTexMGradient *wTextureMakeMGradient(WScreen * scr, int style, RColor ** colors)
 	int i;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 	texture->type = style;
 	texture->subtype = 0;
 
@@ -262,7 +269,7 @@ WTexMGradient *wTextureMakeMGradient(WScreen * scr, int style, RColor ** colors)
 	return texture;
 }
 
-WTexPixmap *wTextureMakePixmap(WScreen *scr, int style, const char *pixmap_file, XColor *color)
+WTexPixmap *wTextureMakePixmap(WScreen *scr, int style, const char *pixmap_file, XColor *color, int blur)
 {
 	WTexPixmap *texture;
 	XGCValues gcv;
@@ -273,6 +280,7 @@ WTexPixmap *wTextureMakePixmap(WScreen *scr, int style, const char *pixmap_file,
 		return NULL;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 	texture->type = WTEX_PIXMAP;
 	texture->subtype = style;
 
@@ -284,6 +292,7 @@ WTexPixmap *wTextureMakePixmap(WScreen *scr, int style, const char *pixmap_file,
 	texture->normal_gc = XCreateGC(dpy, scr->w_win, GCForeground | GCBackground | GCGraphicsExposures, &gcv);
 
 	texture->pixmap = image;
+	texture->blur = (blur > 0) ? blur : 0;
 
 	return texture;
 }
@@ -300,6 +309,7 @@ WTexTGradient *wTextureMakeTGradient(WScreen *scr, int style, const RColor *from
 		return NULL;
 
 	texture = wmalloc(sizeof(WTexture));
+	wStatsCreated(WSTATS_TEXTURES);
 	texture->type = style;
 
 	texture->opacity = opacity;
@@ -349,6 +359,8 @@ RImage *wTextureRenderImage(WTexture * texture, int width, int height, int relie
 	int d;
 	int subtype;
 
+	wTraceBeginArg("wTextureRenderImage", "pixels", (long) width * height);
+
 	switch (texture->any.type) {
 	case WTEX_SOLID:
 		image = RCreateImage(width, height, False);
@@ -373,6 +385,10 @@ RImage *wTextureRenderImage(WTexture * texture, int width, int height, int relie
 		} else {
 			image = RScaleImage(texture->pixmap.pixmap, width, height);
 		}
+
+		/* blur is applied after scaling, so the radius is in screen pixels */
+		if (image && texture->pixmap.blur > 0)
+			RGaussianBlurImage(image, texture->pixmap.blur);
 		break;
 
 	case WTEX_IGRADIENT:
@@ -456,6 +472,7 @@ RImage *wTextureRenderImage(WTexture * texture, int width, int height, int relie
 		image = RCreateImage(width, height, False);
 		if (image == NULL) {
 			wwarning(_("could not allocate image buffer"));
+			wTraceEnd("wTextureRenderImage");
 			return NULL;
 		}
 
@@ -499,6 +516,7 @@ RImage *wTextureRenderImage(WTexture * texture, int width, int height, int relie
 		bevelImage(image, -d);
 	}
 
+	wTraceEnd("wTextureRenderImage");
 	return image;
 }
 
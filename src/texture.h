@@ -113,6 +113,9 @@ typedef struct WTexIGradient {
 } WTexIGradient;
 
 
+/* Largest blur radius accepted in the configuration */
+#define MAX_BLUR_RADIUS	256
+
 typedef struct WTexPixmap {
     short type;
     char subtype;
@@ -120,6 +123,7 @@ typedef struct WTexPixmap {
     GC normal_gc;
 
     struct RImage *pixmap;
+    int blur;			       /* radius of gaussian blur, 0 for none */
 } WTexPixmap;
 
 typedef struct WTexTGradient {
@@ -164,7 +168,7 @@ WTexMGradient *wTextureMakeMGradient(WScreen*, int, RColor**);
 WTexTGradient *wTextureMakeTGradient(WScreen*, int, const RColor*, const RColor*, const char *, int);
 WTexIGradient *wTextureMakeIGradient(WScreen*, int, const RColor[2], int, const RColor[2]);
 WTexPixmap *wTextureMakePixmap(WScreen *scr, int style, const char *pixmap_file,
-                               XColor *color);
+                               XColor *color, int blur);
 void wTextureDestroy(WScreen*, WTexture*);
 void wTexturePaint(WTexture *, Pixmap *, WCoreWindow*, int, int);
 void wTextureRender(WScreen*, WTexture*, Pixmap*, int, int, int);
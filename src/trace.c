@@ -0,0 +1,111 @@
+/* trace.c - timing traces in Chrome trace event format
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <WINGs/WUtil.h>
+
+#include "trace.h"
+
+
+FILE *wTraceFile = NULL;
+
+static struct timespec trace_start;
+static int trace_pid;
+static Bool first_event;
+
+
+static long long elapsed_usec(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long) (now.tv_sec - trace_start.tv_sec) * 1000000LL
+		+ (now.tv_nsec - trace_start.tv_nsec) / 1000;
+}
+
+void wTraceOpen(const char *path)
+{
+	if (wTraceFile || !path || !path[0])
+		return;
+
+	wTraceFile = fopen(path, "w");
+	if (!wTraceFile) {
+		wwarning(_("could not open trace file \"%s\": %s"), path, strerror(errno));
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &trace_start);
+	trace_pid = getpid();
+	first_event = True;
+
+	fputs("[\n", wTraceFile);
+
+	/* Also covers the Exit() paths, the file would not be valid JSON otherwise */
+	atexit(wTraceClose);
+}
+
+void wTraceClose(void)
+{
+	if (!wTraceFile)
+		return;
+
+	/*
+	 * A child forked for a launch that exits when exec fails: the events
+	 * still buffered are the parent's, and exit() would flush them into
+	 * the shared file, so close the descriptor first to drop them
+	 */
+	if (getpid() != trace_pid) {
+		close(fileno(wTraceFile));
+		wTraceFile = NULL;
+		return;
+	}
+
+	fputs("\n]\n", wTraceFile);
+	fclose(wTraceFile);
+	wTraceFile = NULL;
+}
+
+void wTraceWriteEvent(char phase, const char *name, const char *arg_name, long arg_value)
+{
+	if (!wTraceFile)
+		return;
+
+	fprintf(wTraceFile, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":1",
+		first_event ? "" : ",\n", name, phase, elapsed_usec(), trace_pid);
+	first_event = False;
+
+	if (phase == 'i')
+		fputs(",\"s\":\"p\"", wTraceFile);
+
+	if (arg_name)
+		fprintf(wTraceFile, ",\"args\":{\"%s\":%ld}", arg_name, arg_value);
+
+	fputs("}", wTraceFile);
+}
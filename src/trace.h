@@ -0,0 +1,57 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMTRACE_H_
+#define WMTRACE_H_
+
+#include <stdio.h>
+
+/*
+ * Timing traces, written in the Chrome trace event format so they can be
+ * loaded in chrome://tracing or https://ui.perfetto.dev
+ *
+ * The span names must be string constants without characters that would
+ * need escaping in JSON. When tracing is not enabled, each macro costs
+ * only the test of a global pointer.
+ */
+
+/* NULL when tracing is disabled */
+extern FILE *wTraceFile;
+
+void wTraceOpen(const char *path);
+void wTraceClose(void);
+void wTraceWriteEvent(char phase, const char *name, const char *arg_name, long arg_value);
+
+#define wTraceBegin(name) \
+	do { if (wTraceFile) wTraceWriteEvent('B', (name), NULL, 0); } while (0)
+
+#define wTraceBeginArg(name, arg_name, arg_value) \
+	do { if (wTraceFile) wTraceWriteEvent('B', (name), (arg_name), (arg_value)); } while (0)
+
+#define wTraceEnd(name) \
+	do { if (wTraceFile) wTraceWriteEvent('E', (name), NULL, 0); } while (0)
+
+#define wTraceInstant(name) \
+	do { if (wTraceFile) wTraceWriteEvent('i', (name), NULL, 0); } while (0)
+
+#define wTraceCounter(name, arg_name, arg_value) \
+	do { if (wTraceFile) wTraceWriteEvent('C', (name), (arg_name), (arg_value)); } while (0)
+
+#endif
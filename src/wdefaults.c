@@ -42,6 +42,8 @@
 #include "defaults.h"
 #include "icon.h"
 #include "misc.h"
+#include "iconprefetch.h"
+#include "switchpanel.h"
 
 #define APPLY_VAL(value, flag, attrib)	\
     if (value) {attr->flag = getBool(attrib, value); \
@@ -426,11 +428,21 @@ char *get_icon_filename(const char *winstance, const char *wclass, const char *c
 RImage *get_rimage_from_file(WScreen *scr, const char *file_name, int max_size)
 {
 	RImage *image = NULL;
+	int target_size;
 
 	if (!file_name)
 		return NULL;
 
-	image = RLoadImage(scr->rcontext, file_name, 0);
+	image = wIconPrefetchGet(file_name, max_size);
+	if (image)
+		return image;
+
+	/* Let the loader reduce big images while decoding them */
+	target_size = max_size - ICON_BORDER;
+	if (target_size <= 0)
+		target_size = 1;
+
+	image = RLoadImageScaled(scr->rcontext, file_name, 0, target_size, target_size);
 	if (!image)
 		wwarning(_("error loading image file \"%s\": %s"), file_name,
 			 RMessageForError(RErrorCode));
@@ -597,6 +609,8 @@ void wDefaultChangeIcon(const char *instance, const char *class, const char *fil
 		WMReleasePropList(icon_value);
 
 	WMPLSetCaseSensitive(False);
+
+	wSwitchPanelFlushCache();
 }
 
 void wDefaultPurgeInfo(const char *instance, const char *class)
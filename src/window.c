@@ -59,6 +59,7 @@
 #include "defaults.h"
 #include "workspace.h"
 #include "xinerama.h"
+#include "spatial.h"
 #include "appmenu.h"
 #include "appicon.h"
 #include "superfluous.h"
@@ -68,6 +69,9 @@
 #include "startup.h"
 #include "winmenu.h"
 #include "osdep.h"
+#include "switchpanel.h"
+#include "minipreview.h"
+#include "session.h"
 
 #ifdef USE_MWM_HINTS
 # include "motif.h"
@@ -79,6 +83,10 @@
 
 /***** Local Stuff *****/
 static WWindowState *windowState = NULL;
+
+/* The states of windowState by instance, class and command */
+static WMHashTable *windowStateIndex = NULL;
+
 static FocusMode getFocusMode(WWindow *wwin);
 static int getSavedState(Window window, WSavedState **state);
 static void setupGNUstepHints(WWindow *wwin, GNUstepWMAttributes *gs_hints);
@@ -117,6 +125,7 @@ static void appearanceObserver(void *self, WMNotification * notif)
 		wWindowConfigureBorders(wwin);
 		if (wwin->flags.shaded) {
 			wFrameWindowResize(wwin->frame, wwin->frame->core->width, wwin->frame->top_width - 1);
+			wSpatialUpdate(wwin);
 			wwin->client.y = wwin->frame_y - wwin->client.height + wwin->frame->top_width;
 			wWindowSynthConfigureNotify(wwin);
 		}
@@ -162,6 +171,7 @@ WWindow *wWindowCreate(void)
 	wwin = wmalloc(sizeof(WWindow));
 	wretain(wwin);
 	wwin->animation_snapshot = NULL;
+	wwin->indexed_workspace = -1;
 
 	wwin->client_descriptor.handle_mousedown = frameMouseDown;
 	wwin->client_descriptor.parent = wwin;
@@ -237,6 +247,7 @@ void wWindowDestroy(WWindow *wwin)
 		RReleaseImage(wwin->net_icon_image);
 	if (wwin->animation_snapshot)
 		RReleaseImage(wwin->animation_snapshot);
+	wSwitchPanelForgetWindow(wwin);
 
 	wrelease(wwin);
 }
@@ -1017,6 +1028,10 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 		}
 	}
 
+	/* omnipresent windows follow the current workspace */
+	if (IS_OMNIPRESENT(wwin))
+		workspace = scr->current_workspace;
+
 	/* setup window geometry */
 	if (win_state && win_state->state->w > 0) {
 		width = win_state->state->w;
@@ -1334,6 +1349,7 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 		wwin->next = tmp;
 		wwin->prev = NULL;
 	}
+	wWorkspaceIndexAdd(wwin);
 
 	/* raise is set to true if we un-hid the app when this window was born.
 	 * we raise, else old windows of this app will be above this new one. */
@@ -1385,8 +1401,12 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 	WMAddNotificationObserver(appearanceObserver, wwin, WNWindowAppearanceSettingsChanged, wwin);
 
 	/*  Cleanup temporary stuff */
-	if (win_state)
+	if (win_state) {
+		pid_t pid = win_state->pid;
+
 		wWindowDeleteSavedState(win_state);
+		wSessionLaunchFinished(pid);
+	}
 
 	/* If the window must be withdrawed, then do it now.
 	 * Must do some optimization, 'though */
@@ -1509,6 +1529,7 @@ WWindow *wManageInternalWindow(WScreen *scr, Window window, Window owner,
 		wwin->next = tmp;
 		wwin->prev = NULL;
 	}
+	wWorkspaceIndexAdd(wwin);
 
 	if (wwin->flags.is_gnustep == 0)
 		wFrameWindowChangeState(wwin->frame, WS_UNFOCUSED);
@@ -1570,6 +1591,8 @@ void wUnmanageWindow(WWindow *wwin, Bool restore, Bool destroyed)
 		XUngrabKey(dpy, AnyKey, AnyModifier, wwin->client_win);
 	}
 
+	wMiniPreviewForget(wwin, destroyed);
+
 	XUnmapWindow(dpy, frame->window);
 
 	XUnmapWindow(dpy, wwin->client_win);
@@ -1601,6 +1624,8 @@ void wUnmanageWindow(WWindow *wwin, Bool restore, Bool destroyed)
 	wasFocused = wwin->flags.focused;
 
 	/* remove from window focus list */
+	wWorkspaceIndexRemove(wwin);
+	wSpatialRemove(wwin);
 	if (!wwin->prev && !wwin->next) {
 		/* was the only window */
 		scr->focused_window = NULL;
@@ -2065,7 +2090,7 @@ void wWindowChangeWorkspace(WWindow *wwin, int workspace)
 	}
 	if (!IS_OMNIPRESENT(wwin)) {
 		int oldWorkspace = wwin->frame->workspace;
-		wwin->frame->workspace = workspace;
+		wWorkspaceIndexMove(wwin, workspace);
 		WMPostNotificationName(WMNChangedWorkspace, wwin, (void *)(uintptr_t) oldWorkspace);
 	}
 
@@ -2201,6 +2226,7 @@ void wWindowConfigure(WWindow *wwin, int req_x, int req_y, int req_width, int re
 	}
 	wwin->frame_x = req_x;
 	wwin->frame_y = req_y;
+	wSpatialUpdate(wwin);
 	if (HAS_BORDER(wwin)) {
 		wwin->client.x += wwin->screen_ptr->frame_border_width;
 		wwin->client.y += wwin->screen_ptr->frame_border_width;
@@ -2247,6 +2273,7 @@ void wWindowMove(WWindow *wwin, int req_x, int req_y)
 
 	wwin->frame_x = req_x;
 	wwin->frame_y = req_y;
+	wSpatialUpdate(wwin);
 
 #ifdef CONFIGURE_WINDOW_WHILE_MOVING
 	if (synth_notify)
@@ -2389,6 +2416,8 @@ void wWindowConfigureBorders(WWindow *wwin)
 
 			XMoveWindow(dpy, wwin->client_win, 0, wwin->frame->top_width);
 			wWindowConfigure(wwin, wwin->frame_x, newy, wwin->client.width, wwin->client.height);
+		} else {
+			wSpatialUpdate(wwin);
 		}
 
 		flags = 0;
@@ -2704,6 +2733,49 @@ void wWindowUpdateGNUstepAttr(WWindow * wwin, GNUstepWMAttributes * attr)
 	}
 }
 
+/* The NULL values are not the same as empty strings */
+static char *makeStateKey(const char *instance, const char *class, const char *command)
+{
+	size_t len;
+	char *key;
+
+	len = (instance ? strlen(instance) : 0) + (class ? strlen(class) : 0)
+		+ (command ? strlen(command) : 0) + 6;
+	key = wmalloc(len);
+	snprintf(key, len, "%c%s\n%c%s\n%c%s",
+		 instance ? '+' : '-', instance ? instance : "",
+		 class ? '+' : '-', class ? class : "",
+		 command ? '+' : '-', command ? command : "");
+
+	return key;
+}
+
+static void unindexState(WWindowState *wstate)
+{
+	if (wstate->prev_same)
+		wstate->prev_same->next_same = wstate->next_same;
+	else if (wstate->next_same)
+		WMHashInsert(windowStateIndex, wstate->next_same->key, wstate->next_same);
+	else
+		WMHashRemove(windowStateIndex, wstate->key);
+
+	if (wstate->next_same)
+		wstate->next_same->prev_same = wstate->prev_same;
+}
+
+/* Remove the state from windowState and from the index, and free it */
+static void deleteState(WWindowState *wstate)
+{
+	if (wstate->prev)
+		wstate->prev->next = wstate->next;
+	else
+		windowState = wstate->next;
+	if (wstate->next)
+		wstate->next->prev = wstate->prev;
+
+	release_wwindowstate(wstate);
+}
+
 WMagicNumber wWindowAddSavedState(const char *instance, const char *class,
 				const char *command, pid_t pid, WSavedState *state)
 {
@@ -2724,29 +2796,26 @@ WMagicNumber wWindowAddSavedState(const char *instance, const char *class,
 	wstate->state = state;
 
 	wstate->next = windowState;
+	if (windowState)
+		windowState->prev = wstate;
 	windowState = wstate;
 
-	return wstate;
-}
-
-static inline int is_same(const char *x, const char *y)
-{
-	if ((x == NULL) && (y == NULL))
-		return 1;
-
-	if ((x == NULL) || (y == NULL))
-		return 0;
+	/* The last added state is found first, as when they were searched in the list */
+	if (!windowStateIndex)
+		windowStateIndex = WMCreateHashTable(WMStringPointerHashCallbacks);
+	wstate->key = makeStateKey(instance, class, command);
+	wstate->next_same = WMHashInsert(windowStateIndex, wstate->key, wstate);
+	if (wstate->next_same)
+		wstate->next_same->prev_same = wstate;
 
-	if (strcmp(x, y) == 0)
-		return 1;
-	else
-		return 0;
+	return wstate;
 }
 
 WMagicNumber wWindowGetSavedState(Window win)
 {
 	char *instance, *class, *command = NULL;
 	WWindowState *wstate = windowState;
+	char *key;
 
 	if (!wstate)
 		return NULL;
@@ -2756,14 +2825,9 @@ WMagicNumber wWindowGetSavedState(Window win)
 		return NULL;
 
 	if (PropGetWMClass(win, &class, &instance)) {
-		while (wstate) {
-			if (is_same(instance, wstate->instance) &&
-			    is_same(class, wstate->class) &&
-			    is_same(command, wstate->command)) {
-				break;
-			}
-			wstate = wstate->next;
-		}
+		key = makeStateKey(instance, class, command);
+		wstate = WMHashGet(windowStateIndex, key);
+		wfree(key);
 	} else {
 		wstate = NULL;
 	}
@@ -2780,55 +2844,31 @@ WMagicNumber wWindowGetSavedState(Window win)
 
 void wWindowDeleteSavedState(WMagicNumber id)
 {
-	WWindowState *tmp, *wstate = (WWindowState *) id;
+	WWindowState *wstate = (WWindowState *) id;
 
-	if (!wstate || !windowState)
+	if (!wstate)
 		return;
 
-	tmp = windowState;
-	if (tmp == wstate) {
-		windowState = wstate->next;
-		release_wwindowstate(wstate);
-	} else {
-		while (tmp->next) {
-			if (tmp->next == wstate) {
-				tmp->next = wstate->next;
-				release_wwindowstate(wstate);
-				break;
-			}
-			tmp = tmp->next;
-		}
-	}
+	deleteState(wstate);
 }
 
 void wWindowDeleteSavedStatesForPID(pid_t pid)
 {
-	WWindowState *tmp, *wstate;
-
-	if (!windowState)
-		return;
-
-	tmp = windowState;
-	if (tmp->pid == pid) {
-		wstate = windowState;
-		windowState = tmp->next;
+	WWindowState *wstate;
 
-		release_wwindowstate(wstate);
-	} else {
-		while (tmp->next) {
-			if (tmp->next->pid == pid) {
-				wstate = tmp->next;
-				tmp->next = wstate->next;
-				release_wwindowstate(wstate);
-				break;
-			}
-			tmp = tmp->next;
+	for (wstate = windowState; wstate; wstate = wstate->next) {
+		if (wstate->pid == pid) {
+			deleteState(wstate);
+			break;
 		}
 	}
 }
 
 static void release_wwindowstate(WWindowState *wstate)
 {
+	unindexState(wstate);
+	wfree(wstate->key);
+
 	if (wstate->instance)
 		wfree(wstate->instance);
 
@@ -2848,6 +2888,8 @@ void wWindowSetOmnipresent(WWindow *wwin, Bool flag)
 		return;
 
 	wwin->flags.omnipresent = flag;
+	if (IS_OMNIPRESENT(wwin))
+		wWorkspaceIndexMove(wwin, wwin->screen_ptr->current_workspace);
 	WMPostNotificationName(WMNChangedState, wwin, "omnipresent");
 }
 
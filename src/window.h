@@ -180,6 +180,19 @@ typedef struct WWindow {
 	struct WWindow *prev;			/* window focus list */
 	struct WWindow *next;
 
+	struct WWindow *prev_in_workspace;	/* same list, restricted to */
+	struct WWindow *next_in_workspace;	/* the windows of a workspace */
+	int indexed_workspace;			/* list it is in, -1 if none */
+	long focus_serial;			/* position in the focus list */
+
+	struct {
+		int x1, y1, x2, y2;		/* cells of the spatial index covered */
+		int edges[4];			/* edges as sorted in the index */
+		int workspace;			/* the edges are sorted in */
+		unsigned int stamp;		/* last search that reported it */
+		Bool indexed;
+	} spatial;
+
 	WScreen *screen_ptr; 			/* pointer to the screen structure */
 	WWindowAttributes user_flags;		/* window attribute flags set by user */
 	WWindowAttributes defined_user_flags;	/* mask for user_flags */
@@ -293,6 +306,25 @@ typedef struct WWindow {
 	int icon_w, icon_h;
 	RImage *net_icon_image;			/* Window Image */
 	RImage *animation_snapshot;	/* Cached content for animations */
+
+	/* Icon scaled for the switch panel, see switchpanel.c */
+	struct {
+		RImage *image;
+		RImage *source;			/* net_icon_image it comes from, if any */
+		unsigned int generation;
+		int size;
+	} switch_icon;
+
+	/* Content shown in the balloon of the miniwindow, see minipreview.c */
+	struct {
+		RImage *image;			/* already scaled to MiniPreviewSize */
+		Bool outdated;			/* the window was drawn in since */
+		Bool pending;			/* being prepared in the background */
+#ifdef USE_XDAMAGE
+		XID damage;
+		WMHandlerID timer;
+#endif
+	} preview;
 	Atom type;
 } WWindow;
 
@@ -326,7 +358,12 @@ typedef struct WWindowState {
     char *command;
     pid_t pid;
     WSavedState *state;
+    struct WWindowState *prev;
     struct WWindowState *next;
+
+    char *key;                         /* in the index, see makeStateKey() */
+    struct WWindowState *prev_same;    /* newer state with the same key */
+    struct WWindowState *next_same;    /* older state with the same key */
 } WWindowState;
 
 typedef void* WMagicNumber;
@@ -48,6 +48,7 @@
 #include "wmspec.h"
 #include "misc.h"
 #include "switchmenu.h"
+#include "switchpanel.h"
 
 #include <WINGs/WUtil.h>
 
@@ -711,6 +712,9 @@ static void saveSettings(WMWidget *button, void *client_data)
 
 	/* clean up */
 	WMPLSetCaseSensitive(False);
+
+	/* The icon settings of the window may have changed */
+	wSwitchPanelFlushCache();
 }
 
 static void applySettings(WMWidget *button, void *client_data)
@@ -767,6 +771,8 @@ static void applySettings(WMWidget *button, void *client_data)
 		ChangeStackingLevel(wwin->frame->core, WMNormalLevel);
 
 	wwin->flags.omnipresent = 0;
+	if (IS_OMNIPRESENT(wwin))
+		wWorkspaceIndexMove(wwin, wwin->screen_ptr->current_workspace);
 
 	if (WFLAGP(wwin, skip_window_list) != old_skip_window_list) {
 		UpdateSwitchMenu(wwin->screen_ptr, wwin, WFLAGP(wwin, skip_window_list)?ACTION_REMOVE:ACTION_ADD);
@@ -257,17 +257,55 @@ static void observer(void *self, WMNotification *notif);
 static void wsobserver(void *self, WMNotification *notif);
 
 static void updateClientList(WScreen *scr);
-static void updateClientListStacking(WScreen *scr, WWindow *);
+static void updateClientListStacking(WScreen *scr);
 
 static void updateWorkspaceNames(WScreen *scr);
 static void updateCurrentWorkspace(WScreen *scr);
+static void updateWorkarea(WScreen *scr);
+static void updateFocusHint(WScreen *scr);
 static void updateWorkspaceCount(WScreen *scr);
 static void wNETWMShowingDesktop(WScreen *scr, Bool show);
 
+/*
+ * The properties of the root window that describe the whole screen are not
+ * written when something changes, they are marked as outdated and written
+ * once when the current batch of events has been handled (see
+ * wNETWMFlushProperties) or when WINGs becomes idle
+ */
+enum {
+	NET_PROP_CLIENT_LIST,
+	NET_PROP_CLIENT_LIST_STACKING,
+	NET_PROP_NUMBER_OF_DESKTOPS,
+	NET_PROP_CURRENT_DESKTOP,
+	NET_PROP_DESKTOP_NAMES,
+	NET_PROP_WORKAREA,
+	NET_PROP_ACTIVE_WINDOW,
+
+	NET_PROP_COUNT
+};
+
+#define NET_PROP_DIRTY(prop)	(1U << (prop))
+
+/* What was last written in a property, to avoid writing the same again */
+typedef struct PublishedProperty {
+	unsigned char *value;
+	size_t length;
+	size_t size;	/* allocated for 'value' */
+	Bool valid;
+} PublishedProperty;
+
 typedef struct NetData {
 	WScreen *scr;
 	WReservedArea *strut;
 	WWindow **show_desktop;
+
+	unsigned int dirty;	/* mask of NET_PROP_DIRTY() */
+	WMHandlerID idle_handler;
+
+	Window *windows;	/* kept to build the client lists */
+	int windows_size;
+
+	PublishedProperty published[NET_PROP_COUNT];
 } NetData;
 
 static void setSupportedHints(WScreen *scr)
@@ -400,23 +438,111 @@ int wNETWMGetCurrentDesktopFromHint(WScreen *scr)
 	return -1;
 }
 
-static RImage *makeRImageFromARGBData(unsigned long *data)
+/*
+ * Applications often set the same icon on all their windows, and some of them
+ * (chat clients, browsers) set it again each time something happens in the
+ * window, most of the time with the same content; the icons already converted
+ * are kept here so they do not have to be decoded and scaled again
+ */
+#define NET_ICON_CACHE_SIZE	32
+
+/* do not trust an application that claims to have more icon sizes than that */
+#define NET_ICON_MAX_ENTRIES	32
+
+typedef struct NetIconCacheEntry {
+	RImage *image;		/* final image, as returned to the caller */
+	unsigned long hash;	/* of the ARGB data it comes from */
+	int width;		/* size of the ARGB data */
+	int height;
+	int wanted;		/* preferences it was converted for */
+	int icon_size;
+	unsigned long last_used;
+} NetIconCacheEntry;
+
+static NetIconCacheEntry net_icon_cache[NET_ICON_CACHE_SIZE];
+static unsigned long net_icon_cache_counter = 0;
+
+/* One of the icons in a _NET_WM_ICON property */
+typedef struct NetIconEntry {
+	long offset;		/* of the pixel data, in 32 bit items */
+	int width;
+	int height;
+} NetIconEntry;
+
+static unsigned long hashARGBData(const unsigned long *data, unsigned long count)
+{
+	unsigned long hash = 2166136261UL;
+	unsigned long i;
+
+	/* FNV-1a over the 32 bits of each pixel */
+	for (i = 0; i < count; i++) {
+		hash = (hash ^ (data[i] & 0xffffffffUL)) * 16777619UL;
+		hash ^= hash >> 15;
+	}
+
+	return hash;
+}
+
+static NetIconCacheEntry *findCachedNetIcon(unsigned long hash, int width, int height, int wanted)
+{
+	int i;
+
+	for (i = 0; i < NET_ICON_CACHE_SIZE; i++) {
+		NetIconCacheEntry *entry = &net_icon_cache[i];
+
+		if (entry->image && entry->hash == hash
+		    && entry->width == width && entry->height == height
+		    && entry->wanted == wanted && entry->icon_size == wPreferences.icon_size)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void cacheNetIcon(RImage *image, unsigned long hash, int width, int height, int wanted)
 {
-	int size, width, height, i;
+	NetIconCacheEntry *entry = &net_icon_cache[0];
+	int i;
+
+	/* use a free slot, or the one that was not used for the longest time */
+	for (i = 0; i < NET_ICON_CACHE_SIZE; i++) {
+		if (!net_icon_cache[i].image) {
+			entry = &net_icon_cache[i];
+			break;
+		}
+		if (net_icon_cache[i].last_used < entry->last_used)
+			entry = &net_icon_cache[i];
+	}
+
+	if (entry->image)
+		RReleaseImage(entry->image);
+
+	entry->image = RRetainImage(image);
+	entry->hash = hash;
+	entry->width = width;
+	entry->height = height;
+	entry->wanted = wanted;
+	entry->icon_size = wPreferences.icon_size;
+	entry->last_used = ++net_icon_cache_counter;
+}
+
+static RImage *makeRImageFromARGBData(int width, int height, unsigned long *data)
+{
+	int size, i;
 	RImage *image;
 	unsigned char *imgdata;
 	unsigned long pixel;
 
-	width = data[0];
-	height = data[1];
 	size = width * height;
 
 	if (size == 0)
 		return NULL;
 
 	image = RCreateImage(width, height, True);
+	if (!image)
+		return NULL;
 
-	for (imgdata = image->data, i = 2; i < size + 2; i++, imgdata += 4) {
+	for (imgdata = image->data, i = 0; i < size; i++, imgdata += 4) {
 		pixel = data[i];
 		imgdata[3] = (pixel >> 24) & 0xff;	/* A */
 		imgdata[0] = (pixel >> 16) & 0xff;	/* R */
@@ -427,17 +553,10 @@ static RImage *makeRImageFromARGBData(unsigned long *data)
 	return image;
 }
 
-/* Find the best icon to be used by Window Maker for appicon/miniwindows. */
-static RImage *findBestIcon(unsigned long *data, unsigned long items)
+/* The size of the icon Window Maker would like to get from the application */
+static int getWantedIconSize(void)
 {
 	int wanted;
-	int dx, dy, d;
-	int sx, sy, size;
-	int best_d, largest;
-	unsigned long i;
-	unsigned long *icon;
-	RImage *src_image, *ret_image;
-	double f;
 
 	if (wPreferences.enforce_icon_margin) {
 
@@ -457,17 +576,81 @@ static RImage *findBestIcon(unsigned long *data, unsigned long items)
 
 	}
 
+	return wanted;
+}
+
+/*
+ * Get the list of the icons in the _NET_WM_ICON property of the window,
+ * without fetching their pixels: only their sizes are read
+ */
+static int readNetIconEntries(Window window, NetIconEntry *entries, int max_entries)
+{
+	Atom type;
+	int format, count;
+	unsigned long items, rest, total;
+	unsigned long *property;
+	long offset;
+
+	/* Only ask for the length of the property */
+	if (XGetWindowProperty(dpy, window, net_wm_icon, 0L, 0L,
+			       False, XA_CARDINAL, &type, &format, &items, &rest,
+			       (unsigned char **)&property) != Success)
+		return 0;
+	if (property)
+		XFree(property);
+	if (type != XA_CARDINAL || format != 32)
+		return 0;
+
+	total = rest / 4;
+	offset = 0;
+	count = 0;
+	while (count < max_entries && offset + 2 <= total) {
+		unsigned long width, height;
+
+		if (XGetWindowProperty(dpy, window, net_wm_icon, offset, 2L,
+				       False, XA_CARDINAL, &type, &format, &items, &rest,
+				       (unsigned char **)&property) != Success || !property)
+			break;
+		if (type != XA_CARDINAL || format != 32 || items < 2) {
+			XFree(property);
+			break;
+		}
+		width = property[0];
+		height = property[1];
+		XFree(property);
+
+		/* stop at the first invalid or truncated icon */
+		if (width < 1 || height < 1 || width > 65535 || height > 65535
+		    || width * height > total - offset - 2)
+			break;
+
+		entries[count].offset = offset + 2;
+		entries[count].width = width;
+		entries[count].height = height;
+		count++;
+
+		offset += 2 + width * height;
+	}
+
+	return count;
+}
+
+/* Find the best icon to be used by Window Maker for appicon/miniwindows. */
+static int findBestIcon(NetIconEntry *entries, int count, int wanted)
+{
+	int dx, dy, d;
+	int sx, sy, size;
+	int best_d, largest;
+	int i, icon;
+
 	/* try to find an icon which is close to the wanted size, but not larger */
-	icon = NULL;
+	icon = -1;
 	best_d = wanted * wanted * 2;
-	for (i = 0L; i < items - 1;) {
+	for (i = 0; i < count; i++) {
 
 		/* get the current icon's size */
-		sx = (int)data[i];
-		sy = (int)data[i + 1];
-		if ((sx < 1) || (sy < 1))
-			break;
-		size = sx * sy + 2;
+		sx = entries[i].width;
+		sy = entries[i].height;
 
 		/* check the size difference if it's not too large */
 		if ((sx <= wanted) && (sy <= wanted)) {
@@ -475,77 +658,100 @@ static RImage *findBestIcon(unsigned long *data, unsigned long items)
 			dy = wanted - sy;
 			d = (dx * dx) + (dy * dy);
 			if (d < best_d) {
-				icon = &data[i];
+				icon = i;
 				best_d = d;
 			}
 		}
-
-		i += size;
 	}
 
 	/* if an icon has been found, no transformation is needed */
-	if (icon)
-		return makeRImageFromARGBData(icon);
+	if (icon >= 0)
+		return icon;
 
 	/* We need to scale down an icon. Find the largest one, for it usually
 	 * looks better to scale down a large image by a large scale than a
 	 * small image by a small scale. */
 	largest = 0;
-	for (i = 0L; i < items - 1;) {
-		size = (int)data[i] * (int)data[i + 1];
-		if (size == 0)
-			break;
+	for (i = 0; i < count; i++) {
+		size = entries[i].width * entries[i].height;
 		if (size > largest) {
-			icon = &data[i];
+			icon = i;
 			largest = size;
 		}
-		i += size + 2;
 	}
 
-	/* give up if there's no icon to work with */
-	if (!icon)
-		return NULL;
-
-	/* create a scaled down version of the icon */
-	src_image = makeRImageFromARGBData(icon);
-	if (src_image->width > src_image->height) {
-		f = (double)wanted / (double)src_image->width;
-		ret_image = RScaleImage(src_image, wanted, (int)(f * (double)(src_image->height)));
-	} else {
-		f = (double)wanted / (double)src_image->height;
-		ret_image = RScaleImage(src_image, (int)(f * (double)src_image->width), wanted);
-	}
-	RReleaseImage(src_image);
-	return ret_image;
+	return icon;
 }
 
 RImage *get_window_image_from_x11(Window window)
 {
+	NetIconEntry entries[NET_ICON_MAX_ENTRIES];
+	NetIconCacheEntry *cached;
 	RImage *image;
 	Atom type;
-	int format;
-	unsigned long items, rest;
+	int format, count, best, wanted;
+	unsigned long items, rest, hash;
 	unsigned long *property;
+	double f;
 
-	/* Get the icon from X11 Window */
-	if (XGetWindowProperty(dpy, window, net_wm_icon, 0L, LONG_MAX,
+	/* Get the sizes of the icons from X11 Window */
+	count = readNetIconEntries(window, entries, NET_ICON_MAX_ENTRIES);
+	if (count == 0)
+		return NULL;
+
+	/* Find the best icon */
+	wanted = getWantedIconSize();
+	best = findBestIcon(entries, count, wanted);
+	if (best < 0)
+		return NULL;
+
+	/* Only get the pixels of that one */
+	if (XGetWindowProperty(dpy, window, net_wm_icon, entries[best].offset,
+			       (long)entries[best].width * entries[best].height,
 			       False, XA_CARDINAL, &type, &format, &items, &rest,
 			       (unsigned char **)&property) != Success || !property)
 		return NULL;
 
-	if (type != XA_CARDINAL || format != 32 || items < 2) {
+	if (type != XA_CARDINAL || format != 32
+	    || items != (unsigned long)entries[best].width * entries[best].height) {
 		XFree(property);
 		return NULL;
 	}
 
-	/* Find the best icon */
-	image = findBestIcon(property, items);
+	/* Nothing to do if we already converted the same icon */
+	hash = hashARGBData(property, items);
+	cached = findCachedNetIcon(hash, entries[best].width, entries[best].height, wanted);
+	if (cached) {
+		XFree(property);
+		cached->last_used = ++net_icon_cache_counter;
+		return RRetainImage(cached->image);
+	}
+
+	image = makeRImageFromARGBData(entries[best].width, entries[best].height, property);
 	XFree(property);
 	if (!image)
 		return NULL;
 
+	/* create a scaled down version of the icon if it is too large */
+	if (image->width > wanted || image->height > wanted) {
+		RImage *src_image = image;
+
+		if (src_image->width > src_image->height) {
+			f = (double)wanted / (double)src_image->width;
+			image = RScaleImage(src_image, wanted, (int)(f * (double)(src_image->height)));
+		} else {
+			f = (double)wanted / (double)src_image->height;
+			image = RScaleImage(src_image, (int)(f * (double)src_image->width), wanted);
+		}
+		RReleaseImage(src_image);
+		if (!image)
+			return NULL;
+	}
+
 	/* Resize the image to the correct value */
 	image = wIconValidateIconSize(image, wPreferences.icon_size);
+	if (image)
+		cacheNetIcon(image, hash, entries[best].width, entries[best].height, wanted);
 
 	return image;
 }
@@ -698,7 +904,7 @@ void wNETWMInitStuff(WScreen *scr)
 	WMAddNotificationObserver(wsobserver, data, WMNWorkspaceNameChanged, NULL);
 
 	updateClientList(scr);
-	updateClientListStacking(scr, NULL);
+	updateClientListStacking(scr);
 	updateWorkspaceCount(scr);
 	updateWorkspaceNames(scr);
 	updateShowDesktop(scr, False);
@@ -708,12 +914,131 @@ void wNETWMInitStuff(WScreen *scr)
 
 void wNETWMCleanup(WScreen *scr)
 {
+	NetData *data = scr->netdata;
 	int i;
 
+	if (data) {
+		if (data->idle_handler) {
+			WMDeleteIdleHandler(data->idle_handler);
+			data->idle_handler = NULL;
+		}
+		data->dirty = 0;
+		for (i = 0; i < NET_PROP_COUNT; i++)
+			data->published[i].valid = False;
+	}
+
 	for (i = 0; i < wlengthof(atomNames); i++)
 		XDeleteProperty(dpy, scr->root_win, *atomNames[i].atom);
 }
 
+/*
+ * Write a property of the root window, unless it already has this value
+ */
+static void publishProperty(WScreen *scr, int prop, Atom atom, Atom type, int format,
+			    const void *value, int nitems)
+{
+	PublishedProperty *published = &((NetData *) scr->netdata)->published[prop];
+	size_t length;
+
+	switch (format) {
+	case 32:
+		/* Xlib wants them as long, whatever their real size */
+		length = nitems * sizeof(long);
+		break;
+	case 16:
+		length = nitems * sizeof(short);
+		break;
+	default:
+		length = nitems;
+		break;
+	}
+
+	if (published->valid && published->length == length
+	    && (length == 0 || memcmp(published->value, value, length) == 0))
+		return;
+
+	XChangeProperty(dpy, scr->root_win, atom, type, format, PropModeReplace,
+			(const unsigned char *) value, nitems);
+
+	if (length > published->size) {
+		published->value = wrealloc(published->value, length);
+		published->size = length;
+	}
+	if (length > 0)
+		memcpy(published->value, value, length);
+	published->length = length;
+	published->valid = True;
+}
+
+static void publishDirtyProperties(NetData *data)
+{
+	WScreen *scr = data->scr;
+	unsigned int dirty = data->dirty;
+
+	data->dirty = 0;
+
+	if (dirty & NET_PROP_DIRTY(NET_PROP_CLIENT_LIST))
+		updateClientList(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_CLIENT_LIST_STACKING))
+		updateClientListStacking(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_NUMBER_OF_DESKTOPS))
+		updateWorkspaceCount(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_CURRENT_DESKTOP))
+		updateCurrentWorkspace(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_DESKTOP_NAMES))
+		updateWorkspaceNames(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_WORKAREA))
+		updateWorkarea(scr);
+	if (dirty & NET_PROP_DIRTY(NET_PROP_ACTIVE_WINDOW))
+		updateFocusHint(scr);
+}
+
+static void publishWhenIdle(void *cdata)
+{
+	NetData *data = cdata;
+
+	data->idle_handler = NULL;
+	publishDirtyProperties(data);
+}
+
+static void markDirty(WScreen *scr, unsigned int props)
+{
+	NetData *data = scr->netdata;
+
+	/* If the _NET_xxx were not initialised, it not necessary to do anything */
+	if (!data)
+		return;
+
+	data->dirty |= props;
+
+	/* In case a handler keeps the event loop waiting (moving a window...) */
+	if (!data->idle_handler)
+		data->idle_handler = WMAddIdleHandler(publishWhenIdle, data);
+}
+
+void wNETWMFlushProperties(void)
+{
+	int i;
+
+	for (i = 0; i < w_global.screen_count; i++) {
+		WScreen *scr = wScreenWithNumber(i);
+		NetData *data;
+
+		if (!scr || !scr->netdata)
+			continue;
+
+		data = scr->netdata;
+		if (!data->dirty)
+			continue;
+
+		if (data->idle_handler) {
+			WMDeleteIdleHandler(data->idle_handler);
+			data->idle_handler = NULL;
+		}
+		publishDirtyProperties(data);
+	}
+}
+
 void wNETWMUpdateActions(WWindow *wwin, Bool del)
 {
 	Atom action[10];	/* nr of actions atoms defined */
@@ -761,15 +1086,15 @@ void wNETWMUpdateActions(WWindow *wwin, Bool del)
 }
 
 void wNETWMUpdateWorkarea(WScreen *scr)
+{
+	markDirty(scr, NET_PROP_DIRTY(NET_PROP_WORKAREA));
+}
+
+static void updateWorkarea(WScreen *scr)
 {
 	WArea total_usable;
 	int nb_workspace;
 
-	if (!scr->netdata) {
-		/* If the _NET_xxx were not initialised, it not necessary to do anything */
-		return;
-	}
-
 	if (!scr->usableArea) {
 		/* If we don't have any info, we fall back on using the complete screen area */
 		total_usable.x1 = 0;
@@ -820,8 +1145,8 @@ void wNETWMUpdateWorkarea(WScreen *scr)
 			property_value[4 * i + 3] = total_usable.y2 - total_usable.y1;
 		}
 
-		XChangeProperty(dpy, scr->root_win, net_workarea, XA_CARDINAL, 32, PropModeReplace,
-		                (unsigned char *) property_value, nb_workspace * 4);
+		publishProperty(scr, NET_PROP_WORKAREA, net_workarea, XA_CARDINAL, 32,
+				property_value, nb_workspace * 4);
 	}
 }
 
@@ -908,64 +1233,66 @@ Bool wNETWMGetUsableArea(WScreen *scr, int head, WArea *area)
 	return True;
 }
 
+/* Make sure the buffer used to build the client lists is big enough */
+static Window *getWindowsBuffer(WScreen *scr)
+{
+	NetData *data = scr->netdata;
+
+	if (data->windows_size < scr->window_count + 1) {
+		data->windows_size = scr->window_count + 16;
+		data->windows = wrealloc(data->windows, sizeof(Window) * data->windows_size);
+	}
+
+	return data->windows;
+}
+
 static void updateClientList(WScreen *scr)
 {
 	WWindow *wwin;
 	Window *windows;
 	int count;
 
-	windows = (Window *) wmalloc(sizeof(Window) * (scr->window_count + 1));
+	windows = getWindowsBuffer(scr);
 
 	count = 0;
 	wwin = scr->focused_window;
-	while (wwin) {
+	while (wwin && count < scr->window_count + 1) {
 		windows[count++] = wwin->client_win;
 		wwin = wwin->prev;
 	}
-	XChangeProperty(dpy, scr->root_win, net_client_list, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)windows, count);
-
-	wfree(windows);
-	XFlush(dpy);
+	publishProperty(scr, NET_PROP_CLIENT_LIST, net_client_list, XA_WINDOW, 32, windows, count);
 }
 
-static void updateClientListStacking(WScreen *scr, WWindow *wwin_excl)
+static void updateClientListStacking(WScreen *scr)
 {
 	WWindow *wwin;
-	Window *client_list, *client_list_reverse;
-	int client_count, i;
+	Window *client_list, w;
+	int client_count, max_count, i;
 	WCoreWindow *tmp;
 	WMBagIterator iter;
 
-	/* update client list */
-	i = scr->window_count + 1;
-	client_list = (Window *) wmalloc(sizeof(Window) * i);
-	client_list_reverse = (Window *) wmalloc(sizeof(Window) * i);
+	client_list = getWindowsBuffer(scr);
+	max_count = scr->window_count + 1;
 
 	client_count = 0;
 	WM_ETARETI_BAG(scr->stacking_list, tmp, iter) {
-		while (tmp) {
+		while (tmp && client_count < max_count) {
 			wwin = wWindowFor(tmp->window);
-			/* wwin_excl is a window to exclude from the list
-			   (e.g. it's now unmanaged) */
-			if (wwin && (wwin != wwin_excl))
+			if (wwin)
 				client_list[client_count++] = wwin->client_win;
 			tmp = tmp->stacking->under;
 		}
 	}
 
-	for (i = 0; i < client_count; i++) {
-		Window w = client_list[client_count - i - 1];
-		client_list_reverse[i] = w;
+	/* The property goes from bottom to top */
+	for (i = 0; i < client_count / 2; i++) {
+		w = client_list[i];
+		client_list[i] = client_list[client_count - i - 1];
+		client_list[client_count - i - 1] = w;
 	}
 
-	XChangeProperty(dpy, scr->root_win, net_client_list_stacking, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)client_list_reverse, client_count);
-
-	wfree(client_list);
-	wfree(client_list_reverse);
-
-	XFlush(dpy);
+	publishProperty(scr, NET_PROP_CLIENT_LIST_STACKING, net_client_list_stacking, XA_WINDOW, 32,
+			client_list, client_count);
 }
 
 static void updateWorkspaceCount(WScreen *scr)
@@ -974,8 +1301,8 @@ static void updateWorkspaceCount(WScreen *scr)
 
 	count = scr->workspace_count;
 
-	XChangeProperty(dpy, scr->root_win, net_number_of_desktops, XA_CARDINAL,
-			32, PropModeReplace, (unsigned char *)&count, 1);
+	publishProperty(scr, NET_PROP_NUMBER_OF_DESKTOPS, net_number_of_desktops, XA_CARDINAL, 32,
+			&count, 1);
 }
 
 static void updateCurrentWorkspace(WScreen *scr)
@@ -984,8 +1311,8 @@ static void updateCurrentWorkspace(WScreen *scr)
 
 	count = scr->current_workspace;
 
-	XChangeProperty(dpy, scr->root_win, net_current_desktop, XA_CARDINAL, 32,
-			PropModeReplace, (unsigned char *)&count, 1);
+	publishProperty(scr, NET_PROP_CURRENT_DESKTOP, net_current_desktop, XA_CARDINAL, 32,
+			&count, 1);
 }
 
 static void updateWorkspaceNames(WScreen *scr)
@@ -1002,8 +1329,7 @@ static void updateWorkspaceNames(WScreen *scr)
 		len += (curr_size + 1);
 	}
 
-	XChangeProperty(dpy, scr->root_win, net_desktop_names, utf8_string, 8,
-			PropModeReplace, (unsigned char *)buf, len);
+	publishProperty(scr, NET_PROP_DESKTOP_NAMES, net_desktop_names, utf8_string, 8, buf, len);
 }
 
 static void updateFocusHint(WScreen *scr)
@@ -1015,8 +1341,7 @@ static void updateFocusHint(WScreen *scr)
 	else
 		window = scr->focused_window->client_win;
 
-	XChangeProperty(dpy, scr->root_win, net_active_window, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)&window, 1);
+	publishProperty(scr, NET_PROP_ACTIVE_WINDOW, net_active_window, XA_WINDOW, 32, &window, 1);
 }
 
 static void updateWorkspaceHint(WWindow *wwin, Bool fake, Bool del)
@@ -1705,7 +2030,7 @@ Bool wNETWMProcessClientMessage(XClientMessageEvent *event)
 				}
 
 				if (rebuild)
-					updateWorkspaceCount(scr);
+					markDirty(scr, NET_PROP_DIRTY(NET_PROP_NUMBER_OF_DESKTOPS));
 			}
 			return True;
 
@@ -1909,16 +2234,17 @@ static void observer(void *self, WMNotification *notif)
 	NetData *ndata = (NetData *) self;
 
 	if (strcmp(name, WMNManaged) == 0 && wwin) {
-		updateClientList(wwin->screen_ptr);
-		updateClientListStacking(wwin->screen_ptr, NULL);
+		markDirty(wwin->screen_ptr, NET_PROP_DIRTY(NET_PROP_CLIENT_LIST)
+			  | NET_PROP_DIRTY(NET_PROP_CLIENT_LIST_STACKING));
 		updateStateHint(wwin, True, False);
 
 		updateStrut(wwin->screen_ptr, wwin->client_win, False);
 		updateStrut(wwin->screen_ptr, wwin->client_win, True);
 		wScreenUpdateUsableArea(wwin->screen_ptr);
 	} else if (strcmp(name, WMNUnmanaged) == 0 && wwin) {
-		updateClientList(wwin->screen_ptr);
-		updateClientListStacking(wwin->screen_ptr, wwin);
+		/* Written later, when the window is no longer in the lists */
+		markDirty(wwin->screen_ptr, NET_PROP_DIRTY(NET_PROP_CLIENT_LIST)
+			  | NET_PROP_DIRTY(NET_PROP_CLIENT_LIST_STACKING));
 		updateWorkspaceHint(wwin, False, True);
 		updateStateHint(wwin, False, True);
 		wNETWMUpdateActions(wwin, True);
@@ -1926,13 +2252,13 @@ static void observer(void *self, WMNotification *notif)
 		updateStrut(wwin->screen_ptr, wwin->client_win, False);
 		wScreenUpdateUsableArea(wwin->screen_ptr);
 	} else if (strcmp(name, WMNResetStacking) == 0 && wwin) {
-		updateClientListStacking(wwin->screen_ptr, NULL);
+		markDirty(wwin->screen_ptr, NET_PROP_DIRTY(NET_PROP_CLIENT_LIST_STACKING));
 		updateStateHint(wwin, False, False);
 	} else if (strcmp(name, WMNChangedStacking) == 0 && wwin) {
-		updateClientListStacking(wwin->screen_ptr, NULL);
+		markDirty(wwin->screen_ptr, NET_PROP_DIRTY(NET_PROP_CLIENT_LIST_STACKING));
 		updateStateHint(wwin, False, False);
 	} else if (strcmp(name, WMNChangedFocus) == 0 && wwin) {
-		updateFocusHint(ndata->scr);
+		markDirty(ndata->scr, NET_PROP_DIRTY(NET_PROP_ACTIVE_WINDOW));
 		updateStateHint(wwin, False, False);
 	} else if (strcmp(name, WMNChangedWorkspace) == 0 && wwin) {
 		updateWorkspaceHint(wwin, False, False);
@@ -1950,18 +2276,14 @@ static void wsobserver(void *self, WMNotification *notif)
 	/* Parameter not used, but tell the compiler that it is ok */
 	(void) self;
 
-	if (strcmp(name, WMNWorkspaceCreated) == 0) {
-		updateWorkspaceCount(scr);
-		updateWorkspaceNames(scr);
-		wNETWMUpdateWorkarea(scr);
-	} else if (strcmp(name, WMNWorkspaceDestroyed) == 0) {
-		updateWorkspaceCount(scr);
-		updateWorkspaceNames(scr);
-		wNETWMUpdateWorkarea(scr);
+	if (strcmp(name, WMNWorkspaceCreated) == 0 || strcmp(name, WMNWorkspaceDestroyed) == 0) {
+		markDirty(scr, NET_PROP_DIRTY(NET_PROP_NUMBER_OF_DESKTOPS)
+			  | NET_PROP_DIRTY(NET_PROP_DESKTOP_NAMES)
+			  | NET_PROP_DIRTY(NET_PROP_WORKAREA));
 	} else if (strcmp(name, WMNWorkspaceChanged) == 0) {
-		updateCurrentWorkspace(scr);
+		markDirty(scr, NET_PROP_DIRTY(NET_PROP_CURRENT_DESKTOP));
 	} else if (strcmp(name, WMNWorkspaceNameChanged) == 0) {
-		updateWorkspaceNames(scr);
+		markDirty(scr, NET_PROP_DIRTY(NET_PROP_DESKTOP_NAMES));
 	}
 }
 
@@ -0,0 +1,219 @@
+/* worker.c - run slow jobs in a background thread
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "worker.h"
+
+
+typedef struct WorkerJob {
+	WWorkerProc *work;
+	WWorkerProc *done;
+	void *data;
+
+	struct WorkerJob *next;
+} WorkerJob;
+
+/* Jobs queued and not reported as done yet, only used by the main thread */
+static int pending_count = 0;
+
+static void finishJob(WorkerJob *job)
+{
+	pending_count--;
+	if (job->done)
+		(*job->done) (job->data);
+	wfree(job);
+}
+
+int wWorkerPendingCount(void)
+{
+	return pending_count;
+}
+
+#ifdef HAVE_PTHREAD
+
+/*
+ * The worker tells the main thread that a job is finished by writing its
+ * address in a pipe which is watched by the event loop, so the 'done'
+ * callback can safely use X and the rest of the window manager
+ */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	Bool started;
+
+	/* Waiting and in progress, in order */
+	WorkerJob *first;
+	WorkerJob *last;
+
+	int done_pipe[2];
+} worker = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, False, NULL, NULL, { -1, -1 } };
+
+static void *workerThread(void *arg)
+{
+	WorkerJob *job;
+
+	(void) arg;
+
+	pthread_mutex_lock(&worker.lock);
+	for (;;) {
+		while (!worker.first)
+			pthread_cond_wait(&worker.changed, &worker.lock);
+
+		/* The job stays first in the queue while in progress, for wWorkerFlush */
+		job = worker.first;
+		pthread_mutex_unlock(&worker.lock);
+
+		if (job->work)
+			(*job->work) (job->data);
+
+		pthread_mutex_lock(&worker.lock);
+		worker.first = job->next;
+		if (!worker.first)
+			worker.last = NULL;
+
+		/*
+		 * The main thread frees the job as soon as it reads it, so this is
+		 * done last; the pipe can hold thousands of jobs, we do not expect
+		 * that many at once
+		 */
+		while (write(worker.done_pipe[1], &job, sizeof(job)) < 0 && errno == EINTR)
+			;
+		pthread_cond_broadcast(&worker.changed);
+	}
+
+	return NULL;
+}
+
+static void readDoneJobs(int fd, int mask, void *data)
+{
+	WorkerJob *job;
+
+	(void) mask;
+	(void) data;
+
+	while (read(fd, &job, sizeof(job)) == sizeof(job))
+		finishJob(job);
+}
+
+static Bool startWorker(void)
+{
+	pthread_t thread;
+
+	if (worker.started)
+		return True;
+
+	if (pipe(worker.done_pipe) < 0) {
+		werror(_("could not create a pipe for the worker thread: %s"), strerror(errno));
+		return False;
+	}
+	fcntl(worker.done_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(worker.done_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(worker.done_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	if (pthread_create(&thread, NULL, workerThread, NULL) != 0) {
+		werror(_("could not create the worker thread"));
+		close(worker.done_pipe[0]);
+		close(worker.done_pipe[1]);
+		return False;
+	}
+	pthread_detach(thread);
+
+	WMAddInputHandler(worker.done_pipe[0], WIReadMask, readDoneJobs, NULL);
+	worker.started = True;
+
+	return True;
+}
+
+void wWorkerRun(WWorkerProc *work, WWorkerProc *done, void *data)
+{
+	WorkerJob *job;
+
+	job = wmalloc(sizeof(WorkerJob));
+	job->work = work;
+	job->done = done;
+	job->data = data;
+	pending_count++;
+
+	if (!startWorker()) {
+		if (work)
+			(*work) (data);
+		finishJob(job);
+		return;
+	}
+
+	pthread_mutex_lock(&worker.lock);
+	if (worker.last)
+		worker.last->next = job;
+	else
+		worker.first = job;
+	worker.last = job;
+	pthread_cond_broadcast(&worker.changed);
+	pthread_mutex_unlock(&worker.lock);
+}
+
+void wWorkerFlush(void)
+{
+	if (!worker.started)
+		return;
+
+	pthread_mutex_lock(&worker.lock);
+	while (worker.first)
+		pthread_cond_wait(&worker.changed, &worker.lock);
+	pthread_mutex_unlock(&worker.lock);
+
+	readDoneJobs(worker.done_pipe[0], WIReadMask, NULL);
+}
+
+#else /* HAVE_PTHREAD */
+
+void wWorkerRun(WWorkerProc *work, WWorkerProc *done, void *data)
+{
+	WorkerJob *job;
+
+	job = wmalloc(sizeof(WorkerJob));
+	job->done = done;
+	job->data = data;
+	pending_count++;
+
+	if (work)
+		(*work) (data);
+	finishJob(job);
+}
+
+void wWorkerFlush(void)
+{
+}
+
+#endif /* HAVE_PTHREAD */
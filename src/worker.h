@@ -0,0 +1,44 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMWORKER_H_
+#define WMWORKER_H_
+
+typedef void WWorkerProc(void *data);
+
+/*
+ * Call 'work' in a background thread, then 'done' in the main thread from
+ * the event loop once it is finished. Jobs are run one at a time, in order.
+ *
+ * 'work' must not talk to the X server nor use anything the main thread may
+ * be changing at the same time; when threads are not available, or the
+ * thread cannot be started, both are called right away.
+ */
+void wWorkerRun(WWorkerProc *work, WWorkerProc *done, void *data);
+
+/* Number of jobs whose 'done' was not called yet */
+int wWorkerPendingCount(void);
+
+/*
+ * Wait for all the jobs queued to be finished, and call their 'done'
+ */
+void wWorkerFlush(void);
+
+#endif
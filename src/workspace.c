@@ -48,6 +48,7 @@
 #include "appicon.h"
 #include "wmspec.h"
 #include "xinerama.h"
+#include "spatial.h"
 #include "event.h"
 #include "wsmap.h"
 #include "dialog.h"
@@ -140,16 +141,14 @@ Bool wWorkspaceDelete(WScreen * scr, int workspace)
 		return False;
 
 	/* verify if workspace is in use by some window */
-	tmp = scr->focused_window;
-	while (tmp) {
-		if (!IS_OMNIPRESENT(tmp) && tmp->frame->workspace == workspace) {
+	FOR_EACH_WORKSPACE_WINDOW(scr, workspace, tmp) {
+		if (!IS_OMNIPRESENT(tmp)) {
 			char buf[256];
 			snprintf(buf, sizeof(buf), _("Workspace \"%s\" in use; cannot delete"),
 				 scr->workspaces[workspace]->name);
 			wMessageDialog(scr, _("Error"), buf, _("OK"), NULL, NULL);
 			return False;
 		}
-		tmp = tmp->prev;
 	}
 
 	if (!wPreferences.flags.noclip) {
@@ -473,9 +472,156 @@ void wWorkspaceRelativeChange(WScreen * scr, int amount)
 	}
 }
 
+/*
+ * Index of the windows of each workspace
+ *
+ * Every workspace keeps the list of its windows, in the same order as the
+ * focus list of the screen, so the code only interested in one workspace
+ * does not have to go through the windows of all the others. The order is
+ * given by a serial number that grows towards the last focused window.
+ */
+
+static void unlinkWorkspaceWindow(WWindow *wwin)
+{
+	WScreen *scr = wwin->screen_ptr;
+	int workspace = wwin->indexed_workspace;
+
+	if (workspace < 0)
+		return;
+
+	if (wwin->prev_in_workspace)
+		wwin->prev_in_workspace->next_in_workspace = wwin->next_in_workspace;
+	else
+		scr->workspace_windows[workspace].oldest = wwin->next_in_workspace;
+
+	if (wwin->next_in_workspace)
+		wwin->next_in_workspace->prev_in_workspace = wwin->prev_in_workspace;
+	else
+		scr->workspace_windows[workspace].newest = wwin->prev_in_workspace;
+
+	wwin->prev_in_workspace = NULL;
+	wwin->next_in_workspace = NULL;
+	wwin->indexed_workspace = -1;
+}
+
+static void linkWorkspaceWindow(WWindow *wwin, int workspace)
+{
+	WScreen *scr = wwin->screen_ptr;
+	WWindow *older;
+
+	if (workspace < 0 || workspace >= MAX_WORKSPACES)
+		return;
+
+	/* The windows are usually added at one of the ends */
+	older = scr->workspace_windows[workspace].oldest;
+	if (older && older->focus_serial > wwin->focus_serial) {
+		older = NULL;
+	} else {
+		older = scr->workspace_windows[workspace].newest;
+		while (older && older->focus_serial > wwin->focus_serial)
+			older = older->prev_in_workspace;
+	}
+
+	wwin->prev_in_workspace = older;
+	if (older) {
+		wwin->next_in_workspace = older->next_in_workspace;
+		older->next_in_workspace = wwin;
+	} else {
+		wwin->next_in_workspace = scr->workspace_windows[workspace].oldest;
+		scr->workspace_windows[workspace].oldest = wwin;
+	}
+
+	if (wwin->next_in_workspace)
+		wwin->next_in_workspace->prev_in_workspace = wwin;
+	else
+		scr->workspace_windows[workspace].newest = wwin;
+
+	wwin->indexed_workspace = workspace;
+}
+
+void wWorkspaceIndexAdd(WWindow *wwin)
+{
+	wwin->focus_serial = --wwin->screen_ptr->focus_serial_oldest;
+	linkWorkspaceWindow(wwin, wwin->frame->workspace);
+}
+
+void wWorkspaceIndexRemove(WWindow *wwin)
+{
+	unlinkWorkspaceWindow(wwin);
+}
+
+void wWorkspaceIndexRaise(WWindow *wwin)
+{
+	if (wwin->indexed_workspace < 0)
+		return;
+
+	unlinkWorkspaceWindow(wwin);
+	wwin->focus_serial = ++wwin->screen_ptr->focus_serial_newest;
+	linkWorkspaceWindow(wwin, wwin->frame->workspace);
+}
+
+void wWorkspaceIndexMove(WWindow *wwin, int workspace)
+{
+	wwin->frame->workspace = workspace;
+	wSpatialUpdate(wwin);
+
+	if (wwin->indexed_workspace < 0 || wwin->indexed_workspace == workspace)
+		return;
+
+	unlinkWorkspaceWindow(wwin);
+	linkWorkspaceWindow(wwin, workspace);
+}
+
+static int compareFocusOrder(const void *a, const void *b)
+{
+	const WWindow *wwin1 = *(WWindow * const *) a;
+	const WWindow *wwin2 = *(WWindow * const *) b;
+
+	/* last focused first, like the focus list */
+	if (wwin1->focus_serial > wwin2->focus_serial)
+		return -1;
+	if (wwin1->focus_serial < wwin2->focus_serial)
+		return 1;
+	return 0;
+}
+
+/*
+ * Only the windows of the workspaces we leave and enter, and the selected
+ * ones which follow us, are affected by the change; the omnipresent windows
+ * are always on the current workspace, so they are in the first set
+ */
+static WMArray *getWindowsForChange(WScreen *scr, int old_workspace, int new_workspace)
+{
+	WMArray *windows;
+	WMArrayIterator iter;
+	WWindow *wwin;
+
+	windows = WMCreateArray(16);
+
+	FOR_EACH_WORKSPACE_WINDOW(scr, old_workspace, wwin)
+		WMAddToArray(windows, wwin);
+
+	if (new_workspace != old_workspace) {
+		FOR_EACH_WORKSPACE_WINDOW(scr, new_workspace, wwin)
+			WMAddToArray(windows, wwin);
+	}
+
+	if (scr->selected_windows) {
+		WM_ITERATE_ARRAY(scr->selected_windows, wwin, iter) {
+			if (wwin->frame->workspace != old_workspace && wwin->frame->workspace != new_workspace)
+				WMAddToArray(windows, wwin);
+		}
+	}
+
+	WMSortArray(windows, compareFocusOrder);
+
+	return windows;
+}
+
 void wWorkspaceForceChange(WScreen * scr, int workspace)
 {
 	WWindow *tmp, *foc = NULL, *foc2 = NULL;
+	int old_workspace;
 
 	if (workspace >= MAX_WORKSPACES || workspace < 0)
 		return;
@@ -490,6 +636,7 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 
 	wClipUpdateForWorkspaceChange(scr, workspace);
 
+	old_workspace = scr->current_workspace;
 	scr->last_workspace = scr->current_workspace;
 	scr->current_workspace = workspace;
 
@@ -501,6 +648,8 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 	if (tmp != NULL) {
 		WWindow **toUnmap;
 		int toUnmapSize, toUnmapCount;
+		WMArray *windows;
+		WMArrayIterator iter;
 
 		if ((IS_OMNIPRESENT(tmp) && (tmp->flags.mapped || tmp->flags.shaded) &&
 		     !WFLAGP(tmp, no_focusable)) || tmp->flags.changing_workspace) {
@@ -514,7 +663,8 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 		/* foc2 = tmp; will fix annoyance with gnome panel
 		 * but will create annoyance for every other application
 		 */
-		while (tmp) {
+		windows = getWindowsForChange(scr, old_workspace, workspace);
+		WM_ITERATE_ARRAY(windows, tmp, iter) {
 			if (tmp->frame->workspace != workspace && !tmp->flags.selected) {
 				/* unmap windows not on this workspace */
 				if ((tmp->flags.mapped || tmp->flags.shaded) &&
@@ -536,7 +686,7 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 				if (IS_OMNIPRESENT(tmp)) {
 					WApplication *wapp = wApplicationOf(tmp->main_window);
 
-					tmp->frame->workspace = workspace;
+					wWorkspaceIndexMove(tmp, workspace);
 
 					if (wapp) {
 						wapp->last_workspace = workspace;
@@ -570,8 +720,8 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 					}
 				}
 			}
-			tmp = tmp->prev;
 		}
+		WMFreeArray(windows);
 
 		while (toUnmapCount > 0)
 		{
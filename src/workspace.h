@@ -44,4 +44,24 @@ void wWorkspaceRestoreState(WScreen *scr);
 void wWorkspaceRename(WScreen *scr, int workspace, const char *name);
 void wWorkspaceRelativeChange(WScreen *scr, int amount);
 
+/*
+ * Keep the index of the windows of each workspace in sync with the focus
+ * list: Add when the window is put at the end of the list, Raise when it
+ * is moved to its head, and Move to change the workspace of the window
+ */
+void wWorkspaceIndexAdd(struct WWindow *wwin);
+void wWorkspaceIndexRemove(struct WWindow *wwin);
+void wWorkspaceIndexRaise(struct WWindow *wwin);
+void wWorkspaceIndexMove(struct WWindow *wwin, int workspace);
+
+/* Go through the windows of a workspace, from the last focused one */
+#define FOR_EACH_WORKSPACE_WINDOW(scr, workspace, wwin) \
+	for ((wwin) = (scr)->workspace_windows[(workspace)].newest; (wwin) != NULL; \
+	     (wwin) = (wwin)->prev_in_workspace)
+
+/* Same, from the window that was focused the longest time ago */
+#define FOR_EACH_WORKSPACE_WINDOW_REVERSE(scr, workspace, wwin) \
+	for ((wwin) = (scr)->workspace_windows[(workspace)].oldest; (wwin) != NULL; \
+	     (wwin) = (wwin)->next_in_workspace)
+
 #endif
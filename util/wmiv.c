@@ -85,6 +85,7 @@ Pixmap pix;
 static DndClass send_dnd;
 static Bool dnd_initialized = False;
 static Bool button1_pressed = False;
+static Bool button2_pressed = False;
 static int drag_start_x, drag_start_y;
 static int drag_threshold = 5; /* pixels */
 
@@ -893,15 +894,20 @@ static void handle_selection_clear(void)
 
 /*
 	Load an image and optionally get its orientation if libexif is available
+	If max_w and max_h are not 0, the image is reduced while it is decoded
+	so that it fits in that size
+	It can be called from any thread, the image cache used by wraster is
+	protected by a lock
 	Returns the image on success, NULL on failure
 */
-RImage *load_oriented_image(RContext *context, const char *file, int index)
+RImage *load_oriented_image_scaled(RContext *context, const char *file, int index,
+                                   unsigned max_w, unsigned max_h)
 {
 	RImage *image;
 #ifdef HAVE_EXIF
 	int orientation = 0;
 #endif
-	image = RLoadImage(context, file, index);
+	image = RLoadImageScaled(context, file, index, max_w, max_h);
 	if (!image)
 		return NULL;
 #ifdef HAVE_EXIF
@@ -973,6 +979,15 @@ RImage *load_oriented_image(RContext *context, const char *file, int index)
 	return image;
 }
 
+/*
+	Load an image at full size and orient it
+	Returns the image on success, NULL on failure
+*/
+RImage *load_oriented_image(RContext *context, const char *file, int index)
+{
+	return load_oriented_image_scaled(context, file, index, 0, 0);
+}
+
 /*
 	Change window title
 	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
@@ -998,26 +1013,27 @@ int change_title(XTextProperty *prop, char *filename)
 }
 
 /*
-	Rescale the current image based on the screen size
-	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+	Get the area available to display an image
 */
-int rescale_image(void)
+void get_image_box(int *width, int *height)
 {
-	long final_width = img->width;
-	long final_height = img->height;
-	int max_width_tmp = max_width;
-	int max_height_tmp = max_height;
+	*width = max_width;
+	*height = max_height;
 
 	if (!fullscreen_flag) {
-		max_width_tmp -= extents.left + extents.right;
-		max_height_tmp -= extents.top + extents.bottom;
+		*width -= extents.left + extents.right;
+		*height -= extents.top + extents.bottom;
 	}
+}
+
+/*
+	Reduce the size passed so that it fits in the given box, keeping the aspect ratio
+*/
+void fit_image_size(long *width, long *height, int max_width_tmp, int max_height_tmp)
+{
+	long final_width = *width;
+	long final_height = *height;
 
-	/* check if there is already a zoom factor applied */
-	if (fabsf(zoom_factor) <= 0.0f) {
-		final_width = img->width + (int)(img->width * zoom_factor);
-		final_height = img->height + (int)(img->height * zoom_factor);
-	}
 	if ((max_width_tmp < final_width) || (max_height_tmp < final_height)) {
 		double val = 0;
 		if (final_width > final_height) {
@@ -1040,6 +1056,49 @@ int rescale_image(void)
 			}
 		}
 	}
+	*width = final_width;
+	*height = final_height;
+}
+
+/*
+	Scale the image down so that it fits in the given box, as rescale_image does
+	Returns the new image, or the one passed if it fits already or could not be scaled
+*/
+static RImage *fit_image_in_box(RImage *image, int box_width, int box_height)
+{
+	RImage *tmp;
+	long width = image->width;
+	long height = image->height;
+
+	fit_image_size(&width, &height, box_width, box_height);
+	if ((width == image->width) && (height == image->height))
+		return image;
+
+	tmp = RScaleImage(image, width, height);
+	if (!tmp)
+		return image;
+	RReleaseImage(image);
+	return tmp;
+}
+
+/*
+	Rescale the current image based on the screen size
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+int rescale_image(void)
+{
+	long final_width = img->width;
+	long final_height = img->height;
+	int max_width_tmp, max_height_tmp;
+
+	get_image_box(&max_width_tmp, &max_height_tmp);
+
+	/* check if there is already a zoom factor applied */
+	if (fabsf(zoom_factor) <= 0.0f) {
+		final_width = img->width + (int)(img->width * zoom_factor);
+		final_height = img->height + (int)(img->height * zoom_factor);
+	}
+	fit_image_size(&final_width, &final_height, max_width_tmp, max_height_tmp);
 	if ((final_width != img->width) || (final_height != img->height)) {
 		RImage *old_img = img;
 		img = RScaleImage(img, final_width, final_height);
@@ -1099,6 +1158,583 @@ int merge_with_background(RImage *i)
 	return EXIT_FAILURE;
 }
 
+/*
+	Tiled view for huge images: instead of scaling the whole image on every
+	zoom or move, the image is cut in tiles at power-of-two reductions which
+	are only created when they become visible, each one from the 4 tiles of
+	the level below, and the window content is rendered from the visible
+	tiles of the level closest to the zoom
+*/
+#define TILE_SIZE 256
+#define TILED_MIN_PIXELS (4096L * 4096L)	/* images this big or larger use tiles */
+#define TILE_CACHE_COUNT 256	/* tiles kept in memory, 64 MiB at most */
+#define TILED_MAX_SCALE 8.0f
+#define TILED_ZOOM_STEP 1.25f
+#define TILE_THREADS 8
+
+typedef struct tile_level {
+	int cols;
+	int rows;
+	RImage **tiles;
+	unsigned long *last_used;
+} tile_level_t;
+
+typedef struct tiled_image {
+	link_t *link;		/* file the image comes from */
+	RImage *source;
+	int level_count;
+	tile_level_t *levels;
+	int tile_count;		/* tiles in memory */
+	unsigned long use_counter;
+
+	float scale;		/* window pixels per image pixel */
+	double center_x;	/* image point displayed at the center of the window */
+	double center_y;
+	int view_width;		/* area the image is rendered in */
+	int view_height;
+} tiled_image_t;
+
+typedef struct tile_job {
+	tiled_image_t *tiled;
+	int level;
+	int *indexes;		/* tiles to create in the level */
+	int count;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
+	int next;
+} tile_job_t;
+
+static tiled_image_t *tiled = NULL;
+
+/*
+	Check if the tiled view is used for the current image
+*/
+static Bool tiled_is_current(void)
+{
+	return tiled && current_link && tiled->link == current_link;
+}
+
+static void tiled_free_tiles(tiled_image_t *t)
+{
+	int l, i;
+
+	for (l = 0; l < t->level_count; l++) {
+		for (i = 0; i < t->levels[l].cols * t->levels[l].rows; i++) {
+			if (t->levels[l].tiles[i]) {
+				RReleaseImage(t->levels[l].tiles[i]);
+				t->levels[l].tiles[i] = NULL;
+			}
+		}
+	}
+	t->tile_count = 0;
+}
+
+/*
+	Set up the levels for the current size of the source image
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+static int tiled_init_levels(tiled_image_t *t)
+{
+	int l, count;
+
+	count = 1;
+	while (((t->source->width - 1) >> (count - 1)) >= TILE_SIZE ||
+	       ((t->source->height - 1) >> (count - 1)) >= TILE_SIZE)
+		count++;
+
+	t->levels = calloc(count, sizeof(tile_level_t));
+	if (!t->levels)
+		return EXIT_FAILURE;
+	t->level_count = count;
+
+	for (l = 0; l < count; l++) {
+		int width = (t->source->width + (1 << l) - 1) >> l;
+		int height = (t->source->height + (1 << l) - 1) >> l;
+
+		t->levels[l].cols = (width + TILE_SIZE - 1) / TILE_SIZE;
+		t->levels[l].rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+		t->levels[l].tiles = calloc(t->levels[l].cols * t->levels[l].rows, sizeof(RImage *));
+		t->levels[l].last_used = calloc(t->levels[l].cols * t->levels[l].rows, sizeof(unsigned long));
+		if (!t->levels[l].tiles || !t->levels[l].last_used)
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+static void tiled_free_levels(tiled_image_t *t)
+{
+	int l;
+
+	if (!t->levels)
+		return;
+	tiled_free_tiles(t);
+	for (l = 0; l < t->level_count; l++) {
+		free(t->levels[l].tiles);
+		free(t->levels[l].last_used);
+	}
+	free(t->levels);
+	t->levels = NULL;
+	t->level_count = 0;
+}
+
+/*
+	Release the tiled view
+*/
+static void tiled_close(void)
+{
+	if (!tiled)
+		return;
+	tiled_free_levels(tiled);
+	RReleaseImage(tiled->source);
+	free(tiled);
+	tiled = NULL;
+}
+
+/*
+	Set the scale so that the whole image fits in the view
+*/
+static void tiled_fit(int view_width, int view_height)
+{
+	long width = tiled->source->width;
+	long height = tiled->source->height;
+
+	fit_image_size(&width, &height, view_width, view_height);
+	tiled->scale = (float)width / tiled->source->width;
+	tiled->center_x = tiled->source->width / 2.0;
+	tiled->center_y = tiled->source->height / 2.0;
+	tiled->view_width = view_width;
+	tiled->view_height = view_height;
+}
+
+/*
+	Use the tiled view for an image if it is big enough to need it
+	The image is owned by the tiled view on success
+	Returns True if the tiled view is used
+*/
+static Bool tiled_open(link_t *link, RImage *source)
+{
+	int view_width, view_height;
+
+	if (!source || (long)source->width * source->height < TILED_MIN_PIXELS)
+		return False;
+
+	tiled_close();
+	tiled = calloc(1, sizeof(tiled_image_t));
+	if (!tiled)
+		return False;
+	tiled->link = link;
+	tiled->source = source;
+	if (tiled_init_levels(tiled) != EXIT_SUCCESS) {
+		tiled->source = NULL;
+		tiled_free_levels(tiled);
+		free(tiled);
+		tiled = NULL;
+		return False;
+	}
+
+	get_image_box(&view_width, &view_height);
+	tiled_fit(view_width, view_height);
+	return True;
+}
+
+/*
+	Reduce an area of an image by 2 in both directions into a tile, at the
+	given position; the last row and column are repeated when the size of
+	the area is odd
+*/
+static void tiled_reduce(RImage *tile, int dst_x, int dst_y,
+                         const RImage *part, int x, int y, int width, int height)
+{
+	int channels = (part->format == RRGBAFormat) ? 4 : 3;
+	int stride = part->width * channels;
+	int tx, ty, c;
+
+	for (ty = 0; ty < (height + 1) / 2; ty++) {
+		const unsigned char *row0 = part->data + (size_t)(y + 2 * ty) * stride + x * channels;
+		const unsigned char *row1 = (2 * ty + 1 < height) ? row0 + stride : row0;
+		unsigned char *d = tile->data + ((size_t)(dst_y + ty) * tile->width + dst_x) * channels;
+
+		for (tx = 0; tx < (width + 1) / 2; tx++) {
+			int x0 = 2 * tx * channels;
+			int x1 = (2 * tx + 1 < width) ? x0 + channels : x0;
+
+			for (c = 0; c < channels; c++)
+				*d++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+		}
+	}
+}
+
+/*
+	Create a tile of a level: the tiles of level 0 are copied from the
+	source, the others are a 2x2 reduction of the 4 tiles below them, taken
+	from the cache when they are there and created on the fly otherwise
+	Returns the tile on success, NULL on failure
+*/
+static RImage *tiled_make_tile(tiled_image_t *t, int level, int index)
+{
+	int level_width = (t->source->width + (1 << level) - 1) >> level;
+	int level_height = (t->source->height + (1 << level) - 1) >> level;
+	int col = index % t->levels[level].cols;
+	int row = index / t->levels[level].cols;
+	int width = TILE_SIZE;
+	int height = TILE_SIZE;
+	tile_level_t *below;
+	RImage *tile;
+	int q;
+
+	if ((col + 1) * TILE_SIZE > level_width)
+		width = level_width - col * TILE_SIZE;
+	if ((row + 1) * TILE_SIZE > level_height)
+		height = level_height - row * TILE_SIZE;
+
+	if (level == 0)
+		return RGetSubImage(t->source, col * TILE_SIZE, row * TILE_SIZE, width, height);
+
+	tile = RCreateImage(width, height, t->source->format == RRGBAFormat);
+	if (!tile)
+		return NULL;
+
+	below = &t->levels[level - 1];
+	for (q = 0; q < 4; q++) {
+		int part_col = 2 * col + (q & 1);
+		int part_row = 2 * row + (q >> 1);
+		int part_index = part_row * below->cols + part_col;
+		int dst_x = (q & 1) * TILE_SIZE / 2;
+		int dst_y = (q >> 1) * TILE_SIZE / 2;
+		RImage *part;
+
+		if (part_col >= below->cols || part_row >= below->rows)
+			continue;
+
+		part = below->tiles[part_index];
+		if (part) {
+			tiled_reduce(tile, dst_x, dst_y, part, 0, 0, part->width, part->height);
+		} else if (level == 1) {
+			/* no need to copy the source in a temporary tile */
+			int x = part_col * TILE_SIZE;
+			int y = part_row * TILE_SIZE;
+
+			tiled_reduce(tile, dst_x, dst_y, t->source, x, y,
+				     (x + TILE_SIZE > t->source->width) ? t->source->width - x : TILE_SIZE,
+				     (y + TILE_SIZE > t->source->height) ? t->source->height - y : TILE_SIZE);
+		} else {
+			part = tiled_make_tile(t, level - 1, part_index);
+			if (!part) {
+				RReleaseImage(tile);
+				return NULL;
+			}
+			tiled_reduce(tile, dst_x, dst_y, part, 0, 0, part->width, part->height);
+			RReleaseImage(part);
+		}
+	}
+
+	return tile;
+}
+
+static void *tiled_worker(void *arg)
+{
+	tile_job_t *job = arg;
+	int i;
+
+	for (;;) {
+#ifdef HAVE_PTHREAD
+		pthread_mutex_lock(&job->lock);
+#endif
+		i = job->next++;
+#ifdef HAVE_PTHREAD
+		pthread_mutex_unlock(&job->lock);
+#endif
+		if (i >= job->count)
+			break;
+
+		/*
+		 * each worker writes to a different tile and only reads the
+		 * tiles of the level below, no need to lock
+		 */
+		job->tiled->levels[job->level].tiles[job->indexes[i]] =
+			tiled_make_tile(job->tiled, job->level, job->indexes[i]);
+	}
+	return NULL;
+}
+
+/*
+	Create the missing tiles of a level in parallel
+*/
+static void tiled_make_tiles(tiled_image_t *t, int level, int *indexes, int count)
+{
+	tile_job_t job;
+	int i;
+
+	if (count == 0)
+		return;
+
+	job.tiled = t;
+	job.level = level;
+	job.indexes = indexes;
+	job.count = count;
+	job.next = 0;
+
+#ifdef HAVE_PTHREAD
+	{
+		pthread_t tid[TILE_THREADS];
+		int started[TILE_THREADS];
+		long nthreads;
+
+#ifdef _SC_NPROCESSORS_ONLN
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+		nthreads = 1;
+#endif
+
+		if (nthreads > TILE_THREADS)
+			nthreads = TILE_THREADS;
+		if (nthreads > count)
+			nthreads = count;
+
+		pthread_mutex_init(&job.lock, NULL);
+		/* the calling thread works too */
+		for (i = 1; i < nthreads; i++)
+			started[i] = (pthread_create(&tid[i], NULL, tiled_worker, &job) == 0);
+		tiled_worker(&job);
+		for (i = 1; i < nthreads; i++)
+			if (started[i])
+				pthread_join(tid[i], NULL);
+		pthread_mutex_destroy(&job.lock);
+	}
+#else
+	tiled_worker(&job);
+#endif
+
+	for (i = 0; i < count; i++)
+		if (t->levels[level].tiles[indexes[i]])
+			t->tile_count++;
+}
+
+/*
+	Release the least recently used tiles when there are too many,
+	but not the ones used for the last rendering
+*/
+static void tiled_trim_cache(tiled_image_t *t, unsigned long keep_from)
+{
+	while (t->tile_count > TILE_CACHE_COUNT) {
+		int best_level = -1, best_index = 0;
+		unsigned long best_use = keep_from;
+		int l, i;
+
+		for (l = 0; l < t->level_count; l++) {
+			for (i = 0; i < t->levels[l].cols * t->levels[l].rows; i++) {
+				if (t->levels[l].tiles[i] && t->levels[l].last_used[i] < best_use) {
+					best_use = t->levels[l].last_used[i];
+					best_level = l;
+					best_index = i;
+				}
+			}
+		}
+		if (best_level < 0)
+			break;
+
+		RReleaseImage(t->levels[best_level].tiles[best_index]);
+		t->levels[best_level].tiles[best_index] = NULL;
+		t->tile_count--;
+	}
+}
+
+/*
+	Render the visible part of the image for the current scale and position
+	Returns the image on success, NULL on failure
+*/
+static RImage *tiled_render(void)
+{
+	tiled_image_t *t = tiled;
+	tile_level_t *lvl;
+	RImage *area, *image;
+	int level, factor, out_width, out_height;
+	int x0, y0, x1, y1, col, row;
+	int *missing, nmissing = 0;
+	unsigned long stamp;
+	double half_w, half_h;
+
+	out_width = ceil(t->source->width * t->scale);
+	out_height = ceil(t->source->height * t->scale);
+	if (out_width > t->view_width)
+		out_width = t->view_width;
+	if (out_height > t->view_height)
+		out_height = t->view_height;
+	if (out_width <= 0 || out_height <= 0)
+		return NULL;
+
+	/* keep the view inside the image */
+	half_w = out_width / (2.0 * (double)t->scale);
+	half_h = out_height / (2.0 * (double)t->scale);
+	if (t->center_x < half_w)
+		t->center_x = half_w;
+	if (t->center_x > t->source->width - half_w)
+		t->center_x = t->source->width - half_w;
+	if (t->center_y < half_h)
+		t->center_y = half_h;
+	if (t->center_y > t->source->height - half_h)
+		t->center_y = t->source->height - half_h;
+
+	/* the most reduced level that still has enough details */
+	level = 0;
+	while (level + 1 < t->level_count && t->scale * (1 << (level + 1)) <= 1.0f)
+		level++;
+	factor = 1 << level;
+	lvl = &t->levels[level];
+
+	/* visible area in the coordinates of the level */
+	x0 = floor((t->center_x - half_w) / factor);
+	y0 = floor((t->center_y - half_h) / factor);
+	x1 = ceil((t->center_x + half_w) / factor);
+	y1 = ceil((t->center_y + half_h) / factor);
+	if (x0 < 0)
+		x0 = 0;
+	if (y0 < 0)
+		y0 = 0;
+	if (x1 > (t->source->width + factor - 1) / factor)
+		x1 = (t->source->width + factor - 1) / factor;
+	if (y1 > (t->source->height + factor - 1) / factor)
+		y1 = (t->source->height + factor - 1) / factor;
+	if (x1 <= x0 || y1 <= y0)
+		return NULL;
+
+	missing = malloc(lvl->cols * lvl->rows * sizeof(int));
+	if (!missing)
+		return NULL;
+
+	stamp = ++t->use_counter;
+	for (row = y0 / TILE_SIZE; row <= (y1 - 1) / TILE_SIZE; row++) {
+		for (col = x0 / TILE_SIZE; col <= (x1 - 1) / TILE_SIZE; col++) {
+			int index = row * lvl->cols + col;
+
+			if (!lvl->tiles[index])
+				missing[nmissing++] = index;
+			lvl->last_used[index] = stamp;
+		}
+	}
+	tiled_make_tiles(t, level, missing, nmissing);
+	free(missing);
+
+	area = RCreateImage(x1 - x0, y1 - y0, t->source->format == RRGBAFormat);
+	if (!area)
+		return NULL;
+
+	for (row = y0 / TILE_SIZE; row <= (y1 - 1) / TILE_SIZE; row++) {
+		for (col = x0 / TILE_SIZE; col <= (x1 - 1) / TILE_SIZE; col++) {
+			RImage *tile = lvl->tiles[row * lvl->cols + col];
+
+			if (tile)
+				RCopyArea(area, tile, 0, 0, tile->width, tile->height,
+					col * TILE_SIZE - x0, row * TILE_SIZE - y0);
+		}
+	}
+
+	if (area->width == out_width && area->height == out_height) {
+		image = area;
+	} else {
+		image = RScaleImage(area, out_width, out_height);
+		RReleaseImage(area);
+	}
+
+	tiled_trim_cache(t, stamp);
+	return image;
+}
+
+/*
+	Render and display the tiled view in the window
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+static int tiled_display(void)
+{
+	RImage *image;
+
+	image = tiled_render();
+	if (!image)
+		return EXIT_FAILURE;
+	merge_with_background(image);
+
+	RReleaseImage(img);
+	img = image;
+	if (pix)
+		XFreePixmap(dpy, pix);
+	if (!RConvertImage(ctx, img, &pix)) {
+		fprintf(stderr, "Error: %s\n", RMessageForError(RErrorCode));
+		pix = None;
+		return EXIT_FAILURE;
+	}
+
+	if (!fullscreen_flag) {
+		XResizeWindow(dpy, win, img->width, img->height);
+		XCopyArea(dpy, pix, win, ctx->copy_gc, 0, 0, img->width, img->height, 0, 0);
+	} else {
+		XClearWindow(dpy, win);
+		XCopyArea(dpy, pix, win, ctx->copy_gc, 0, 0,
+			img->width, img->height, max_width/2-img->width/2, max_height/2-img->height/2);
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+	Multiply the scale of the tiled view, the window grows up to the screen size
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+static int tiled_zoom(float factor)
+{
+	long width = tiled->source->width;
+	long height = tiled->source->height;
+	float min_scale;
+
+	get_image_box(&tiled->view_width, &tiled->view_height);
+	fit_image_size(&width, &height, tiled->view_width, tiled->view_height);
+	min_scale = (float)width / tiled->source->width;
+
+	tiled->scale *= factor;
+	if (tiled->scale < min_scale)
+		tiled->scale = min_scale;
+	if (tiled->scale > TILED_MAX_SCALE)
+		tiled->scale = TILED_MAX_SCALE;
+
+	return tiled_display();
+}
+
+/*
+	Move the tiled view by the given amount of window pixels
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+static int tiled_pan(int dx, int dy)
+{
+	tiled->center_x += dx / (double)tiled->scale;
+	tiled->center_y += dy / (double)tiled->scale;
+
+	return tiled_display();
+}
+
+/*
+	Rotate the source of the tiled view, the tiles are created again
+	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
+*/
+static int tiled_rotate(float angle)
+{
+	RImage *rotated;
+
+	rotated = RRotateImage(tiled->source, angle);
+	if (!rotated)
+		return EXIT_FAILURE;
+
+	tiled_free_levels(tiled);
+	RReleaseImage(tiled->source);
+	tiled->source = rotated;
+	if (tiled_init_levels(tiled) != EXIT_SUCCESS) {
+		tiled_close();
+		return EXIT_FAILURE;
+	}
+
+	get_image_box(&tiled->view_width, &tiled->view_height);
+	tiled_fit(tiled->view_width, tiled->view_height);
+	return tiled_display();
+}
+
 /*
 	Rotate the image by the angle passed
 	Returns EXIT_SUCCESS on success, EXIT_FAILURE on failure
@@ -1110,6 +1746,9 @@ int rotate_image(float angle)
 	if (!img)
 		return EXIT_FAILURE;
 
+	if (tiled_is_current())
+		return tiled_rotate(angle);
+
 	tmp = RRotateImage(img, angle);
 	if (!tmp)
 		return EXIT_FAILURE;
@@ -1152,6 +1791,326 @@ int rotate_image_left(void)
 	return rotate_image(-90.0);
 }
 
+#ifdef HAVE_PTHREAD
+/*
+	Decode-ahead ring: worker threads prepare the images around the current
+	one (loading, orientation, checkerboard and scaling to the window size)
+	so that moving to them does not have to wait for the decoding
+*/
+#define PREFETCH_DISTANCE 3	/* images prepared on each side of the current one */
+#define PREFETCH_SLOTS (2 * PREFETCH_DISTANCE)
+#define PREFETCH_THREADS 2
+#define DEFAULT_PREFETCH_MEMORY 128	/* MiB */
+
+typedef enum {
+	SLOT_EMPTY,
+	SLOT_PENDING,
+	SLOT_BUSY,
+	SLOT_DONE
+} slot_state_t;
+
+typedef struct prefetch_slot {
+	slot_state_t state;
+	link_t *link;
+	char *path;	/* own copy, the link may be deleted while decoding */
+	int box_width;	/* area the image is prepared for */
+	int box_height;
+	int priority;
+	Bool discard;	/* not wanted anymore, drop it once decoded */
+	RImage *image;	/* NULL if it could not be prepared */
+	size_t size;
+} prefetch_slot_t;
+
+static prefetch_slot_t prefetch_slots[PREFETCH_SLOTS];
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetch_done = PTHREAD_COND_INITIALIZER;
+static pthread_t prefetch_tid[PREFETCH_THREADS];
+static int prefetch_thread_count = 0;
+static Bool prefetch_quit = False;
+static size_t prefetch_used = 0;
+static size_t prefetch_max_memory = (size_t)DEFAULT_PREFETCH_MEMORY * 1024 * 1024;
+
+/*
+	Load and prepare an image the way change_image would display it
+	Returns the image on success, NULL if it must be loaded by the main thread
+*/
+static RImage *prefetch_prepare(const char *path, int box_width, int box_height)
+{
+	const char *format;
+	RImage *image;
+	int size;
+
+	/* The XPM loader is not safe to use from a thread */
+	format = RGetImageFileFormat(path);
+	if (!format || strcmp(format, "XPM") == 0)
+		return NULL;
+
+	/* the orientation is not known yet, so the image may be rotated */
+	size = (box_width > box_height) ? box_width : box_height;
+	image = load_oriented_image_scaled(ctx, path, 0, size, size);
+	if (!image)
+		return NULL;
+
+	/* the checkerboard is drawn at the displayed size, as for the other images */
+	image = fit_image_in_box(image, box_width, box_height);
+	merge_with_background(image);
+
+	return image;
+}
+
+/*
+	Release a slot, if a worker is using it the result is dropped when it is done
+	Must be called with prefetch_lock held
+*/
+static void prefetch_free_slot(prefetch_slot_t *slot)
+{
+	if (slot->state == SLOT_BUSY) {
+		slot->discard = True;
+		slot->link = NULL;
+		return;
+	}
+	if (slot->image) {
+		RReleaseImage(slot->image);
+		prefetch_used -= slot->size;
+	}
+	free(slot->path);
+	memset(slot, 0, sizeof(*slot));
+}
+
+static void *prefetch_worker(void *arg)
+{
+	(void) arg;
+
+	pthread_mutex_lock(&prefetch_lock);
+	while (!prefetch_quit) {
+		prefetch_slot_t *slot = NULL;
+		RImage *image;
+		size_t size = 0;
+		int i;
+
+		/* the closest image to the current one first */
+		for (i = 0; i < PREFETCH_SLOTS; i++) {
+			if (prefetch_slots[i].state != SLOT_PENDING)
+				continue;
+			if (!slot || prefetch_slots[i].priority < slot->priority)
+				slot = &prefetch_slots[i];
+		}
+		if (!slot) {
+			pthread_cond_wait(&prefetch_work, &prefetch_lock);
+			continue;
+		}
+
+		slot->state = SLOT_BUSY;
+		pthread_mutex_unlock(&prefetch_lock);
+
+		image = prefetch_prepare(slot->path, slot->box_width, slot->box_height);
+		if (image)
+			size = (size_t)image->width * image->height * (image->format == RRGBAFormat ? 4 : 3);
+
+		pthread_mutex_lock(&prefetch_lock);
+		if (image && (slot->discard || prefetch_used + size > prefetch_max_memory)) {
+			RReleaseImage(image);
+			image = NULL;
+		}
+		if (slot->discard) {
+			free(slot->path);
+			memset(slot, 0, sizeof(*slot));
+		} else {
+			slot->image = image;
+			slot->size = image ? size : 0;
+			slot->state = SLOT_DONE;
+			prefetch_used += slot->size;
+		}
+		pthread_cond_broadcast(&prefetch_done);
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+
+	return NULL;
+}
+
+/*
+	Ask the workers to prepare the images around the current one
+*/
+static void prefetch_schedule(link_t *current)
+{
+	link_t *wanted[PREFETCH_SLOTS];
+	link_t *next, *prev;
+	int nwanted = 0;
+	int box_width, box_height;
+	int i, j;
+
+	if (!current || prefetch_max_memory == 0)
+		return;
+
+	/* next images first, going forward is what is done most of the time */
+	next = prev = current;
+	for (i = 0; i < PREFETCH_DISTANCE; i++) {
+		link_t *candidates[2];
+		int k;
+
+		next = next->next ? next->next : list.first;
+		prev = prev->prev ? prev->prev : list.last;
+		candidates[0] = next;
+		candidates[1] = prev;
+		for (k = 0; k < 2; k++) {
+			if (candidates[k] == current)
+				continue;
+			for (j = 0; j < nwanted; j++)
+				if (wanted[j] == candidates[k])
+					break;
+			if (j == nwanted)
+				wanted[nwanted++] = candidates[k];
+		}
+	}
+
+	get_image_box(&box_width, &box_height);
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	/* forget what is not around the current image anymore */
+	for (i = 0; i < PREFETCH_SLOTS; i++) {
+		prefetch_slot_t *slot = &prefetch_slots[i];
+
+		if (slot->state == SLOT_EMPTY || slot->discard)
+			continue;
+		for (j = 0; j < nwanted; j++)
+			if (wanted[j] == slot->link)
+				break;
+		if (j == nwanted || slot->box_width != box_width || slot->box_height != box_height)
+			prefetch_free_slot(slot);
+	}
+
+	for (j = 0; j < nwanted; j++) {
+		prefetch_slot_t *free_slot = NULL;
+
+		for (i = 0; i < PREFETCH_SLOTS; i++) {
+			if (prefetch_slots[i].state != SLOT_EMPTY && !prefetch_slots[i].discard
+			    && prefetch_slots[i].link == wanted[j])
+				break;
+			if (!free_slot && prefetch_slots[i].state == SLOT_EMPTY)
+				free_slot = &prefetch_slots[i];
+		}
+		if (i < PREFETCH_SLOTS) {
+			prefetch_slots[i].priority = j;
+			continue;
+		}
+		if (!free_slot)
+			continue;
+
+		free_slot->path = strdup((const char *)wanted[j]->data);
+		if (!free_slot->path)
+			continue;
+		free_slot->link = wanted[j];
+		free_slot->box_width = box_width;
+		free_slot->box_height = box_height;
+		free_slot->priority = j;
+		free_slot->state = SLOT_PENDING;
+	}
+
+	while (prefetch_thread_count < PREFETCH_THREADS) {
+		if (pthread_create(&prefetch_tid[prefetch_thread_count], NULL, prefetch_worker, NULL) != 0)
+			break;
+		prefetch_thread_count++;
+	}
+
+	pthread_cond_broadcast(&prefetch_work);
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/*
+	Get the image prepared for a link, waiting for it if it is being decoded
+	Returns the image ready to be displayed, NULL if it must be loaded
+*/
+static RImage *prefetch_take(link_t *link)
+{
+	RImage *image = NULL;
+	int box_width, box_height;
+	int i;
+
+	get_image_box(&box_width, &box_height);
+
+	pthread_mutex_lock(&prefetch_lock);
+	for (i = 0; i < PREFETCH_SLOTS; i++) {
+		prefetch_slot_t *slot = &prefetch_slots[i];
+
+		if (slot->state == SLOT_EMPTY || slot->discard || slot->link != link)
+			continue;
+
+		while (slot->state == SLOT_BUSY)
+			pthread_cond_wait(&prefetch_done, &prefetch_lock);
+
+		if (slot->state == SLOT_DONE && slot->box_width == box_width
+		    && slot->box_height == box_height) {
+			image = slot->image;
+			slot->image = NULL;
+			prefetch_used -= slot->size;
+		}
+		prefetch_free_slot(slot);
+		break;
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+
+	return image;
+}
+
+/*
+	Forget the image prepared for a link, or all of them if link is NULL
+*/
+static void prefetch_forget(link_t *link)
+{
+	int i;
+
+	pthread_mutex_lock(&prefetch_lock);
+	for (i = 0; i < PREFETCH_SLOTS; i++) {
+		if (prefetch_slots[i].state == SLOT_EMPTY || prefetch_slots[i].discard)
+			continue;
+		if (!link || prefetch_slots[i].link == link)
+			prefetch_free_slot(&prefetch_slots[i]);
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/*
+	Stop the worker threads and release everything
+*/
+static void prefetch_stop(void)
+{
+	int i;
+
+	pthread_mutex_lock(&prefetch_lock);
+	prefetch_quit = True;
+	pthread_cond_broadcast(&prefetch_work);
+	pthread_mutex_unlock(&prefetch_lock);
+
+	for (i = 0; i < prefetch_thread_count; i++)
+		pthread_join(prefetch_tid[i], NULL);
+	prefetch_thread_count = 0;
+
+	prefetch_forget(NULL);
+}
+#else
+static void prefetch_schedule(link_t *current)
+{
+	(void) current;
+}
+
+static RImage *prefetch_take(link_t *link)
+{
+	(void) link;
+	return NULL;
+}
+
+static void prefetch_forget(link_t *link)
+{
+	(void) link;
+}
+
+static void prefetch_stop(void)
+{
+}
+#endif
+
 /*
 	Create a red crossed image to indicate an error loading file
 	Returns the image on success, NULL on failure
@@ -1210,6 +2169,7 @@ RImage *draw_failed_image(void)
 int full_screen(void)
 {
 	XEvent xev;
+	int box_width, box_height;
 
 	Atom wm_state = XInternAtom(dpy, "_NET_WM_STATE", True);
 	Atom fullscreen = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", True);
@@ -1223,11 +2183,22 @@ int full_screen(void)
 		fullscreen_flag = True;
 		zoom_factor = 1000;
 		RReleaseImage(img);
-		img = load_oriented_image(ctx, current_link->data, 0);
-		if (!img)
+		if (tiled_is_current()) {
+			get_image_box(&tiled->view_width, &tiled->view_height);
+			tiled_fit(tiled->view_width, tiled->view_height);
+			img = tiled_render();
+		} else {
+			img = load_oriented_image(ctx, current_link->data, 0);
+		}
+		if (!img) {
 			img = draw_failed_image();
-		else
+		} else {
+			if (!tiled_is_current()) {
+				get_image_box(&box_width, &box_height);
+				img = fit_image_in_box(img, box_width, box_height);
+			}
 			merge_with_background(img);
+		}
 	}
 
 	memset(&xev, 0, sizeof(xev));
@@ -1243,6 +2214,9 @@ int full_screen(void)
 		fprintf(stderr, "Error: sending fullscreen event to xserver\n");
 		return EXIT_FAILURE;
 	}
+
+	/* the images around have to be prepared for the new size */
+	prefetch_schedule(current_link);
 	return EXIT_SUCCESS;
 }
 
@@ -1309,6 +2283,7 @@ int linked_list_del(linked_list_t *list, link_t *link)
 		list->last = link->prev;
 	}
 
+	prefetch_forget(link);
 	if (link->data)
 		free((char *)link->data);
 	free(link);
@@ -1325,6 +2300,8 @@ void linked_list_free(linked_list_t *list)
 {
 	link_t *link;
 	link_t *next;
+
+	prefetch_forget(NULL);
 	for (link = list->first; link; link = next) {
 		/* Store the next value so that we don't access freed memory. */
 		next = link->next;
@@ -1342,11 +2319,20 @@ void linked_list_free(linked_list_t *list)
 */
 int zoom_in_out(int z)
 {
+	if (tiled_is_current())
+		return tiled_zoom(z ? TILED_ZOOM_STEP : 1.0f / TILED_ZOOM_STEP);
+
 	RImage *old_img = img;
 	RImage *tmp = load_oriented_image(ctx, current_link->data, 0);
 	if (!tmp)
 		return EXIT_FAILURE;
 
+	if (tiled_open(current_link, tmp)) {
+		/* start from what is displayed now */
+		tiled->scale = (float)old_img->width / tiled->source->width;
+		return tiled_zoom(z ? TILED_ZOOM_STEP : 1.0f / TILED_ZOOM_STEP);
+	}
+
 	if (z) {
 		zoom_factor += 0.2f;
 		img = RScaleImage(tmp, tmp->width + (int)(tmp->width * zoom_factor),
@@ -1416,8 +2402,11 @@ int change_image(int way)
 	if (img && current_link) {
 		int old_img_width = img->width;
 		int old_img_height = img->height;
+		int box_width, box_height;
+		Bool prepared = False;
 
 		RReleaseImage(img);
+		tiled_close();
 
 		if (way == NEXT) {
 			current_link = current_link->next;
@@ -1437,7 +2426,11 @@ int change_image(int way)
 		}
 		if (WMIV_DEBUG)
 			fprintf(stderr, "Current file is> %s\n", (char *)current_link->data);
-		img = load_oriented_image(ctx, current_link->data, 0);
+		img = prefetch_take(current_link);
+		if (img)
+			prepared = True;
+		else
+			img = load_oriented_image(ctx, current_link->data, 0);
 		if (!img) {
 			if (strlen((char *)current_link->data) == 0)
 				fprintf(stderr, "Error: %s\n", RMessageForError(RErrorCode));
@@ -1463,7 +2456,15 @@ int change_image(int way)
 				max_index = list.count;
 				return change_image(way);
 			}
-		} else {
+		} else if (!prepared) {
+			if (tiled_open(current_link, img)) {
+				img = tiled_render();
+				if (!img)
+					img = draw_failed_image();
+			} else {
+				get_image_box(&box_width, &box_height);
+				img = fit_image_in_box(img, box_width, box_height);
+			}
 			merge_with_background(img);
 		}
 		rescale_image();
@@ -1480,6 +2481,7 @@ int change_image(int way)
 					img->width, img->height, max_width/2-img->width/2, max_height/2-img->height/2);
 			}
 		}
+		prefetch_schedule(current_link);
 		return EXIT_SUCCESS;
 	}
 	return EXIT_FAILURE;
@@ -1707,6 +2709,7 @@ int main(int argc, char **argv)
 	KeySym keysym;
 	char *reading_filename = "";
 	int screen_num, file_i;
+	int box_width, box_height;
 	int quit = 0;
 	XClassHint *class_hints;
 	XSizeHints *size_hints;
@@ -1738,19 +2741,25 @@ int main(int argc, char **argv)
 	static struct option long_options[] = {
 		{"help", no_argument, 0, 'h'},
 		{"ignore-unknown", no_argument, 0, 'i'},
+#ifdef HAVE_PTHREAD
+		{"prefetch-memory", required_argument, 0, 'm'},
+#endif
 		{"version", no_argument, 0, 'v'},
 		{0, 0, 0, 0}
 	};
 	int option_index = 0;
 
-	option = getopt_long (argc, argv, "hiv", long_options, &option_index);
-	if (option != -1) {
+	while ((option = getopt_long(argc, argv, "him:v", long_options, &option_index)) != -1) {
 		switch (option) {
 		case 'h':
 			printf("Usage: %s [image(s)|directory|archive]\n"
 			"Options:\n"
 			"  -h, --help            display this help and exit\n"
 			"  -i, --ignore-unknown  ignore unknown image format\n"
+#ifdef HAVE_PTHREAD
+			"  -m, --prefetch-memory=MiB\n"
+			"                        memory used to prepare the next images (default %d)\n"
+#endif
 			"  -v, --version         print version\n"
 			"\nKeys:\n\n"
 			"  [+]            zoom in\n"
@@ -1759,6 +2768,7 @@ int main(int argc, char **argv)
 			"  [◂]            previous image\n"
 			"  [▴]            first image\n"
 			"  [▾]            last image\n"
+			"  [Shift+arrows] move around in a large image\n"
 			"  [Ctrl+C]       copy image to clipboard\n"
 #ifdef HAVE_PTHREAD
 			"  [D]            start slideshow\n"
@@ -1768,7 +2778,11 @@ int main(int argc, char **argv)
 			"  [L]            rotate image on the left\n"
 			"  [Q]            quit\n"
 			"  [R]            rotate image on the right\n",
-			argv[0]);
+			argv[0]
+#ifdef HAVE_PTHREAD
+			, DEFAULT_PREFETCH_MEMORY
+#endif
+			);
 			return EXIT_SUCCESS;
 		case 'v':
 			printf("%s version %s\n", APPNAME, VERSION);
@@ -1776,6 +2790,11 @@ int main(int argc, char **argv)
 		case 'i':
 			ignore_unknown_file_format = True;
 			break;
+#ifdef HAVE_PTHREAD
+		case 'm':
+			prefetch_max_memory = (size_t)strtoul(optarg, NULL, 10) * 1024 * 1024;
+			break;
+#endif
 		case '?':
 			return EXIT_FAILURE;
 		}
@@ -1811,12 +2830,12 @@ int main(int argc, char **argv)
 	attr.colors_per_channel = 4;
 	ctx = RCreateContext(dpy, screen_num, &attr);
 
-	if (argc < 2) {
-		argv[1] = ".";
-		argc = 2;
+	if (optind >= argc) {
+		argv[optind] = ".";
+		argc = optind + 1;
 	}
 
-	for (file_i = 1; file_i < argc; file_i++) {
+	for (file_i = optind; file_i < argc; file_i++) {
 		/* Check if this is an archive file */
 		if (is_archive_file(argv[file_i])) {
 			char *extracted_dir = extract_archive(argv[file_i]);
@@ -1854,6 +2873,13 @@ int main(int argc, char **argv)
 			if (current_link)
 				reading_filename = (char *)current_link->data;
 		}
+	} else if (current_link && tiled_open(current_link, img)) {
+		img = tiled_render();
+		if (!img)
+			img = draw_failed_image();
+	} else {
+		get_image_box(&box_width, &box_height);
+		img = fit_image_in_box(img, box_width, box_height);
 	}
 
 	merge_with_background(img);
@@ -1969,6 +2995,8 @@ int main(int argc, char **argv)
 	XResizeWindow(dpy, win, img->width, img->height);
 	XSync(dpy, True);
 
+	prefetch_schedule(current_link);
+
 	/* Main event loop */
 	while (!quit) {
 		XNextEvent(dpy, &e);
@@ -2094,6 +3122,21 @@ int main(int argc, char **argv)
 				continue;
 			}
 
+			if (tiled_is_current()) {
+				if (back_from_fullscreen) {
+					back_from_fullscreen = False;
+					get_image_box(&tiled->view_width, &tiled->view_height);
+					tiled_fit(tiled->view_width, tiled->view_height);
+					tiled_display();
+				} else if (xce.width != img->width || xce.height != img->height) {
+					/* show more or less of the image at the same scale */
+					tiled->view_width = xce.width;
+					tiled->view_height = xce.height;
+					tiled_display();
+				}
+				continue;
+			}
+
 			if (xce.width != img->width || xce.height != img->height) {
 				RImage *old_img = img;
 				img = load_oriented_image(ctx, current_link->data, 0);
@@ -2146,6 +3189,12 @@ int main(int argc, char **argv)
 				drag_start_y = e.xbutton.y;
 			}
 			break;
+			case Button2:
+				/* drag the image when it is displayed with tiles */
+				button2_pressed = True;
+				drag_start_x = e.xbutton.x;
+				drag_start_y = e.xbutton.y;
+				break;
 			case Button4:
 				zoom_in();
 				break;
@@ -2162,6 +3211,8 @@ int main(int argc, char **argv)
 			continue;
 		}
 		if (e.type == ButtonRelease) {
+			if (e.xbutton.button == Button2)
+				button2_pressed = False;
 			if (e.xbutton.button == Button1 && button1_pressed) {
 				/* Button released without dragging - treat as click for image navigation */
 				button1_pressed = False;
@@ -2174,6 +3225,17 @@ int main(int argc, char **argv)
 			}
 			continue;
 		}
+		if (e.type == MotionNotify && button2_pressed) {
+			if (tiled_is_current()) {
+				/* only the last position matters */
+				while (XCheckTypedWindowEvent(dpy, win, MotionNotify, &e))
+					;
+				tiled_pan(drag_start_x - e.xmotion.x, drag_start_y - e.xmotion.y);
+				drag_start_x = e.xmotion.x;
+				drag_start_y = e.xmotion.y;
+			}
+			continue;
+		}
 		if (e.type == MotionNotify && button1_pressed) {
 			/* Check if we've moved enough to start a drag */
 			int dx = e.xmotion.x - drag_start_x;
@@ -2199,6 +3261,27 @@ int main(int argc, char **argv)
 				continue;
 			}
 
+			/* Shift+arrows move around in an image displayed with tiles */
+			if ((e.xkey.state & ShiftMask) && tiled_is_current()) {
+				int step_x = img->width / 4;
+				int step_y = img->height / 4;
+
+				switch (keysym) {
+				case XK_Right:
+					tiled_pan(step_x, 0);
+					continue;
+				case XK_Left:
+					tiled_pan(-step_x, 0);
+					continue;
+				case XK_Up:
+					tiled_pan(0, -step_y);
+					continue;
+				case XK_Down:
+					tiled_pan(0, step_y);
+					continue;
+				}
+			}
+
 			switch (keysym) {
 			case XK_Right:
 				change_image(NEXT);
@@ -2235,7 +3318,9 @@ int main(int argc, char **argv)
 				quit = 1;
 				break;
 			case XK_Escape:
-				if (!fullscreen_flag) {
+				if (!fullscreen_flag && tiled_is_current()) {
+					tiled_zoom(1.0f / tiled->scale);
+				} else if (!fullscreen_flag) {
 					zoom_factor = -0.2f;
 					zoom_in();
 				} else {
@@ -2263,6 +3348,8 @@ int main(int argc, char **argv)
 		}
 	}
 
+	prefetch_stop();
+	tiled_close();
 	if (img)
 		RReleaseImage(img);
 	if (pix)
@@ -37,6 +37,10 @@
 #include <pwd.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_SELECT_H
+# include <sys/select.h>
+#endif
 #include <ctype.h>
 
 #ifdef USE_XINERAMA
@@ -95,8 +99,24 @@ typedef struct BackgroundTexture {
 	Pixmap pixmap;		/* for all textures, including solid */
 	int width;		/* size of the pixmap */
 	int height;
+
+	/* used by the helper to keep only some of the textures rendered */
+	int invalid;		/* rendering failed, do not try again */
+	unsigned long size;	/* memory used by the pixmap, 0 = not known yet */
+	unsigned long lastUsed;
 } BackgroundTexture;
 
+/*
+ * The helper keeps the pixmaps of the textures shown recently, and of the
+ * ones likely to be shown next, as long as they use less than this amount of
+ * memory in the X server; the least recently used are released first
+ */
+#define DEFAULT_CACHE_SIZE	64	/* in MiB, WMSETBG_CACHE_SIZE overrides it */
+
+static unsigned long cacheSize;
+static unsigned long cacheUsed = 0;
+static unsigned long useCounter = 0;
+
 static noreturn void quit(int rcode)
 {
 	WMReleaseApplication();
@@ -147,7 +167,11 @@ static void initXinerama(void)
 #endif				/* USE_XINERAMA */
 }
 
-static RImage *loadImage(RContext * rc, const char *file)
+/*
+ * Load the image for a texture; if max_width/max_height are not 0 the image
+ * is reduced to fit in that size while it is being decoded
+ */
+static RImage *loadImage(RContext * rc, const char *file, unsigned max_width, unsigned max_height)
 {
 	char *path;
 	RImage *image;
@@ -162,7 +186,7 @@ static RImage *loadImage(RContext * rc, const char *file)
 		path = wstrdup(file);
 	}
 
-	image = RLoadImage(rc, path, 0);
+	image = RLoadImageScaled(rc, path, 0, max_width, max_height);
 	if (!image) {
 		wwarning("%s:could not load image file used in texture:%s", path, RMessageForError(RErrorCode));
 	}
@@ -266,9 +290,13 @@ applyImage(RContext * rc, BackgroundTexture * texture, RImage * image, char type
 	}
 }
 
-static BackgroundTexture *parseTexture(RContext * rc, char *text)
+/*
+ * Render the texture described by texture->spec, filling its pixmap, color
+ * and size; returns False if the texture could not be rendered
+ */
+static Bool renderTexture(RContext * rc, BackgroundTexture * texture)
 {
-	BackgroundTexture *texture = NULL;
+	char *text = texture->spec;
 	WMPropList *texarray;
 	WMPropList *val;
 	int count;
@@ -290,11 +318,9 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 		wwarning("could not parse texture %s", text);
 		if (texarray)
 			WMReleasePropList(texarray);
-		return NULL;
+		return False;
 	}
 
-	texture = wmalloc(sizeof(BackgroundTexture));
-
 	GETSTRORGOTO(val, type, 0, error);
 
 	if (strcasecmp(type, "solid") == 0) {
@@ -497,7 +523,14 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 		 */
 
 		if (!pixmap) {
-			image = loadImage(rc, tmp);
+			/*
+			 * When the image is scaled to fit the screen, there is no need
+			 * to decode it at full size if it is bigger
+			 */
+			if (toupper(type[0]) == 'M')
+				image = loadImage(rc, tmp, scrWidth, scrHeight);
+			else
+				image = loadImage(rc, tmp, 0, 0);
 			if (!image) {
 				goto error;
 			}
@@ -627,7 +660,7 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 		color2.green = color.green >> 8;
 		color2.blue = color.blue >> 8;
 
-		image = loadImage(rc, file);
+		image = loadImage(rc, file, 0, 0);
 		if (!image) {
 			goto error;
 		}
@@ -692,21 +725,43 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 		goto error;
 	}
 
-	texture->spec = wstrdup(text);
+	WMReleasePropList(texarray);
 
-	return texture;
+	return True;
 
  error:
-	if (texture)
-		wfree(texture);
+	texture->solid = 0;
 	if (texarray)
 		WMReleasePropList(texarray);
 
-	return NULL;
+	return False;
 }
 
-static void freeTexture(BackgroundTexture * texture)
+static BackgroundTexture *parseTexture(RContext * rc, char *text)
 {
+	BackgroundTexture *texture;
+
+	texture = wmalloc(sizeof(BackgroundTexture));
+	texture->spec = wstrdup(text);
+
+	if (!renderTexture(rc, texture)) {
+		wfree(texture->spec);
+		wfree(texture);
+		return NULL;
+	}
+
+	return texture;
+}
+
+/*
+ * Free what was rendered for the texture, but keep its description so it
+ * can be rendered again
+ */
+static void releaseTexture(BackgroundTexture * texture)
+{
+	if (texture->pixmap == None)
+		return;
+
 	if (texture->solid) {
 		unsigned long pixel[1];
 
@@ -716,27 +771,40 @@ static void freeTexture(BackgroundTexture * texture)
 		    && pixel[0] != WhitePixelOfScreen(DefaultScreenOfDisplay(dpy)))
 			XFreeColors(dpy, DefaultColormap(dpy, scr), pixel, 1, 0);
 	}
-	if (texture->pixmap) {
-		XFreePixmap(dpy, texture->pixmap);
-	}
+	XFreePixmap(dpy, texture->pixmap);
+	texture->pixmap = None;
+	cacheUsed -= texture->size;
+}
+
+static void freeTexture(BackgroundTexture * texture)
+{
+	releaseTexture(texture);
 	wfree(texture->spec);
 	wfree(texture);
 }
 
-static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxTextures, int workspace, char *texture)
+static void unsetTexture(BackgroundTexture ** textures, int workspace)
+{
+	if (textures[workspace] != NULL) {
+		textures[workspace]->refcount--;
+
+		if (textures[workspace]->refcount == 0)
+			freeTexture(textures[workspace]);
+	}
+	textures[workspace] = NULL;
+}
+
+/*
+ * Only remember the texture for the workspace, it is rendered when it is
+ * shown for the first time or before that if the helper has nothing to do
+ */
+static void setupTexture(BackgroundTexture ** textures, int workspace, char *texture)
 {
 	BackgroundTexture *newTexture = NULL;
 	int i;
 
-	/* unset the texture */
 	if (!texture) {
-		if (textures[workspace] != NULL) {
-			textures[workspace]->refcount--;
-
-			if (textures[workspace]->refcount == 0)
-				freeTexture(textures[workspace]);
-		}
-		textures[workspace] = NULL;
+		unsetTexture(textures, workspace);
 		return;
 	}
 
@@ -746,8 +814,11 @@ static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxT
 		return;
 	}
 
-	/* check if the same texture is already created */
-	for (i = 0; i < *maxTextures; i++) {
+	/*
+	 * Workspaces with the same texture share the pixmap; the screen size
+	 * does not change during the life of the helper so the spec is enough
+	 */
+	for (i = 0; i < WORKSPACE_COUNT; i++) {
 		if (textures[i] && strcasecmp(textures[i]->spec, texture) == 0) {
 			newTexture = textures[i];
 			break;
@@ -755,25 +826,147 @@ static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxT
 	}
 
 	if (!newTexture) {
-		/* create the texture */
-		newTexture = parseTexture(rc, texture);
+		newTexture = wmalloc(sizeof(BackgroundTexture));
+		newTexture->spec = wstrdup(texture);
 	}
-	if (!newTexture)
-		return;
 
-	if (textures[workspace] != NULL) {
+	newTexture->refcount++;
+	unsetTexture(textures, workspace);
+	textures[workspace] = newTexture;
+}
 
-		textures[workspace]->refcount--;
+static unsigned long pixmapSize(int width, int height)
+{
+	int depth = DefaultDepth(dpy, scr);
+	int bpp;
 
-		if (textures[workspace]->refcount == 0)
-			freeTexture(textures[workspace]);
+	if (depth > 16)
+		bpp = 4;
+	else if (depth > 8)
+		bpp = 2;
+	else
+		bpp = 1;
+
+	return (unsigned long) width * height * bpp;
+}
+
+static Bool loadTexture(RContext * rc, BackgroundTexture * texture)
+{
+	if (texture->pixmap != None)
+		return True;
+	if (texture->invalid)
+		return False;
+
+	if (!renderTexture(rc, texture)) {
+		texture->invalid = 1;
+		return False;
 	}
+	texture->size = pixmapSize(texture->width, texture->height);
+	cacheUsed += texture->size;
 
-	newTexture->refcount++;
-	textures[workspace] = newTexture;
+	return True;
+}
+
+/*
+ * Release the least recently used pixmaps until we are below the memory
+ * budget, but never the one in 'keep'
+ */
+static void trimCache(BackgroundTexture ** textures, BackgroundTexture * keep)
+{
+	while (cacheUsed > cacheSize) {
+		BackgroundTexture *oldest = NULL;
+		int i;
+
+		for (i = 0; i < WORKSPACE_COUNT; i++) {
+			BackgroundTexture *tex = textures[i];
+
+			if (!tex || tex == keep || tex->pixmap == None)
+				continue;
+			if (!oldest || tex->lastUsed < oldest->lastUsed)
+				oldest = tex;
+		}
+		if (!oldest)
+			break;
+
+		releaseTexture(oldest);
+	}
+}
+
+static BackgroundTexture *getWorkspaceTexture(BackgroundTexture ** textures, int workspace)
+{
+	if (workspace < 0 || workspace >= WORKSPACE_COUNT || !textures[workspace])
+		return textures[0];
+
+	return textures[workspace];
+}
+
+/*
+ * Render one of the textures of the workspaces next to the current one, if
+ * it fits in the memory budget. Returns False when there is nothing to do
+ */
+static Bool prerenderTexture(RContext * rc, BackgroundTexture ** textures, int current)
+{
+	int distance, side;
 
-	if (*maxTextures < workspace)
-		*maxTextures = workspace;
+	for (distance = 0; distance < WORKSPACE_COUNT; distance++) {
+		for (side = -1; side <= 1; side += 2) {
+			BackgroundTexture *tex;
+			unsigned long size;
+			int workspace = current + side * distance;
+
+			/* workspace 0 is the default, it is used for the ones without texture */
+			if (workspace < 1 || workspace >= WORKSPACE_COUNT)
+				continue;
+
+			tex = getWorkspaceTexture(textures, workspace);
+			if (!tex || tex->pixmap != None || tex->invalid)
+				continue;
+
+			size = tex->size ? tex->size : pixmapSize(scrWidth, scrHeight);
+			if (cacheUsed + size > cacheSize)
+				continue;
+
+			if (loadTexture(rc, tex)) {
+				tex->lastUsed = useCounter;
+
+				/* The guess for its size was wrong, now we know it */
+				if (cacheUsed > cacheSize)
+					releaseTexture(tex);
+			}
+
+			return True;
+		}
+	}
+
+	return False;
+}
+
+static Bool inputPending(int fd)
+{
+	fd_set rset;
+	struct timeval timeout;
+
+	FD_ZERO(&rset);
+	FD_SET(fd, &rset);
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 0;
+
+	return select(fd + 1, &rset, NULL, NULL, &timeout) > 0;
+}
+
+static void initCacheSize(void)
+{
+	const char *env;
+	long size = DEFAULT_CACHE_SIZE;
+
+	env = getenv("WMSETBG_CACHE_SIZE");
+	if (env) {
+		size = strtol(env, NULL, 10);
+		if (size < 0)
+			size = DEFAULT_CACHE_SIZE;
+	}
+
+	cacheSize = (unsigned long) size * 1024UL * 1024UL;
 }
 
 static Pixmap duplicatePixmap(Pixmap pixmap, int width, int height)
@@ -900,17 +1093,28 @@ static int readmsg(int fd, char *buffer, int size)
 static noreturn void helperLoop(RContext * rc)
 {
 	BackgroundTexture *textures[WORKSPACE_COUNT];
-	int maxTextures = 0;
+	BackgroundTexture *tex;
+	int currentWorkspace = 1;
 	char buffer[2048], buf[8];
-	int size;
+	int size, i;
 	int errcount = 4;
 
 	memset(textures, 0, WORKSPACE_COUNT * sizeof(BackgroundTexture *));
 	memset(buffer, 0, sizeof(buffer));
 
+	initCacheSize();
+
 	while (1) {
 		int workspace = -1;
 
+		/*
+		 * While Window Maker has nothing for us, prepare the backgrounds
+		 * that will probably be needed next, one at a time so that a
+		 * workspace change does not have to wait for all of them
+		 */
+		while (!inputPending(0) && prerenderTexture(rc, textures, currentWorkspace))
+			;
+
 		/* get length of message */
 		if (readmsg(0, buffer, 4) < 0) {
 			werror("error reading message from Window Maker");
@@ -961,17 +1165,26 @@ static noreturn void helperLoop(RContext * rc)
 #ifdef DEBUG
 			printf("set texture %s\n", &buffer[5]);
 #endif
-			setupTexture(rc, textures, &maxTextures, workspace, &buffer[5]);
+			setupTexture(textures, workspace, &buffer[5]);
 			break;
 
 		case 'C':
 #ifdef DEBUG
 			printf("change texture %i\n", workspace);
 #endif
-			if (!textures[workspace]) {
-				changeTexture(textures[0]);
-			} else {
-				changeTexture(textures[workspace]);
+			currentWorkspace = workspace;
+
+			tex = getWorkspaceTexture(textures, workspace);
+			if (tex && !loadTexture(rc, tex)) {
+				/* use the default one if the texture is not valid */
+				tex = textures[0];
+				if (tex && !loadTexture(rc, tex))
+					tex = NULL;
+			}
+			if (tex) {
+				tex->lastUsed = ++useCounter;
+				changeTexture(tex);
+				trimCache(textures, tex);
 			}
 			break;
 
@@ -982,13 +1195,18 @@ static noreturn void helperLoop(RContext * rc)
 			if (PixmapPath)
 				wfree(PixmapPath);
 			PixmapPath = wstrdup(&buffer[1]);
+
+			/* the images that were not found may be there now */
+			for (i = 0; i < WORKSPACE_COUNT; i++)
+				if (textures[i])
+					textures[i]->invalid = 0;
 			break;
 
 		case 'U':
 #ifdef DEBUG
 			printf("unset workspace %i\n", workspace);
 #endif
-			setupTexture(rc, textures, &maxTextures, workspace, NULL);
+			setupTexture(textures, workspace, NULL);
 			break;
 
 		case 'K':
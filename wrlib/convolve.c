@@ -24,9 +24,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <stdint.h>
 #include <X11/Xlib.h>
 
 #include "wraster.h"
+#include "parallel.h"
 #include "wr_i18n.h"
 
 
@@ -46,6 +49,9 @@ int RBlurImage(RImage * image)
 	unsigned char *pptr = NULL, *tmpp;
 	int ch = image->format == RRGBAFormat ? 4 : 3;
 
+	if (!RMakeImageWritable(image))
+		return False;
+
 	pptr = malloc(image->width * ch);
 	if (!pptr) {
 		RErrorCode = RERR_NOMEMORY;
@@ -143,3 +149,257 @@ int RBlurImage(RImage * image)
 	return True;
 }
 
+
+
+/*
+ * Box blur with arbitrary radius
+ *
+ * The filter is separable, so it is done as an horizontal pass followed by a
+ * vertical pass. Each pass uses a running sum, so the cost per pixel does not
+ * depend on the radius. Pixels outside the image are considered to have the
+ * same value as the closest pixel on the border.
+ *
+ * The division by the size of the box is replaced by a multiplication by
+ * its inverse in 8.24 fixed point; the sum being at most 255 * size it always
+ * fits in 32 bits.
+ */
+
+/* Width of the column bands processed by the vertical pass, in bytes */
+#define BLUR_BAND_SIZE	512
+
+typedef struct {
+	const unsigned char *src;
+	unsigned char *dst;
+	int width, height;
+	int channels;
+	int radius;
+	uint32_t inverse;
+} blur_pass;
+
+static inline void blur_step(unsigned char *dst, uint32_t *sum, const unsigned char *add,
+                             const unsigned char *sub, const int channels, uint32_t inverse)
+{
+	int c;
+
+	for (c = 0; c < channels; c++) {
+		dst[c] = (sum[c] * inverse + (1 << 23)) >> 24;
+		sum[c] += add[c] - sub[c];
+	}
+}
+
+static inline void blur_row(const unsigned char *src, unsigned char *dst,
+                            int width, const int channels, int radius, uint32_t inverse)
+{
+	const unsigned char *last = src + (width - 1) * channels;
+	uint32_t sum[4];
+	int x, c, i;
+
+	for (c = 0; c < channels; c++)
+		sum[c] = (radius + 1) * src[c];
+	for (i = 1; i <= radius; i++) {
+		const unsigned char *p = (i < width) ? src + i * channels : last;
+
+		for (c = 0; c < channels; c++)
+			sum[c] += p[c];
+	}
+
+	/*
+	 * The loop is split in 3 parts so the clamping to the border only
+	 * happens where it is needed
+	 */
+	for (x = 0; x < width && x <= radius; x++) {
+		const unsigned char *add = (x + radius + 1 < width) ? src + (x + radius + 1) * channels : last;
+
+		blur_step(dst + x * channels, sum, add, src, channels, inverse);
+	}
+
+	for (; x + radius + 1 < width; x++)
+		blur_step(dst + x * channels, sum, src + (x + radius + 1) * channels,
+			  src + (x - radius) * channels, channels, inverse);
+
+	for (; x < width; x++)
+		blur_step(dst + x * channels, sum, last, src + (x - radius) * channels, channels, inverse);
+}
+
+static void blur_horizontal(void *data, int start, int end)
+{
+	const blur_pass *pass = data;
+	int stride = pass->width * pass->channels;
+	int y;
+
+	for (y = start; y < end; y++) {
+		/* Give the compiler a constant channel count to unroll/vectorise on */
+		if (pass->channels == 4)
+			blur_row(pass->src + y * stride, pass->dst + y * stride,
+				 pass->width, 4, pass->radius, pass->inverse);
+		else
+			blur_row(pass->src + y * stride, pass->dst + y * stride,
+				 pass->width, 3, pass->radius, pass->inverse);
+	}
+}
+
+static inline void blur_band(unsigned char *restrict dst, uint32_t *restrict sum,
+                             const unsigned char *restrict add, const unsigned char *restrict sub,
+                             const int size, uint32_t inverse)
+{
+	int i;
+
+	for (i = 0; i < size; i++) {
+		dst[i] = (sum[i] * inverse + (1 << 23)) >> 24;
+		sum[i] += add[i] - sub[i];
+	}
+}
+
+static void blur_vertical(void *data, int start, int end)
+{
+	const blur_pass *pass = data;
+	uint32_t sum[BLUR_BAND_SIZE];
+	int stride = pass->width * pass->channels;
+	int band, y, i;
+
+	for (band = start; band < end; band++) {
+		int offset = band * BLUR_BAND_SIZE;
+		int size = stride - offset;
+		const unsigned char *src = pass->src + offset;
+		unsigned char *dst = pass->dst + offset;
+
+		if (size > BLUR_BAND_SIZE)
+			size = BLUR_BAND_SIZE;
+
+		for (i = 0; i < size; i++)
+			sum[i] = (pass->radius + 1) * src[i];
+		for (y = 1; y <= pass->radius; y++) {
+			const unsigned char *p = src + ((y < pass->height) ? y : pass->height - 1) * stride;
+
+			for (i = 0; i < size; i++)
+				sum[i] += p[i];
+		}
+
+		for (y = 0; y < pass->height; y++) {
+			const unsigned char *add, *sub;
+			int yadd = y + pass->radius + 1;
+			int ysub = y - pass->radius;
+
+			add = src + ((yadd < pass->height) ? yadd : pass->height - 1) * stride;
+			sub = src + ((ysub > 0) ? ysub : 0) * stride;
+
+			/* A constant trip count lets the compiler vectorise the full bands */
+			if (size == BLUR_BAND_SIZE)
+				blur_band(dst, sum, add, sub, BLUR_BAND_SIZE, pass->inverse);
+			else
+				blur_band(dst, sum, add, sub, size, pass->inverse);
+			dst += stride;
+		}
+	}
+}
+
+static int box_blur_passes(RImage *image, const int *radius, int npasses)
+{
+	blur_pass pass;
+	unsigned char *tmp;
+	unsigned long npixels;
+	int stride, i;
+
+	pass.width = image->width;
+	pass.height = image->height;
+	pass.channels = (image->format == RRGBAFormat) ? 4 : 3;
+	stride = pass.width * pass.channels;
+	npixels = (unsigned long) pass.width * pass.height;
+
+	if (!RMakeImageWritable(image))
+		return False;
+
+	tmp = malloc(stride * pass.height);
+	if (!tmp) {
+		RErrorCode = RERR_NOMEMORY;
+		return False;
+	}
+
+	for (i = 0; i < npasses; i++) {
+		if (radius[i] <= 0)
+			continue;
+
+		pass.radius = radius[i];
+		pass.inverse = (1UL << 24) / (2 * radius[i] + 1);
+
+		pass.src = image->data;
+		pass.dst = tmp;
+		wraster_parallel_run(pass.height, npixels, blur_horizontal, &pass);
+
+		pass.src = tmp;
+		pass.dst = image->data;
+		wraster_parallel_run((stride + BLUR_BAND_SIZE - 1) / BLUR_BAND_SIZE, npixels,
+				     blur_vertical, &pass);
+	}
+
+	free(tmp);
+
+	return True;
+}
+
+/*
+ * Past the size of the image every pixel gets the same value whatever the
+ * radius, so clamp it there; it also keeps the sums within 32 bits and the
+ * inverse of the box size non-zero in 8.24 fixed point
+ */
+static int clamp_blur_radius(const RImage *image, unsigned radius)
+{
+	unsigned size = (unsigned) ((image->width > image->height) ? image->width : image->height);
+
+	return (radius > size) ? size : radius;
+}
+
+/*
+ *----------------------------------------------------------------------
+ * RBoxBlurImage--
+ * 	Apply a box filter of (2 * radius + 1) pixels to the image.
+ *----------------------------------------------------------------------
+ */
+int RBoxBlurImage(RImage *image, unsigned radius)
+{
+	int r;
+
+	if (radius == 0 || image->width < 1 || image->height < 1)
+		return True;
+
+	r = clamp_blur_radius(image, radius);
+	return box_blur_passes(image, &r, 1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ * RGaussianBlurImage--
+ * 	Apply a gaussian blur to the image, with a standard deviation of
+ * radius / 3 so that the kernel is about radius pixels on each side.
+ *
+ * 	The gaussian is approximated by 3 successive box filters whose sizes
+ * are chosen to get the same variance (W. Wells, "Efficient synthesis of
+ * gaussian filters by cascaded uniform filters", 1986).
+ *----------------------------------------------------------------------
+ */
+int RGaussianBlurImage(RImage *image, unsigned radius)
+{
+	const int npasses = 3;
+	int r[3];
+	double sigma, w_ideal;
+	int wl, wu, m, i;
+
+	if (radius == 0 || image->width < 1 || image->height < 1)
+		return True;
+
+	sigma = (double) clamp_blur_radius(image, radius) / 3.0;
+
+	w_ideal = sqrt(12.0 * sigma * sigma / npasses + 1.0);
+	wl = (int) floor(w_ideal);
+	if (wl % 2 == 0)
+		wl--;
+	wu = wl + 2;
+
+	m = (int) floor((12.0 * sigma * sigma - npasses * wl * wl - 4 * npasses * wl - 3 * npasses)
+			/ (-4.0 * wl - 4.0) + 0.5);
+
+	for (i = 0; i < npasses; i++)
+		r[i] = ((i < m) ? wl : wu) / 2;
+
+	return box_blur_passes(image, r, npasses);
+}
@@ -72,6 +72,9 @@ void RPutPixel(RImage *image, int x, int y, const RColor *color)
 	if (x < 0 || x >= image->width || y < 0 || y >= image->height)
 		return;
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	if (image->format == RRGBAFormat) {
 		ptr = image->data + (y * image->width + x) * 4;
 	} else {
@@ -181,6 +184,9 @@ void ROperatePixel(RImage *image, RPixelOperation operation, int x, int y, const
 	assert(x >= 0 && x < image->width);
 	assert(y >= 0 && y < image->height);
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	ofs = y * image->width + x;
 
 	operatePixel(image, ofs, operation, color);
@@ -301,6 +307,9 @@ static int genericLine(RImage *image, int x0, int y0, int x1, int y1, const RCol
 	if (!clipLineInRectangle(0, 0, image->width - 1, image->height - 1, &x0, &y0, &x1, &y1))
 		return True;
 
+	if (!RMakeImageWritable(image))
+		return False;
+
 	if (x0 < x1) {
 		du = x1 - x0;
 		uofs = 1;
@@ -58,11 +58,11 @@ RImage *RLoadTIFF(const char *file, int index);
 #endif
 
 #ifdef USE_PNG
-RImage *RLoadPNG(RContext *context, const char *file);
+RImage *RLoadPNG(RContext *context, const char *file, unsigned max_width, unsigned max_height);
 #endif
 
 #ifdef USE_JPEG
-RImage *RLoadJPEG(const char *file);
+RImage *RLoadJPEG(const char *file, unsigned max_width, unsigned max_height);
 #endif
 
 #ifdef USE_JXL
@@ -74,7 +74,7 @@ RImage *RLoadGIF(const char *file, int index);
 #endif
 
 #ifdef USE_WEBP
-RImage *RLoadWEBP(const char *file);
+RImage *RLoadWEBP(const char *file, unsigned max_width, unsigned max_height);
 #endif
 
 #ifdef USE_MAGICK
@@ -89,8 +89,8 @@ void RReleaseMagick(void);
 Bool RSaveXPM(RImage *image, const char *filename);
 
 #ifdef USE_PNG
-Bool RSavePNG(RImage *image, const char *filename, char *title);
-Bool RSaveRawPNG(RImage *image, char *title, unsigned char **out_buf, size_t *out_size);
+Bool RSavePNG(RImage *image, const char *filename, char *title, int level);
+Bool RSaveRawPNG(RImage *image, char *title, unsigned char **out_buf, size_t *out_size, int level);
 #endif
 
 #ifdef USE_JPEG
@@ -34,6 +34,10 @@
 #include <time.h>
 #include <assert.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "wraster.h"
 #include "imgformat.h"
 #include "wr_i18n.h"
@@ -65,6 +69,16 @@ static int RImageCacheMaxImage = -1;	/* 0 = any size */
 
 static RCachedImage *RImageCache;
 
+/* RLoadImageScaled can be called from several threads */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_CACHE()	pthread_mutex_lock(&cache_lock)
+#define UNLOCK_CACHE()	pthread_mutex_unlock(&cache_lock)
+#else
+#define LOCK_CACHE()
+#define UNLOCK_CACHE()
+#endif
+
 
 static WRImgFormat identFile(const char *path);
 
@@ -141,6 +155,7 @@ void RReleaseCache(void)
 {
 	int i;
 
+	LOCK_CACHE();
 	if (RImageCacheSize > 0) {
 		for (i = 0; i < RImageCacheSize; i++) {
 			if (RImageCache[i].file) {
@@ -152,21 +167,20 @@ void RReleaseCache(void)
 		RImageCache = NULL;
 		RImageCacheSize = -1;
 	}
+	UNLOCK_CACHE();
 }
 
-RImage *RLoadImage(RContext *context, const char *file, int index)
+/*
+ * Return a copy of the image from the cache if it is there and is still
+ * up to date with the file on disk
+ */
+static RImage *get_cached_image(const char *file)
 {
 	RImage *image = NULL;
 	int i;
 	struct stat st;
 
-	assert(file != NULL);
-
-	/* just to suppress the compilation warning as index is only used with TIFF and GIF */
-#if !defined(USE_TIFF) && !defined(USE_GIF)
-	(void)index;
-#endif
-
+	LOCK_CACHE();
 	if (RImageCacheSize < 0)
 		init_cache();
 
@@ -177,8 +191,8 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 
 				if (stat(file, &st) == 0 && st.st_mtime == RImageCache[i].last_modif) {
 					RImageCache[i].last_use = time(NULL);
-
-					return RCloneImage(RImageCache[i].image);
+					image = RCloneImage(RImageCache[i].image);
+					break;
 
 				} else {
 					free(RImageCache[i].file);
@@ -188,6 +202,84 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 			}
 		}
 	}
+	UNLOCK_CACHE();
+
+	return image;
+}
+
+/*
+ * Keep a copy of the image loaded from the file in the cache, if it is
+ * small enough
+ */
+static void put_cached_image(const char *file, RImage *image)
+{
+	time_t oldest;
+	int oldest_idx = 0;
+	int done = 0;
+	int i;
+	struct stat st;
+
+	LOCK_CACHE();
+	if (RImageCacheSize <= 0 ||
+	    (RImageCacheMaxImage != 0 && RImageCacheMaxImage < image->width * image->height)) {
+		UNLOCK_CACHE();
+		return;
+	}
+
+	oldest = time(NULL);
+	if (stat(file, &st) != 0) {
+		/* If we can't get the info, at least use a valid time to reduce risk of problems */
+		st.st_mtime = oldest;
+	}
+
+	for (i = 0; i < RImageCacheSize; i++) {
+		if (!RImageCache[i].file) {
+			RImageCache[i].file = malloc(strlen(file) + 1);
+			strcpy(RImageCache[i].file, file);
+			RImageCache[i].image = RCloneImage(image);
+			RImageCache[i].last_modif = st.st_mtime;
+			RImageCache[i].last_use = time(NULL);
+			done = 1;
+			break;
+		} else {
+			if (oldest > RImageCache[i].last_use) {
+				oldest = RImageCache[i].last_use;
+				oldest_idx = i;
+			}
+		}
+	}
+
+	/* if no slot available, dump least recently used one */
+	if (!done) {
+		free(RImageCache[oldest_idx].file);
+		RReleaseImage(RImageCache[oldest_idx].image);
+		RImageCache[oldest_idx].file = malloc(strlen(file) + 1);
+		strcpy(RImageCache[oldest_idx].file, file);
+		RImageCache[oldest_idx].image = RCloneImage(image);
+		RImageCache[oldest_idx].last_modif = st.st_mtime;
+		RImageCache[oldest_idx].last_use = time(NULL);
+	}
+	UNLOCK_CACHE();
+}
+
+/*
+ * Decode the file with the loader for its format.
+ * The max_width/max_height are only a hint for the loaders that can reduce
+ * the image while decoding, the image returned may still be bigger.
+ */
+static RImage *load_image_file(RContext *context, const char *file, int index,
+                               unsigned max_width, unsigned max_height)
+{
+	RImage *image = NULL;
+
+	/* just to suppress the compilation warning as index is only used with TIFF and GIF */
+#if !defined(USE_TIFF) && !defined(USE_GIF)
+	(void)index;
+#endif
+#if !defined(USE_PNG) && !defined(USE_JPEG) && !defined(USE_WEBP)
+	(void)max_width;
+	(void)max_height;
+#endif
 
 	switch (identFile(file)) {
 	case IM_ERROR:
@@ -217,13 +309,13 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 
 #ifdef USE_PNG
 	case IM_PNG:
-		image = RLoadPNG(context, file);
+		image = RLoadPNG(context, file, max_width, max_height);
 		break;
 #endif				/* USE_PNG */
 
 #ifdef USE_JPEG
 	case IM_JPEG:
-		image = RLoadJPEG(file);
+		image = RLoadJPEG(file, max_width, max_height);
 		break;
 #endif				/* USE_JPEG */
 
@@ -241,7 +333,7 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 
 #ifdef USE_WEBP
 	case IM_WEBP:
-		image = RLoadWEBP(file);
+		image = RLoadWEBP(file, max_width, max_height);
 		break;
 #endif				/* USE_WEBP */
 
@@ -254,47 +346,63 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 		return NULL;
 	}
 
-	/* store image in cache */
-	if (RImageCacheSize > 0 && image &&
-	    (RImageCacheMaxImage == 0 || RImageCacheMaxImage >= image->width * image->height)) {
-		time_t oldest = time(NULL);
-		int oldest_idx = 0;
-		int done = 0;
+	return image;
+}
 
-		if (stat(file, &st) != 0) {
-			/* If we can't get the info, at least use a valid time to reduce risk of problems */
-			st.st_mtime = oldest;
-		}
+RImage *RLoadImageScaled(RContext *context, const char *file, int index,
+                         unsigned max_width, unsigned max_height)
+{
+	RImage *image, *scaled;
+	unsigned width, height;
 
-		for (i = 0; i < RImageCacheSize; i++) {
-			if (!RImageCache[i].file) {
-				RImageCache[i].file = malloc(strlen(file) + 1);
-				strcpy(RImageCache[i].file, file);
-				RImageCache[i].image = RCloneImage(image);
-				RImageCache[i].last_modif = st.st_mtime;
-				RImageCache[i].last_use = time(NULL);
-				done = 1;
-				break;
-			} else {
-				if (oldest > RImageCache[i].last_use) {
-					oldest = RImageCache[i].last_use;
-					oldest_idx = i;
-				}
-			}
-		}
+	assert(file != NULL);
 
-		/* if no slot available, dump least recently used one */
-		if (!done) {
-			free(RImageCache[oldest_idx].file);
-			RReleaseImage(RImageCache[oldest_idx].image);
-			RImageCache[oldest_idx].file = malloc(strlen(file) + 1);
-			strcpy(RImageCache[oldest_idx].file, file);
-			RImageCache[oldest_idx].image = RCloneImage(image);
-			RImageCache[oldest_idx].last_modif = st.st_mtime;
-			RImageCache[oldest_idx].last_use = time(NULL);
-		}
+	if (max_width == 0 && max_height == 0)
+		return RLoadImage(context, file, index);
+
+	image = get_cached_image(file);
+	if (!image) {
+		image = load_image_file(context, file, index, max_width, max_height);
+		if (!image)
+			return NULL;
+
+		/*
+		 * The loaders only reduce the images that do not fit, and then
+		 * never below the limit, so an image smaller than the limit is
+		 * the one RLoadImage would return and can be cached
+		 */
+		if ((max_width == 0 || image->width < max_width) &&
+		    (max_height == 0 || image->height < max_height))
+			put_cached_image(file, image);
 	}
 
+	RFitImageDimensions(image->width, image->height, max_width, max_height,
+			    False, &width, &height);
+	if (width == image->width && height == image->height)
+		return image;
+
+	scaled = RSmoothScaleImage(image, width, height);
+	RReleaseImage(image);
+
+	return scaled;
+}
+
+RImage *RLoadImage(RContext *context, const char *file, int index)
+{
+	RImage *image = NULL;
+
+	assert(file != NULL);
+
+	image = get_cached_image(file);
+	if (image)
+		return image;
+
+	image = load_image_file(context, file, index, 0, 0);
+	if (!image)
+		return NULL;
+
+	put_cached_image(file, image);
+
 	return image;
 }
 
@@ -95,7 +95,37 @@ static noreturn void my_error_exit(j_common_ptr cinfo)
 	longjmp(myerr->setjmp_buffer, 1);
 }
 
-static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const char *file_name)
+/*
+ * Find the biggest reduction the decoder can do (it can scale by 1/2, 1/4 and
+ * 1/8 while doing the IDCT, which is much faster than decoding the full image)
+ * while keeping the image at least as big as what the caller asked for
+ */
+static void set_decode_scale(struct jpeg_decompress_struct *cinfo,
+                             unsigned max_width, unsigned max_height)
+{
+	unsigned target_width, target_height;
+	unsigned denom;
+
+	cinfo->scale_num = 1;
+	cinfo->scale_denom = 1;
+
+	if (max_width == 0 && max_height == 0)
+		return;
+
+	RFitImageDimensions(cinfo->image_width, cinfo->image_height, max_width, max_height,
+			    False, &target_width, &target_height);
+
+	for (denom = 8; denom > 1; denom /= 2) {
+		if ((cinfo->image_width + denom - 1) / denom >= target_width &&
+		    (cinfo->image_height + denom - 1) / denom >= target_height) {
+			cinfo->scale_denom = denom;
+			break;
+		}
+	}
+}
+
+static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const char *file_name,
+                                 unsigned max_width, unsigned max_height)
 {
 	RImage *image = NULL;
 	int i;
@@ -119,12 +149,6 @@ static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const cha
 		goto abort_and_release_resources;
 	}
 
-	buffer[0] = (JSAMPROW) malloc(cinfo->image_width * cinfo->num_components);
-	if (!buffer[0]) {
-		RErrorCode = RERR_NOMEMORY;
-		goto abort_and_release_resources;
-	}
-
 	if (cinfo->jpeg_color_space == JCS_GRAYSCALE)
 		cinfo->out_color_space = JCS_GRAYSCALE;
 	else
@@ -133,8 +157,16 @@ static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const cha
 	cinfo->quantize_colors = FALSE;
 	cinfo->do_fancy_upsampling = FALSE;
 	cinfo->do_block_smoothing = FALSE;
+	set_decode_scale(cinfo, max_width, max_height);
 	jpeg_calc_output_dimensions(cinfo);
-	image = RCreateImage(cinfo->image_width, cinfo->image_height, False);
+
+	buffer[0] = (JSAMPROW) malloc(cinfo->output_width * cinfo->output_components);
+	if (!buffer[0]) {
+		RErrorCode = RERR_NOMEMORY;
+		goto abort_and_release_resources;
+	}
+
+	image = RCreateImage(cinfo->output_width, cinfo->output_height, False);
 	if (!image) {
 		RErrorCode = RERR_NOMEMORY;
 		goto abort_and_release_resources;
@@ -146,14 +178,14 @@ static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const cha
 		while (cinfo->output_scanline < cinfo->output_height) {
 			jpeg_read_scanlines(cinfo, buffer, (JDIMENSION) 1);
 			bptr = buffer[0];
-			memcpy(ptr, bptr, cinfo->image_width * 3);
-			ptr += cinfo->image_width * 3;
+			memcpy(ptr, bptr, cinfo->output_width * 3);
+			ptr += cinfo->output_width * 3;
 		}
 	} else {
 		while (cinfo->output_scanline < cinfo->output_height) {
 			jpeg_read_scanlines(cinfo, buffer, (JDIMENSION) 1);
 			bptr = buffer[0];
-			for (i = 0; i < cinfo->image_width; i++) {
+			for (i = 0; i < cinfo->output_width; i++) {
 				*ptr++ = *bptr;
 				*ptr++ = *bptr;
 				*ptr++ = *bptr++;
@@ -172,7 +204,7 @@ static RImage *do_read_jpeg_file(struct jpeg_decompress_struct *cinfo, const cha
 	return image;
 }
 
-RImage *RLoadJPEG(const char *file_name)
+RImage *RLoadJPEG(const char *file_name, unsigned max_width, unsigned max_height)
 {
 	struct jpeg_decompress_struct cinfo;
 	/* We use our private extension JPEG error handler.
@@ -192,5 +224,5 @@ RImage *RLoadJPEG(const char *file_name)
 		jpeg_destroy_decompress(&cinfo);
 		return NULL;
 	}
-	return do_read_jpeg_file(&cinfo, file_name);
+	return do_read_jpeg_file(&cinfo, file_name, max_width, max_height);
 }
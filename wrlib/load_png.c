@@ -33,7 +33,84 @@
 #include "wr_i18n.h"
 
 
-RImage *RLoadPNG(RContext *context, const char *file)
+/*
+ * Find by how much the image can be reduced while it is being read, using a
+ * simple box filter, keeping it at least as big as what the caller asked for
+ */
+static unsigned get_reduce_factor(png_uint_32 width, png_uint_32 height,
+                                  unsigned max_width, unsigned max_height)
+{
+	unsigned target_width, target_height;
+	unsigned factor_x, factor_y;
+
+	if (max_width == 0 && max_height == 0)
+		return 1;
+
+	RFitImageDimensions(width, height, max_width, max_height, False,
+			    &target_width, &target_height);
+
+	factor_x = width / target_width;
+	factor_y = height / target_height;
+
+	return (factor_x < factor_y) ? factor_x : factor_y;
+}
+
+/*
+ * Read the image row by row, averaging each 'factor' x 'factor' block of
+ * source pixels into one pixel of the image. Only the accumulator for one
+ * line of the result is kept, so we never need the memory for the full
+ * size image.
+ * The blocks on the right and bottom edges may be incomplete, they are
+ * averaged on the pixels they actually contain.
+ */
+static void read_reduced_rows(png_structp png, RImage *image,
+                              png_uint_32 width, png_uint_32 height, unsigned factor,
+                              png_bytep row, unsigned *acc)
+{
+	const int channels = (image->format == RRGBAFormat) ? 4 : 3;
+	unsigned char *ptr;
+	png_uint_32 y, x;
+	unsigned rows_in_box, cols_in_box;
+	int c, ox;
+
+	ptr = image->data;
+	rows_in_box = 0;
+	memset(acc, 0, image->width * channels * sizeof(acc[0]));
+
+	for (y = 0; y < height; y++) {
+		png_read_row(png, row, NULL);
+
+		for (x = 0; x < width; x++) {
+			unsigned *a = acc + (x / factor) * channels;
+			png_bytep p = row + x * channels;
+
+			for (c = 0; c < channels; c++)
+				a[c] += p[c];
+		}
+		rows_in_box++;
+
+		if (rows_in_box < factor && y + 1 < height)
+			continue;
+
+		for (ox = 0; ox < image->width; ox++) {
+			unsigned *a = acc + ox * channels;
+			unsigned count;
+
+			cols_in_box = width - ox * factor;
+			if (cols_in_box > factor)
+				cols_in_box = factor;
+			count = cols_in_box * rows_in_box;
+
+			for (c = 0; c < channels; c++)
+				*ptr++ = (a[c] + count / 2) / count;
+		}
+
+		rows_in_box = 0;
+		memset(acc, 0, image->width * channels * sizeof(acc[0]));
+	}
+}
+
+RImage *RLoadPNG(RContext *context, const char *file, unsigned max_width, unsigned max_height)
 {
 	char *tmp;
 	RImage *image = NULL;
@@ -46,7 +123,11 @@ RImage *RLoadPNG(RContext *context, const char *file)
 	double gamma, sgamma;
 	png_uint_32 width, height;
 	int depth, junk, color_type;
+	int interlace;
+	unsigned factor;
 	png_bytep *png_rows;
+	png_bytep volatile row_buf = NULL;
+	unsigned *volatile acc = NULL;
 	unsigned char *ptr;
 
 	f = fopen(file, "rb");
@@ -87,6 +168,10 @@ RImage *RLoadPNG(RContext *context, const char *file)
 		png_destroy_read_struct(&png, &pinfo, &einfo);
 		if (image)
 			RReleaseImage(image);
+		if (row_buf)
+			free(row_buf);
+		if (acc)
+			free(acc);
 		return NULL;
 	}
 
@@ -94,7 +179,7 @@ RImage *RLoadPNG(RContext *context, const char *file)
 
 	png_read_info(png, pinfo);
 
-	png_get_IHDR(png, pinfo, &width, &height, &depth, &color_type, &junk, &junk, &junk);
+	png_get_IHDR(png, pinfo, &width, &height, &depth, &color_type, &interlace, &junk, &junk);
 
 	/* sanity check */
 	if (width < 1 || height < 1) {
@@ -110,8 +195,20 @@ RImage *RLoadPNG(RContext *context, const char *file)
 	else
 		alpha = (color_type & PNG_COLOR_MASK_ALPHA);
 
+	/*
+	 * Interlaced images cannot be read progressively, they will be
+	 * reduced by the caller after being loaded
+	 */
+	if (interlace == PNG_INTERLACE_NONE)
+		factor = get_reduce_factor(width, height, max_width, max_height);
+	else
+		factor = 1;
+
 	/* allocate RImage */
-	image = RCreateImage(width, height, alpha);
+	if (factor > 1)
+		image = RCreateImage((width + factor - 1) / factor, (height + factor - 1) / factor, alpha);
+	else
+		image = RCreateImage(width, height, alpha);
 	if (!image) {
 		fclose(f);
 		png_destroy_read_struct(&png, &pinfo, &einfo);
@@ -165,6 +262,31 @@ RImage *RLoadPNG(RContext *context, const char *file)
 		image->background.blue = bkcolor->blue >> 8;
 	}
 
+	if (factor > 1) {
+		row_buf = malloc(png_get_rowbytes(png, pinfo));
+		acc = malloc(image->width * (alpha ? 4 : 3) * sizeof(acc[0]));
+		if (!row_buf || !acc) {
+			RErrorCode = RERR_NOMEMORY;
+			fclose(f);
+			RReleaseImage(image);
+			png_destroy_read_struct(&png, &pinfo, &einfo);
+			if (row_buf)
+				free(row_buf);
+			if (acc)
+				free(acc);
+			return NULL;
+		}
+
+		read_reduced_rows(png, image, width, height, factor, row_buf, acc);
+
+		png_read_end(png, einfo);
+		png_destroy_read_struct(&png, &pinfo, &einfo);
+		fclose(f);
+		free(row_buf);
+		free(acc);
+		return image;
+	}
+
 	png_rows = calloc(height, sizeof(png_bytep));
 	if (!png_rows) {
 		RErrorCode = RERR_NOMEMORY;
@@ -62,7 +62,37 @@ static const char *webp_message_from_status(VP8StatusCode status)
 	return custom_message;
 }
 
-RImage *RLoadWEBP(const char *file_name)
+/*
+ * Decode the image directly at the requested size, the decoder does the
+ * resampling while converting the rows to RGB so we never need the memory
+ * for the full size image
+ */
+static uint8_t *decode_scaled(const uint8_t *raw_data, size_t raw_data_size, RImage *image)
+{
+	WebPDecoderConfig config;
+	int channels;
+
+	if (!WebPInitDecoderConfig(&config))
+		return NULL;
+
+	channels = (image->format == RRGBAFormat) ? 4 : 3;
+
+	config.options.use_scaling = 1;
+	config.options.scaled_width = image->width;
+	config.options.scaled_height = image->height;
+	config.output.colorspace = (channels == 4) ? MODE_RGBA : MODE_RGB;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = image->data;
+	config.output.u.RGBA.stride = image->width * channels;
+	config.output.u.RGBA.size = image->width * image->height * channels;
+
+	if (WebPDecode(raw_data, raw_data_size, &config) != VP8_STATUS_OK)
+		return NULL;
+
+	return image->data;
+}
+
+RImage *RLoadWEBP(const char *file_name, unsigned max_width, unsigned max_height)
 {
 	FILE *file;
 	RImage *image = NULL;
@@ -72,6 +102,7 @@ RImage *RLoadWEBP(const char *file_name)
 	uint8_t *raw_data;
 	VP8StatusCode status;
 	WebPBitstreamFeatures features;
+	unsigned width, height;
 	uint8_t *ret = NULL;
 
 	file = fopen(file_name, "rb");
@@ -137,7 +168,18 @@ RImage *RLoadWEBP(const char *file_name)
 		return NULL;
 	}
 
-	if (features.has_alpha) {
+	RFitImageDimensions(features.width, features.height, max_width, max_height,
+			    False, &width, &height);
+
+	if (width != features.width || height != features.height) {
+		image = RCreateImage(width, height, features.has_alpha);
+		if (!image) {
+			RErrorCode = RERR_NOMEMORY;
+			free(raw_data);
+			return NULL;
+		}
+		ret = decode_scaled(raw_data, raw_data_size, image);
+	} else if (features.has_alpha) {
 		image = RCreateImage(features.width, features.height, True);
 		if (!image) {
 			RErrorCode = RERR_NOMEMORY;
@@ -40,6 +40,9 @@ void RBevelImage(RImage * image, int bevel_type)
 	if (image->width < 3 || image->height < 3)
 		return;
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	w = image->width;
 	h = image->height;
 	if (bevel_type > 0) {	/* raised */
@@ -86,10 +89,14 @@ void RBevelImage(RImage * image, int bevel_type)
 
 void RFillImage(RImage * image, const RColor * color)
 {
-	unsigned char *d = image->data;
+	unsigned char *d;
 	unsigned lineSize;
 	int i;
 
+	if (!RMakeImageWritable(image))
+		return;
+	d = image->data;
+
 	if (image->format == RRGBAFormat) {
 		for (i = 0; i < image->width; i++) {
 			*d++ = color->red;
@@ -116,10 +123,14 @@ void RFillImage(RImage * image, const RColor * color)
 
 void RClearImage(RImage * image, const RColor * color)
 {
-	unsigned char *d = image->data;
+	unsigned char *d;
 	unsigned lineSize;
 	int i;
 
+	if (!RMakeImageWritable(image))
+		return;
+	d = image->data;
+
 	if (color->alpha == 255) {
 		if (image->format == RRGBAFormat) {
 			for (i = 0; i < image->width; i++) {
@@ -172,10 +183,14 @@ static inline unsigned char clip(int c)
 
 void RLightImage(RImage *image, const RColor *color)
 {
-	unsigned char *d = image->data;
+	unsigned char *d;
 	unsigned char *dd;
 	int alpha, r, g, b, s;
 
+	if (!RMakeImageWritable(image))
+		return;
+	d = image->data;
+
 	s = (image->format == RRGBAFormat) ? 4 : 3;
 	dd = d + s*image->width*image->height;
 
@@ -0,0 +1,162 @@
+/* parallel.c - split image processing across threads
+ *
+ * Raster graphics library
+ *
+ * Copyright (c) 2026 Window Maker Team
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <X11/Xlib.h>
+
+#include "wraster.h"
+#include "parallel.h"
+
+
+/*
+ * Below this amount of work per thread, the cost of creating the thread
+ * is higher than what we would gain, so we do not bother
+ */
+#define MIN_COST_PER_THREAD	(128UL * 1024UL)
+
+/* Upper limit, there is no point in having more threads than memory channels */
+#define MAX_THREADS	16
+
+
+#ifdef HAVE_PTHREAD
+
+typedef struct {
+	wraster_parallel_func *func;
+	void *data;
+	int start;
+	int end;
+} parallel_slice;
+
+static int max_threads = 0;
+static pthread_once_t max_threads_once = PTHREAD_ONCE_INIT;
+
+static void init_max_threads(void)
+{
+	const char *env;
+	long n;
+
+	env = getenv("WRASTER_THREADS");
+	if (env != NULL) {
+		n = strtol(env, NULL, 10);
+	} else {
+#ifdef _SC_NPROCESSORS_ONLN
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+		n = 1;
+#endif
+	}
+
+	if (n < 1)
+		n = 1;
+	else if (n > MAX_THREADS)
+		n = MAX_THREADS;
+
+	max_threads = n;
+}
+
+int wraster_parallel_threads(void)
+{
+	pthread_once(&max_threads_once, init_max_threads);
+
+	return max_threads;
+}
+
+static void *run_slice(void *arg)
+{
+	parallel_slice *slice = arg;
+
+	slice->func(slice->data, slice->start, slice->end);
+
+	return NULL;
+}
+
+void wraster_parallel_run(int count, unsigned long cost,
+                          wraster_parallel_func *func, void *data)
+{
+	parallel_slice slices[MAX_THREADS];
+	pthread_t tid[MAX_THREADS];
+	int started[MAX_THREADS];
+	int nthreads, i, start;
+
+	if (count <= 0)
+		return;
+
+	nthreads = wraster_parallel_threads();
+	if ((unsigned long) nthreads > cost / MIN_COST_PER_THREAD)
+		nthreads = cost / MIN_COST_PER_THREAD;
+	if (nthreads > count)
+		nthreads = count;
+
+	if (nthreads <= 1) {
+		func(data, 0, count);
+		return;
+	}
+
+	start = 0;
+	for (i = 0; i < nthreads; i++) {
+		slices[i].func = func;
+		slices[i].data = data;
+		slices[i].start = start;
+		slices[i].end = start + (count - start) / (nthreads - i);
+		start = slices[i].end;
+	}
+
+	/* The calling thread takes the first slice, others are run in parallel */
+	for (i = 1; i < nthreads; i++)
+		started[i] = (pthread_create(&tid[i], NULL, run_slice, &slices[i]) == 0);
+
+	run_slice(&slices[0]);
+
+	for (i = 1; i < nthreads; i++) {
+		if (started[i])
+			pthread_join(tid[i], NULL);
+		else
+			/* Could not create the thread, so do the work ourself */
+			run_slice(&slices[i]);
+	}
+}
+
+#else /* HAVE_PTHREAD */
+
+int wraster_parallel_threads(void)
+{
+	return 1;
+}
+
+void wraster_parallel_run(int count, unsigned long cost,
+                          wraster_parallel_func *func, void *data)
+{
+	(void) cost;
+
+	if (count > 0)
+		func(data, 0, count);
+}
+
+#endif /* HAVE_PTHREAD */
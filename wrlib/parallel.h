@@ -0,0 +1,46 @@
+/*
+ * Raster graphics library
+ *
+ * Copyright (c) 2026 Window Maker Team
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library.
+ */
+
+#ifndef WRASTER_PARALLEL_H
+#define WRASTER_PARALLEL_H
+
+
+/*
+ * Callback for wraster_parallel_run: process the items in [start, end)
+ */
+typedef void wraster_parallel_func(void *data, int start, int end);
+
+/*
+ * Split 'count' items into contiguous ranges and call 'func' on each of them,
+ * using several threads when the amount of work (estimated by 'cost', which
+ * is usually the number of pixels touched) makes it worth it.
+ *
+ * The function returns only when all the ranges have been processed.
+ * When threads are not available, everything is done in the calling thread.
+ */
+void wraster_parallel_run(int count, unsigned long cost,
+                          wraster_parallel_func *func, void *data);
+
+/*
+ * Returns the maximum number of threads wraster_parallel_run may use
+ */
+int wraster_parallel_threads(void);
+
+
+#endif
@@ -27,6 +27,10 @@
 #include <string.h>
 #include <X11/Xlib.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "wraster.h"
 #include "wr_i18n.h"
 
@@ -42,6 +46,46 @@ int RErrorCode = RERR_NONE;
 #define MAX_HEIGHT 20000
 /* 20000^2*4 < 2G */
 
+/*
+ * Pixels shared between clones; the images keep their own 'data' pointer,
+ * this only counts how many of them use it
+ */
+struct RImageBuffer {
+	int refCount;
+};
+
+static RImageStats image_stats;
+
+/*
+ * Images can be created and released from several threads (the loaders are
+ * thread safe), so the counters and the shared buffers are protected
+ */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t image_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_IMAGES()	pthread_mutex_lock(&image_lock)
+#define UNLOCK_IMAGES()	pthread_mutex_unlock(&image_lock)
+#else
+#define LOCK_IMAGES()
+#define UNLOCK_IMAGES()
+#endif
+
+static unsigned long image_data_size(RImage *image)
+{
+	/* the +4 is to give extra bytes at the end of the buffer,
+	 * so that we can optimize image conversion for MMX(tm).. see convert.c
+	 */
+	return (unsigned long) image->width * image->height * (HAS_ALPHA(image) ? 4 : 3) + 4;
+}
+
+/* Must be called with the lock held */
+static void count_new_buffer(unsigned long size)
+{
+	image_stats.buffers++;
+	image_stats.buffer_bytes += size;
+	if (image_stats.buffer_bytes > image_stats.peak_buffer_bytes)
+		image_stats.peak_buffer_bytes = image_stats.buffer_bytes;
+}
+
 RImage *RCreateImage(unsigned width, unsigned height, int alpha)
 {
 	RImage *image = NULL;
@@ -65,16 +109,18 @@ RImage *RCreateImage(unsigned width, unsigned height, int alpha)
 	image->format = alpha ? RRGBAFormat : RRGBFormat;
 	image->refCount = 1;
 
-	/* the +4 is to give extra bytes at the end of the buffer,
-	 * so that we can optimize image conversion for MMX(tm).. see convert.c
-	 */
-	image->data = malloc(width * height * (alpha ? 4 : 3) + 4);
+	image->data = malloc(image_data_size(image));
 	if (!image->data) {
 		RErrorCode = RERR_NOMEMORY;
 		free(image);
-		image = NULL;
+		return NULL;
 	}
 
+	LOCK_IMAGES();
+	image_stats.images++;
+	count_new_buffer(image_data_size(image));
+	UNLOCK_IMAGES();
+
 	return image;
 
 }
@@ -89,28 +135,129 @@ RImage *RRetainImage(RImage * image)
 
 void RReleaseImage(RImage * image)
 {
+	Bool free_data;
+
 	assert(image != NULL);
 
 	image->refCount--;
 
 	if (image->refCount < 1) {
-		free(image->data);
+		LOCK_IMAGES();
+		free_data = True;
+		if (image->buffer) {
+			if (--image->buffer->refCount > 0)
+				free_data = False;
+			else
+				free(image->buffer);
+		}
+		if (free_data) {
+			image_stats.buffers--;
+			image_stats.buffer_bytes -= image_data_size(image);
+		}
+		image_stats.images--;
+		UNLOCK_IMAGES();
+
+		if (free_data)
+			free(image->data);
 		free(image);
 	}
 }
 
+Bool RMakeImageWritable(RImage *image)
+{
+	unsigned long size;
+	unsigned char *data;
+
+	assert(image != NULL);
+
+	/* The usual case, checked without the lock: no other image can start
+	 * sharing our pixels while we are the one using the image */
+	if (!image->buffer)
+		return True;
+
+	size = image_data_size(image);
+
+	LOCK_IMAGES();
+	if (image->buffer->refCount == 1) {
+		/* The others are gone, what is left is ours */
+		free(image->buffer);
+		image->buffer = NULL;
+		UNLOCK_IMAGES();
+		return True;
+	}
+	UNLOCK_IMAGES();
+
+	data = malloc(size);
+	if (!data) {
+		RErrorCode = RERR_NOMEMORY;
+		return False;
+	}
+	memcpy(data, image->data, size);
+
+	LOCK_IMAGES();
+	if (--image->buffer->refCount == 0) {
+		/* The other users went away meanwhile, so the copy was not needed */
+		free(image->buffer);
+		image->buffer = NULL;
+		UNLOCK_IMAGES();
+		free(data);
+		return True;
+	}
+	image->buffer = NULL;
+	image->data = data;
+	count_new_buffer(size);
+	image_stats.copies_on_write++;
+	image_stats.copied_bytes += size;
+	UNLOCK_IMAGES();
+
+	return True;
+}
+
+void RGetImageStats(RImageStats *stats)
+{
+	LOCK_IMAGES();
+	*stats = image_stats;
+	UNLOCK_IMAGES();
+}
+
 RImage *RCloneImage(RImage * image)
 {
 	RImage *new_image;
+	struct RImageBuffer *buffer;
 
 	assert(image != NULL);
 
-	new_image = RCreateImage(image->width, image->height, HAS_ALPHA(image));
-	if (!new_image)
+	new_image = malloc(sizeof(RImage));
+	if (!new_image) {
+		RErrorCode = RERR_NOMEMORY;
 		return NULL;
+	}
 
-	new_image->background = image->background;
-	memcpy(new_image->data, image->data, image->width * image->height * (HAS_ALPHA(image) ? 4 : 3));
+	*new_image = *image;
+	new_image->refCount = 1;
+
+	/*
+	 * The buffer is checked and created with the lock held, so two threads
+	 * cloning the same image for the first time do not both create one
+	 */
+	LOCK_IMAGES();
+	if (!image->buffer) {
+		buffer = malloc(sizeof(struct RImageBuffer));
+		if (!buffer) {
+			UNLOCK_IMAGES();
+			RErrorCode = RERR_NOMEMORY;
+			free(new_image);
+			return NULL;
+		}
+		buffer->refCount = 1;
+		image->buffer = buffer;
+	}
+	image->buffer->refCount++;
+	new_image->buffer = image->buffer;
+	image_stats.images++;
+	image_stats.shared_clones++;
+	image_stats.shared_bytes += image_data_size(image);
+	UNLOCK_IMAGES();
 
 	return new_image;
 }
@@ -131,6 +278,10 @@ RImage *RGetSubImage(RImage * image, int x, int y, unsigned width, unsigned heig
 	if (y + height > image->height)
 		height = image->height - y;
 
+	/* The whole image, no need to copy anything */
+	if (width == image->width && height == image->height)
+		return RCloneImage(image);
+
 	new_image = RCreateImage(width, height, HAS_ALPHA(image));
 
 	if (!new_image)
@@ -160,6 +311,9 @@ void RCombineImages(RImage * image, RImage * src)
 	assert(image->width == src->width);
 	assert(image->height == src->height);
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	if (!HAS_ALPHA(src)) {
 		if (!HAS_ALPHA(image)) {
 			memcpy(image->data, src->data, image->height * image->width * 3);
@@ -218,6 +372,9 @@ void RCombineImagesWithOpaqueness(RImage * image, RImage * src, int opaqueness)
 	assert(image->width == src->width);
 	assert(image->height == src->height);
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	d = image->data;
 	s = src->data;
 
@@ -311,6 +468,9 @@ void RCombineArea(RImage * image, RImage * src, int sx, int sy, unsigned width,
 	if (!calculateCombineArea(image, &sx, &sy, &width, &height, &dx, &dy))
 		return;
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	if (!HAS_ALPHA(src)) {
 		if (!HAS_ALPHA(image)) {
 			swi = src->width * 3;
@@ -389,6 +549,9 @@ void RCopyArea(RImage * image, RImage * src, int sx, int sy, unsigned width, uns
 	if (!calculateCombineArea(image, &sx, &sy, &width, &height, &dx, &dy))
 		return;
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	if (!HAS_ALPHA(src)) {
 		if (!HAS_ALPHA(image)) {
 			swi = src->width * 3;
@@ -467,6 +630,9 @@ RCombineAreaWithOpaqueness(RImage * image, RImage * src, int sx, int sy,
 	if (!calculateCombineArea(image, &sx, &sy, &width, &height, &dx, &dy))
 		return;
 
+	if (!RMakeImageWritable(image))
+		return;
+
 	d = image->data + (dy * image->width + dx) * dch;
 	dwi = (image->width - width) * dch;
 
@@ -537,13 +703,16 @@ void RCombineImageWithColor(RImage * image, const RColor * color)
 	unsigned char *d;
 	int alpha, nalpha, r, g, b;
 
-	d = image->data;
-
 	if (!HAS_ALPHA(image)) {
 		/* Image has no alpha channel, so we consider it to be all 255.
 		 * Thus there are no transparent parts to be filled. */
 		return;
 	}
+
+	if (!RMakeImageWritable(image))
+		return;
+
+	d = image->data;
 	r = color->red;
 	g = color->green;
 	b = color->blue;
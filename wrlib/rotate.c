@@ -25,11 +25,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <X11/Xlib.h>
 
 #include "wraster.h"
 #include "rotate.h"
+#include "parallel.h"
 #include "wr_i18n.h"
 
 #include <math.h>
@@ -76,54 +78,169 @@ RImage *RRotateImage(RImage *image, float angle)
 	}
 }
 
-static RImage *rotate_image_90(RImage *source)
-{
+/*
+ * Rotation by 90 and 270 degrees
+ *
+ * A naive transposition reads the source linearly but writes every pixel in
+ * a different line of the target, so each pixel costs a cache miss on big
+ * images. Instead the source is cut into square tiles that fit in the L1
+ * cache, each tile is transposed in full and the tile rows are shared among
+ * threads (they write to separate columns of the target).
+ *
+ * Inside a tile, RGBA images are processed by blocks of 4x4 pixels handled as
+ * 32 bits words, which the compiler can turn into vector shuffles.
+ */
+
+/* Size of the tiles, in pixels: 64x64x4 bytes = 16kB */
+#define ROTATE_TILE_SIZE	64
+
+typedef struct {
+	const RImage *source;
 	RImage *target;
-	int nwidth, nheight;
-	int x, y;
+	Bool clockwise;		/* True for 90 degrees, False for 270 */
+} rotate_right_angle_job;
 
-	nwidth = source->height;
-	nheight = source->width;
+static inline uint32_t load_pixel32(const unsigned char *p)
+{
+	uint32_t value;
 
-	target = RCreateImage(nwidth, nheight, (source->format != RRGBFormat));
-	if (!target)
-		return NULL;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
 
-	if (source->format == RRGBFormat) {
-		unsigned char *optr, *nptr;
+static inline void store_pixel32(unsigned char *p, uint32_t value)
+{
+	memcpy(p, &value, sizeof(value));
+}
 
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 3 * (x - 1);
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-
-				nptr += 3 * nwidth;
+/* Offset of the pixel in the target for the source pixel (sx, sy) */
+static inline long rotated_offset(const rotate_right_angle_job *job, int sx, int sy)
+{
+	if (job->clockwise)
+		return (long) sx * job->target->width + (job->target->width - 1 - sy);
+	else
+		return (long) (job->target->height - 1 - sx) * job->target->width + sy;
+}
+
+static void rotate_block_4x4(const rotate_right_angle_job *job, int sx, int sy)
+{
+	const unsigned char *src = job->source->data + ((long) sy * job->source->width + sx) * 4;
+	long sstride = job->source->width * 4;
+	long tstride = job->target->width * 4;
+	uint32_t p[4][4];
+	unsigned char *dst;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		p[i][0] = load_pixel32(src + i * sstride);
+		p[i][1] = load_pixel32(src + i * sstride + 4);
+		p[i][2] = load_pixel32(src + i * sstride + 8);
+		p[i][3] = load_pixel32(src + i * sstride + 12);
+	}
+
+	if (job->clockwise) {
+		/* source column sx + i becomes target line sx + i, read bottom-up */
+		dst = job->target->data + rotated_offset(job, sx, sy + 3) * 4;
+		for (i = 0; i < 4; i++) {
+			store_pixel32(dst,      p[3][i]);
+			store_pixel32(dst + 4,  p[2][i]);
+			store_pixel32(dst + 8,  p[1][i]);
+			store_pixel32(dst + 12, p[0][i]);
+			dst += tstride;
+		}
+	} else {
+		/* source column sx + i becomes target line (height - 1 - sx - i) */
+		dst = job->target->data + rotated_offset(job, sx, sy) * 4;
+		for (i = 0; i < 4; i++) {
+			store_pixel32(dst,      p[0][i]);
+			store_pixel32(dst + 4,  p[1][i]);
+			store_pixel32(dst + 8,  p[2][i]);
+			store_pixel32(dst + 12, p[3][i]);
+			dst -= tstride;
+		}
+	}
+}
+
+static void rotate_tile(const rotate_right_angle_job *job, int x0, int y0, int x1, int y1)
+{
+	const unsigned char *src;
+	unsigned char *dst;
+	int x, y;
+
+	if (job->source->format == RRGBAFormat) {
+		int bx1 = x0 + ((x1 - x0) & ~3);
+		int by1 = y0 + ((y1 - y0) & ~3);
+
+		for (y = y0; y < by1; y += 4)
+			for (x = x0; x < bx1; x += 4)
+				rotate_block_4x4(job, x, y);
+
+		/* what remains on the right and at the bottom of the tile */
+		for (y = y0; y < y1; y++) {
+			for (x = (y < by1) ? bx1 : x0; x < x1; x++) {
+				src = job->source->data + ((long) y * job->source->width + x) * 4;
+				dst = job->target->data + rotated_offset(job, x, y) * 4;
+				store_pixel32(dst, load_pixel32(src));
 			}
 		}
 
 	} else {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 4 * (x - 1);
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-				nptr[3] = *optr++;
-
-				nptr += 4 * nwidth;
+		for (y = y0; y < y1; y++) {
+			src = job->source->data + ((long) y * job->source->width + x0) * 3;
+			for (x = x0; x < x1; x++) {
+				dst = job->target->data + rotated_offset(job, x, y) * 3;
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				src += 3;
 			}
 		}
 	}
+}
+
+static void rotate_tile_rows(void *data, int start, int end)
+{
+	const rotate_right_angle_job *job = data;
+	int width = job->source->width;
+	int height = job->source->height;
+	int row, x0, y0, x1, y1;
+
+	for (row = start; row < end; row++) {
+		y0 = row * ROTATE_TILE_SIZE;
+		y1 = (y0 + ROTATE_TILE_SIZE < height) ? y0 + ROTATE_TILE_SIZE : height;
+
+		for (x0 = 0; x0 < width; x0 += ROTATE_TILE_SIZE) {
+			x1 = (x0 + ROTATE_TILE_SIZE < width) ? x0 + ROTATE_TILE_SIZE : width;
+			rotate_tile(job, x0, y0, x1, y1);
+		}
+	}
+}
+
+static RImage *rotate_right_angle(RImage *source, Bool clockwise)
+{
+	rotate_right_angle_job job;
+	RImage *target;
+
+	target = RCreateImage(source->height, source->width, (source->format != RRGBFormat));
+	if (!target)
+		return NULL;
+
+	job.source = source;
+	job.target = target;
+	job.clockwise = clockwise;
+
+	wraster_parallel_run((source->height + ROTATE_TILE_SIZE - 1) / ROTATE_TILE_SIZE,
+			     (unsigned long) source->width * source->height,
+			     rotate_tile_rows, &job);
 
 	return target;
 }
 
+static RImage *rotate_image_90(RImage *source)
+{
+	return rotate_right_angle(source, True);
+}
+
 RImage *wraster_rotate_image_180(RImage *source)
 {
 	RImage *target;
@@ -176,259 +293,145 @@ RImage *wraster_rotate_image_180(RImage *source)
 
 static RImage *rotate_image_270(RImage *source)
 {
-	RImage *target;
-	int nwidth, nheight;
-	int x, y;
-
-	nwidth = source->height;
-	nheight = source->width;
-
-	target = RCreateImage(nwidth, nheight, (source->format != RRGBFormat));
-	if (!target)
-		return NULL;
-
-	if (source->format == RRGBFormat) {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 3 * nwidth * nheight - x * 3;
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-
-				nptr -= 3 * nwidth;
-			}
-		}
-
-	} else {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 4 * nwidth * nheight - x * 4;
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-				nptr[3] = *optr++;
-
-				nptr -= 4 * nwidth;
-			}
-		}
-	}
-
-	return target;
+	return rotate_right_angle(source, False);
 }
 
 /*
- * Image rotation through Bresenham's line algorithm:
+ * Rotation by any angle
  *
- * If a square must be rotate by angle a, like in:
- *  _______
- * |    B  |
- * |   /4\ |
- * |  /3 8\|
- * | /2 7 /|
- * |A1 6 / |      A_______B
- * | \5 / a| <--- |1 2 3 4|
- * |__C/_)_|      |5 6 7 8|
- *                C-------
- *
- * for each point P1 in the line from C to A
- *	for each point P2 in the perpendicular line starting at P1
- *		get pixel from the source and plot at P2
- *		increment pixel location from source
+ * Each pixel of the target is mapped back into the source by the inverse
+ * rotation; along a line of the target this is a straight line in the source
+ * so the coordinates are simply incremented (DDA) in 16.16 fixed point,
+ * starting from a position calculated only once per line. The coordinates
+ * are kept in 64 bits, with 32 the integer part would overflow past 32767.
  *
+ * The colour is interpolated bilinearly from the 4 closest source pixels,
+ * pixels outside of the source being fully transparent so the borders of the
+ * rotated image are anti-aliased. The lines of the target are shared among
+ * threads.
  */
 
-#if 0
-static void
-copyLine(int x1, int y1, int x2, int y2, int nwidth, int format, unsigned char *dst, unsigned char **src)
+typedef struct {
+	const RImage *source;
+	RImage *target;
+	double cos_a, sin_a;
+	double src_cx, src_cy;	/* center of the source */
+	double dst_cx, dst_cy;	/* center of the target */
+} rotate_any_job;
+
+static inline void fetch_pixel(const RImage *image, int x, int y, unsigned char *pixel)
 {
-	unsigned char *s = *src;
-	int dx, dy;
-	int xi, yi;
-	int offset;
-	int dpr, dpru, p;
+	const unsigned char *p;
+	int valid = 1;
+
+	if (x < 0) {
+		x = 0;
+		valid = 0;
+	} else if (x >= image->width) {
+		x = image->width - 1;
+		valid = 0;
+	}
+	if (y < 0) {
+		y = 0;
+		valid = 0;
+	} else if (y >= image->height) {
+		y = image->height - 1;
+		valid = 0;
+	}
 
-	dx = abs(x2 - x1);
-	dy = abs(y2 - y1);
+	if (image->format == RRGBAFormat) {
+		p = image->data + ((long) y * image->width + x) * 4;
+		pixel[3] = valid ? p[3] : 0;
+	} else {
+		p = image->data + ((long) y * image->width + x) * 3;
+		pixel[3] = valid ? 255 : 0;
+	}
+	pixel[0] = p[0];
+	pixel[1] = p[1];
+	pixel[2] = p[2];
+}
 
-	if (x1 > x2)
-		xi = -1;
-	else
-		xi = 1;
-	if (y1 > y2)
-		yi = -1;
-	else
-		yi = 1;
-
-	if (dx >= dy) {
-
-		dpr = dy << 1;
-		dpru = dpr - (dx << 1);
-		p = dpr - dx;
-
-		while (dx-- >= 0) {
-			/* fetch and draw the pixel */
-			offset = (x1 + y1 * nwidth) << 2;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			if (format == RRGBAFormat)
-				dst[offset++] = *s++;
-			else
-				dst[offset++] = 255;
-
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
-			} else {
-				x1 += xi;
-				p += dpr;
+static void rotate_any_lines(void *data, int start, int end)
+{
+	const rotate_any_job *job = data;
+	const RImage *src = job->source;
+	int64_t step_x, step_y;
+	int x, y, c;
+
+	step_x = (int64_t) (job->cos_a * 65536.0);
+	step_y = (int64_t) (-job->sin_a * 65536.0);
+
+	for (y = start; y < end; y++) {
+		unsigned char *dst = job->target->data + (long) y * job->target->width * 4;
+		double dx = 0.5 - job->dst_cx;
+		double dy = (y + 0.5) - job->dst_cy;
+		int64_t fx, fy;
+
+		/* Position in the source of the center of the first pixel of the line */
+		fx = (int64_t) ((dx * job->cos_a + dy * job->sin_a + job->src_cx - 0.5) * 65536.0);
+		fy = (int64_t) ((-dx * job->sin_a + dy * job->cos_a + job->src_cy - 0.5) * 65536.0);
+
+		for (x = 0; x < job->target->width; x++, fx += step_x, fy += step_y, dst += 4) {
+			int ix = (int) (fx >> 16);
+			int iy = (int) (fy >> 16);
+			unsigned wx, wy;
+			unsigned char p00[4], p01[4], p10[4], p11[4];
+
+			if (ix < -1 || iy < -1 || ix >= src->width || iy >= src->height) {
+				dst[0] = dst[1] = dst[2] = dst[3] = 0;
+				continue;
 			}
-		}
-	} else {
 
-		dpr = dx << 1;
-		dpru = dpr - (dy << 1);
-		p = dpr - dy;
-
-		while (dy-- >= 0) {
-			/* fetch and draw the pixel */
-			offset = (x1 + y1 * nwidth) << 2;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			if (format == RRGBAFormat)
-				dst[offset++] = *s++;
-			else
-				dst[offset++] = 255;
-
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
-			} else {
-				y1 += yi;
-				p += dpr;
+			wx = (unsigned) ((fx >> 8) & 0xFF);
+			wy = (unsigned) ((fy >> 8) & 0xFF);
+
+			fetch_pixel(src, ix, iy, p00);
+			fetch_pixel(src, ix + 1, iy, p01);
+			fetch_pixel(src, ix, iy + 1, p10);
+			fetch_pixel(src, ix + 1, iy + 1, p11);
+
+			for (c = 0; c < 4; c++) {
+				unsigned top = p00[c] * (256 - wx) + p01[c] * wx;
+				unsigned bottom = p10[c] * (256 - wx) + p11[c] * wx;
+
+				dst[c] = (top * (256 - wy) + bottom * wy + (1 << 15)) >> 16;
 			}
 		}
 	}
-
-	*src = s;
 }
-#endif
 
 static RImage *rotate_image_any(RImage *source, float angle)
 {
-	(void) angle;
-	puts("NOT FULLY IMPLEMENTED");
-	return RCloneImage(source);
-#if 0
-	RImage *img;
+	rotate_any_job job;
+	RImage *target;
+	double a, abs_cos, abs_sin;
 	int nwidth, nheight;
-	int x1, y1;
-	int x2, y2;
-	int dx, dy;
-	int xi, yi;
-	int xx, yy;
-	unsigned char *src, *dst;
-	int dpr, dpru, p;
-
-	/* only 180o for now */
-	if (angle > 180.0F)
-		angle -= 180.0F;
 
-	angle = (angle * WM_PI) / 180.0;
+	a = (double) angle * WM_PI / 180.0;
+	job.cos_a = cos(a);
+	job.sin_a = sin(a);
+	abs_cos = fabs(job.cos_a);
+	abs_sin = fabs(job.sin_a);
 
-	nwidth = ceil(abs(cos(angle) * image->width))
-	    + ceil(abs(cos(WM_PI / 2 - angle) * image->width));
+	nwidth = (int) ceil(source->width * abs_cos + source->height * abs_sin - 0.001);
+	nheight = (int) ceil(source->width * abs_sin + source->height * abs_cos - 0.001);
+	if (nwidth < 1)
+		nwidth = 1;
+	if (nheight < 1)
+		nheight = 1;
 
-	nheight = ceil(abs(sin(angle) * image->height))
-	    + ceil(abs(cos(WM_PI / 2 - angle) * image->height));
-
-	img = RCreateImage(nwidth, nheight, True);
-	if (!img)
+	target = RCreateImage(nwidth, nheight, True);
+	if (!target)
 		return NULL;
 
-	src = image->data;
-	dst = img->data;
-
-	x1 = floor(abs(cos(WM_PI / 2 - angle) * image->width));
-	y1 = 0;
-
-	x2 = 0;
-	y2 = floor(abs(sin(WM_PI / 2 - angle) * image->width));
-
-	xx = floor(abs(cos(angle) * image->height)) - 1;
-	yy = nheight - 1;
-
-	printf("%ix%i, %i %i     %i %i %i\n", nwidth, nheight, x1, y1, x2, y2, (int)((angle * 180.0) / WM_PI));
+	job.source = source;
+	job.target = target;
+	job.src_cx = source->width / 2.0;
+	job.src_cy = source->height / 2.0;
+	job.dst_cx = nwidth / 2.0;
+	job.dst_cy = nheight / 2.0;
 
-	dx = abs(x2 - x1);
-	dy = abs(y2 - y1);
+	wraster_parallel_run(nheight, (unsigned long) nwidth * nheight * 4, rotate_any_lines, &job);
 
-	if (x1 > x2)
-		xi = -1;
-	else
-		xi = 1;
-	if (y1 > y2)
-		yi = -1;
-	else
-		yi = 1;
-
-	if (dx >= dy) {
-		dpr = dy << 1;
-		dpru = dpr - (dx << 1);
-		p = dpr - dx;
-
-		while (dx-- >= 0) {
-
-			copyLine(x1, y1, xx, yy, nwidth, image->format, dst, &src);
-
-			/* calc next step */
-
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				xx += xi;
-				yy += yi;
-				p += dpru;
-			} else {
-				x1 += xi;
-				xx += xi;
-				p += dpr;
-			}
-		}
-	} else {
-		dpr = dx << 1;
-		dpru = dpr - (dy << 1);
-		p = dpr - dy;
-
-		while (dy-- >= 0) {
-			xx = abs(x1 * sin(angle * WM_PI / 180.0));
-			yy = abs(y1 * cos(angle * WM_PI / 180.0));
-
-			copyLine(x1, y1, xx, yy, nwidth, image->format, dst, &src);
-
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
-			} else {
-				y1 += yi;
-				p += dpr;
-			}
-		}
-	}
-
-	return img;
-#endif
+	return target;
 }
@@ -44,7 +44,7 @@ Bool RSaveRawImage(RImage *image, const char *format, unsigned char **out_buf, s
 {
 #ifdef USE_PNG
 	if (strcasecmp(format, "PNG") == 0)
-		return RSaveRawPNG(image, NULL, out_buf, out_size);
+		return RSaveRawPNG(image, NULL, out_buf, out_size, -1);
 #endif
 
 #ifdef USE_JPEG
@@ -60,10 +60,18 @@ Bool RSaveRawImage(RImage *image, const char *format, unsigned char **out_buf, s
 }
 
 Bool RSaveTitledImage(RImage *image, const char *filename, const char *format, char *title)
+{
+	return RSaveCompressedImage(image, filename, format, title, -1);
+}
+
+Bool RSaveCompressedImage(RImage *image, const char *filename, const char *format,
+                          char *title, int level)
 {
 #ifdef USE_PNG
 	if (strcasecmp(format, "PNG") == 0)
-		return RSavePNG(image, filename, title);
+		return RSavePNG(image, filename, title, level);
+#else
+	(void) level;
 #endif
 #ifdef USE_JPEG
 	if (strcasecmp(format, "JPG") == 0)
@@ -75,13 +75,14 @@ static void png_flush_memory(png_structp png_ptr)
 
 /*
  * Save RImage to PNG data in memory
+ *
+ * 'level' is the zlib compression level, from 0 to 9, or -1 for the default
  */
-Bool RSaveRawPNG(RImage *img, char *title, unsigned char **out_buf, size_t *out_size)
+Bool RSaveRawPNG(RImage *img, char *title, unsigned char **out_buf, size_t *out_size, int level)
 {
 	png_structp png_ptr;
 	png_infop png_info_ptr;
 	png_bytep png_row;
-	RColor pixel;
 	int x, y;
 	int width = img->width;
 	int height = img->height;
@@ -131,6 +132,16 @@ Bool RSaveRawPNG(RImage *img, char *title, unsigned char **out_buf, size_t *out_
 		png_set_text(png_ptr, png_info_ptr, &title_text, 1);
 	}
 
+	/*
+	 * At the low levels, most of the time would be spent trying all the
+	 * filters on each row, while the simple SUB filter gives most of the gain
+	 */
+	if (level >= 0) {
+		png_set_compression_level(png_ptr, level > 9 ? 9 : level);
+		if (level <= 3)
+			png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+	}
+
 	png_write_info(png_ptr, png_info_ptr);
 
 	/* Allocate memory for one row (3 bytes per pixel - RGB) */
@@ -145,14 +156,19 @@ Bool RSaveRawPNG(RImage *img, char *title, unsigned char **out_buf, size_t *out_
 
 	/* Write image data */
 	for (y = 0; y < height; y++) {
+		if (img->format == RRGBFormat) {
+			/* Same layout as the PNG row, no need for a copy */
+			png_write_row(png_ptr, img->data + y * width * 3);
+			continue;
+		}
+
 		for (x = 0; x < width; x++) {
-			png_byte *ptr;
-			
-			RGetPixel(img, x, y, &pixel);
-			ptr = &(png_row[x * 3]);
-			ptr[0] = pixel.red;
-			ptr[1] = pixel.green;
-			ptr[2] = pixel.blue;
+			const unsigned char *src = img->data + (y * width + x) * 4;
+			png_byte *ptr = &(png_row[x * 3]);
+
+			ptr[0] = src[0];
+			ptr[1] = src[1];
+			ptr[2] = src[2];
 		}
 		png_write_row(png_ptr, png_row);
 	}
@@ -178,7 +194,7 @@ Bool RSaveRawPNG(RImage *img, char *title, unsigned char **out_buf, size_t *out_
 /*
  * Save RImage to PNG image
  */
-Bool RSavePNG(RImage *img, const char *filename, char *title)
+Bool RSavePNG(RImage *img, const char *filename, char *title, int level)
 {
 	FILE *file;
 	unsigned char *png_data = NULL;
@@ -191,7 +207,7 @@ Bool RSavePNG(RImage *img, const char *filename, char *title)
 	}
 
 	/* Use RSaveRawPNG to generate PNG data in memory */
-	if (!RSaveRawPNG(img, title, &png_data, &png_size)) {
+	if (!RSaveRawPNG(img, title, &png_data, &png_size, level)) {
 		/* Error code already set by RSaveRawPNG */
 		return False;
 	}
@@ -3,7 +3,9 @@
 #include "wraster.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include "tile.xpm"
 Display *dpy;
 Window win;
@@ -13,11 +15,85 @@ Pixmap pix;
 
 #define MAX(a,b) (a)>(b) ? (a) : (b)
 
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+/*
+ * Time the rotations on a generated image, no X display is needed:
+ *   testrot -b [width height [alpha]]
+ */
+static int benchmark(int width, int height, int alpha)
+{
+	static const float angles[] = { 90.0F, 180.0F, 270.0F, 30.0F, 135.0F };
+	const int loops = 5;
+	unsigned char *p;
+	RImage *image;
+	long i, size;
+	int a, n;
+
+	image = RCreateImage(width, height, alpha);
+	if (!image) {
+		puts(RMessageForError(RErrorCode));
+		return 1;
+	}
+
+	/* some content so the memory is really allocated */
+	size = (long) width * height * (alpha ? 4 : 3);
+	for (i = 0, p = image->data; i < size; i++)
+		*p++ = i * 7;
+
+	printf("rotating %dx%d %s image, %d times each\n", width, height, alpha ? "RGBA" : "RGB", loops);
+
+	for (a = 0; a < sizeof(angles) / sizeof(angles[0]); a++) {
+		double start, elapsed;
+
+		start = now();
+		for (n = 0; n < loops; n++) {
+			RImage *tmp = RRotateImage(image, angles[a]);
+
+			if (!tmp) {
+				puts(RMessageForError(RErrorCode));
+				return 1;
+			}
+			RReleaseImage(tmp);
+		}
+		elapsed = (now() - start) / loops;
+
+		printf("%6.1f degrees: %8.2f ms  %8.1f Mpixel/s\n", angles[a], elapsed * 1000.0,
+		       (double) width * height / elapsed / 1.0e6);
+	}
+
+	RReleaseImage(image);
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	RContextAttributes attr;
 	float a;
 
+	if (argc >= 2 && strcmp(argv[1], "-b") == 0) {
+		int width = 8192, height = 6144, alpha = 0;
+
+		if (argc >= 4) {
+			width = atoi(argv[2]);
+			height = atoi(argv[3]);
+		}
+		if (argc >= 5)
+			alpha = atoi(argv[4]);
+
+		if (width <= 0 || height <= 0) {
+			puts("usage: testrot -b [width height [alpha]]");
+			exit(1);
+		}
+		exit(benchmark(width, height, alpha));
+	}
+
 	dpy = XOpenDisplay("");
 	if (!dpy) {
 		puts("cant open display");
@@ -0,0 +1,741 @@
+/* wrbench.c - measure the speed of the wrlib hot paths
+ *
+ * Raster graphics library
+ *
+ * Copyright (c) 2026 Window Maker Team
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/*
+ * Each case is run until it has taken a minimum amount of time, and the
+ * result is printed in JSON so it can be kept and compared with a later run:
+ *
+ *   { "width": 1024, "height": 768, ...,
+ *     "results": [ { "name": "scale/smooth/mitchell", "calls": 52,
+ *                    "ns_per_call": 3848211, "mpixels_per_s": 204.3 }, ... ],
+ *     "skipped": [ { "name": "convert", "reason": "no X display" }, ... ] }
+ *
+ * Everything but the conversion to X pixmaps works without an X server; when
+ * a display is available, the conversion is measured on each kind of visual
+ * and the smooth scaling with each filter (which can only be selected through
+ * a context).
+ */
+
+#include <config.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "wraster.h"
+
+
+typedef void bench_func(void *data);
+
+static const char *ProgName;
+
+static FILE *output;
+static double min_time = 0.2;
+static int width = 1024;
+static int height = 768;
+
+static Display *dpy = NULL;
+static RContext *ctx = NULL;
+
+/* Enough for the loaders when there is no display, they only look at the attributes */
+static RContextAttributes headless_attribs;
+static RContext headless_ctx;
+
+static int result_count = 0;
+static int skip_count = 0;
+static char skipped[4096];
+
+
+static double now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec + tv.tv_usec / 1e6;
+	}
+}
+
+/*
+ * Run 'func' until 'min_time' has passed (at least 3 times, after one call
+ * to warm up the caches) and print the result; 'pixels' is the number of
+ * pixels processed by one call, for the throughput
+ */
+static void run(const char *name, bench_func *func, void *data, unsigned long pixels)
+{
+	double start, elapsed;
+	long calls = 0;
+
+	func(data);
+
+	start = now();
+	do {
+		func(data);
+		calls++;
+		elapsed = now() - start;
+	} while (elapsed < min_time || calls < 3);
+
+	fprintf(output, "%s    { \"name\": \"%s\", \"calls\": %ld, \"ns_per_call\": %.0f, \"mpixels_per_s\": %.2f }",
+	        result_count ? ",\n" : "", name, calls, elapsed * 1e9 / calls,
+	        pixels * calls / elapsed / 1e6);
+	fflush(output);
+	result_count++;
+
+	if (output != stdout)
+		fprintf(stderr, "%-40s %12.0f ns/call\n", name, elapsed * 1e9 / calls);
+}
+
+static void skip(const char *name, const char *reason)
+{
+	size_t len = strlen(skipped);
+
+	snprintf(skipped + len, sizeof(skipped) - len, "%s    { \"name\": \"%s\", \"reason\": \"%s\" }",
+	         skip_count ? ",\n" : "", name, reason);
+	skip_count++;
+}
+
+static RImage *make_test_image(int w, int h, int alpha)
+{
+	RImage *image;
+	unsigned char *p;
+	int x, y, channels;
+
+	image = RCreateImage(w, h, alpha);
+	if (!image) {
+		fprintf(stderr, "%s: could not create a %dx%d image\n", ProgName, w, h);
+		exit(1);
+	}
+
+	/* Something with smooth areas and edges, like real pictures */
+	channels = alpha ? 4 : 3;
+	p = image->data;
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			p[0] = (x * 255) / w;
+			p[1] = (y * 255) / h;
+			p[2] = ((x / 32 + y / 32) & 1) ? 200 : 40;
+			if (alpha)
+				p[3] = (x + y) & 255;
+			p += channels;
+		}
+	}
+
+	return image;
+}
+
+/*
+ * Conversion to X
+ */
+
+typedef struct {
+	RContext *context;
+	RImage *image;
+} ConvertData;
+
+static void bench_convert(void *arg)
+{
+	ConvertData *data = arg;
+	Pixmap pixmap;
+
+	if (RConvertImage(data->context, data->image, &pixmap))
+		XFreePixmap(dpy, pixmap);
+
+	/* The pixels are only sent for real when the requests are processed */
+	XSync(dpy, False);
+}
+
+static const char *visual_class_name(int class)
+{
+	switch (class) {
+	case StaticGray:
+		return "staticgray";
+	case GrayScale:
+		return "grayscale";
+	case StaticColor:
+		return "staticcolor";
+	case PseudoColor:
+		return "pseudocolor";
+	case TrueColor:
+		return "truecolor";
+	case DirectColor:
+		return "directcolor";
+	default:
+		return "unknown";
+	}
+}
+
+static void bench_conversions(RImage *image)
+{
+	XVisualInfo template, *visuals;
+	int count, i, j, mode;
+	char name[128];
+
+	if (!dpy) {
+		skip("convert", "no X display");
+		return;
+	}
+
+	template.screen = DefaultScreen(dpy);
+	visuals = XGetVisualInfo(dpy, VisualScreenMask, &template, &count);
+
+	for (i = 0; i < count; i++) {
+		/* Only one visual for each kind, the others would give the same result */
+		for (j = 0; j < i; j++)
+			if (visuals[j].class == visuals[i].class && visuals[j].depth == visuals[i].depth)
+				break;
+		if (j < i)
+			continue;
+
+		for (mode = RDitheredRendering; mode <= RBestMatchRendering; mode++) {
+			RContextAttributes attribs;
+			ConvertData data;
+
+			attribs.flags = RC_VisualID | RC_RenderMode;
+			attribs.visualid = visuals[i].visualid;
+			attribs.render_mode = mode;
+
+			snprintf(name, sizeof(name), "convert/%s-%d/%s", visual_class_name(visuals[i].class),
+			         visuals[i].depth, mode == RDitheredRendering ? "dither" : "match");
+
+			data.context = RCreateContext(dpy, DefaultScreen(dpy), &attribs);
+			if (!data.context) {
+				skip(name, "could not create the context");
+				continue;
+			}
+			data.image = image;
+
+			run(name, bench_convert, &data, image->width * image->height);
+			RDestroyContext(data.context);
+		}
+	}
+
+	XFree(visuals);
+}
+
+/*
+ * Scaling
+ */
+
+typedef struct {
+	RImage *image;
+	int width, height;
+} ScaleData;
+
+static void bench_scale(void *arg)
+{
+	ScaleData *data = arg;
+
+	RReleaseImage(RScaleImage(data->image, data->width, data->height));
+}
+
+static void bench_smooth_scale(void *arg)
+{
+	ScaleData *data = arg;
+
+	RReleaseImage(RSmoothScaleImage(data->image, data->width, data->height));
+}
+
+static void bench_scaling(RImage *image)
+{
+	static const struct {
+		RScalingFilter filter;
+		const char *name;
+	} filters[] = {
+		{ RBoxFilter, "box" },
+		{ RTriangleFilter, "triangle" },
+		{ RBellFilter, "bell" },
+		{ RBSplineFilter, "bspline" },
+		{ RLanczos3Filter, "lanczos3" },
+		{ RMitchellFilter, "mitchell" }
+	};
+	ScaleData down, up;
+	char name[128];
+	int i;
+
+	down.image = image;
+	down.width = image->width / 2;
+	down.height = image->height / 2;
+	up.image = image;
+	up.width = image->width * 3 / 2;
+	up.height = image->height * 3 / 2;
+
+	/* Counted in source pixels, so the numbers can be compared */
+	run("scale/fast/down", bench_scale, &down, image->width * image->height);
+	run("scale/fast/up", bench_scale, &up, image->width * image->height);
+
+	if (!dpy) {
+		/* The filter used by default, until a context selects another one */
+		run("scale/smooth/mitchell/down", bench_smooth_scale, &down, image->width * image->height);
+		run("scale/smooth/mitchell/up", bench_smooth_scale, &up, image->width * image->height);
+		skip("scale/smooth/other-filters", "no X display to create a context");
+		return;
+	}
+
+	for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+		RContextAttributes attribs;
+		RContext *context;
+
+		/* Creating the context is the only way to select the filter */
+		attribs.flags = RC_ScalingFilter;
+		attribs.scaling_filter = filters[i].filter;
+		context = RCreateContext(dpy, DefaultScreen(dpy), &attribs);
+		if (!context) {
+			skip(filters[i].name, "could not create the context");
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "scale/smooth/%s/down", filters[i].name);
+		run(name, bench_smooth_scale, &down, image->width * image->height);
+		snprintf(name, sizeof(name), "scale/smooth/%s/up", filters[i].name);
+		run(name, bench_smooth_scale, &up, image->width * image->height);
+
+		RDestroyContext(context);
+	}
+}
+
+/*
+ * Gradients
+ */
+
+typedef struct {
+	int type;
+	RGradientStyle style;
+} GradientData;
+
+static void bench_gradient(void *arg)
+{
+	GradientData *data = arg;
+	RColor from = { 0x20, 0x40, 0x80, 0xff };
+	RColor middle = { 0xff, 0xff, 0xff, 0xff };
+	RColor to = { 0xa0, 0x10, 0x10, 0xff };
+	RColor *colors[4] = { &from, &middle, &to, NULL };
+	RColor stripes1[2] = { from, to };
+	RColor stripes2[2] = { middle, to };
+
+	switch (data->type) {
+	case 0:
+		RReleaseImage(RRenderGradient(width, height, &from, &to, data->style));
+		break;
+	case 1:
+		RReleaseImage(RRenderMultiGradient(width, height, colors, data->style));
+		break;
+	default:
+		RReleaseImage(RRenderInterwovenGradient(width, height, stripes1, 8, stripes2, 4));
+		break;
+	}
+}
+
+static void bench_gradients(void)
+{
+	static const struct {
+		RGradientStyle style;
+		const char *name;
+	} styles[] = {
+		{ RHorizontalGradient, "horizontal" },
+		{ RVerticalGradient, "vertical" },
+		{ RDiagonalGradient, "diagonal" }
+	};
+	GradientData data;
+	char name[128];
+	int i;
+
+	for (data.type = 0; data.type < 2; data.type++) {
+		for (i = 0; i < sizeof(styles) / sizeof(styles[0]); i++) {
+			data.style = styles[i].style;
+			snprintf(name, sizeof(name), "gradient/%s/%s", data.type ? "multi" : "simple", styles[i].name);
+			run(name, bench_gradient, &data, width * height);
+		}
+	}
+
+	data.type = 2;
+	run("gradient/interwoven", bench_gradient, &data, width * height);
+}
+
+/*
+ * Combining and effects, done in place on a copy
+ */
+
+typedef struct {
+	RImage *source;
+	RImage *target;
+	int param;
+} EffectData;
+
+static void bench_combine_area(void *arg)
+{
+	EffectData *data = arg;
+
+	RCombineArea(data->target, data->source, 0, 0, data->source->width, data->source->height, 0, 0);
+}
+
+static void bench_combine_opaqueness(void *arg)
+{
+	EffectData *data = arg;
+
+	RCombineAreaWithOpaqueness(data->target, data->source, 0, 0,
+	                           data->source->width, data->source->height, 0, 0, data->param);
+}
+
+static void bench_blur(void *arg)
+{
+	EffectData *data = arg;
+
+	RBlurImage(data->target);
+}
+
+static void bench_box_blur(void *arg)
+{
+	EffectData *data = arg;
+
+	RBoxBlurImage(data->target, data->param);
+}
+
+static void bench_gaussian_blur(void *arg)
+{
+	EffectData *data = arg;
+
+	RGaussianBlurImage(data->target, data->param);
+}
+
+static void bench_rotate(void *arg)
+{
+	EffectData *data = arg;
+
+	RReleaseImage(RRotateImage(data->source, data->param));
+}
+
+static void bench_flip(void *arg)
+{
+	EffectData *data = arg;
+
+	RReleaseImage(RFlipImage(data->source, data->param));
+}
+
+static void bench_clone(void *arg)
+{
+	EffectData *data = arg;
+
+	RReleaseImage(RCloneImage(data->source));
+}
+
+static void bench_clone_write(void *arg)
+{
+	EffectData *data = arg;
+	RImage *copy;
+
+	copy = RCloneImage(data->source);
+	RMakeImageWritable(copy);
+	RReleaseImage(copy);
+}
+
+static void bench_effects(RImage *image, RImage *alpha_image)
+{
+	EffectData data;
+	unsigned long pixels = image->width * image->height;
+	char name[128];
+	static const int angles[] = { 90, 180, 270, 30 };
+	int i;
+
+	/* A clone shares the pixels until it is modified */
+	data.source = image;
+	run("clone/shared", bench_clone, &data, pixels);
+	run("clone/written", bench_clone_write, &data, pixels);
+
+	data.source = alpha_image;
+	data.target = RCloneImage(image);
+	data.param = 128;
+
+	run("combine/area", bench_combine_area, &data, pixels);
+	run("combine/opaqueness", bench_combine_opaqueness, &data, pixels);
+
+	run("blur/3x3", bench_blur, &data, pixels);
+	data.param = 8;
+	run("blur/box/8", bench_box_blur, &data, pixels);
+	run("blur/gaussian/8", bench_gaussian_blur, &data, pixels);
+	data.param = 32;
+	run("blur/gaussian/32", bench_gaussian_blur, &data, pixels);
+
+	RReleaseImage(data.target);
+
+	data.source = image;
+	for (i = 0; i < sizeof(angles) / sizeof(angles[0]); i++) {
+		data.param = angles[i];
+		snprintf(name, sizeof(name), "rotate/%d", angles[i]);
+		run(name, bench_rotate, &data, pixels);
+	}
+
+	data.param = RHorizontalFlip;
+	run("flip/horizontal", bench_flip, &data, pixels);
+	data.param = RVerticalFlip;
+	run("flip/vertical", bench_flip, &data, pixels);
+}
+
+/*
+ * Loaders and savers
+ */
+
+typedef struct {
+	RImage *image;
+	const char *file;
+	const char *format;
+	int level;
+} FileData;
+
+static void bench_save(void *arg)
+{
+	FileData *data = arg;
+
+	if (!RSaveCompressedImage(data->image, data->file, data->format, NULL, data->level)) {
+		fprintf(stderr, "%s: could not save %s: %s\n", ProgName, data->file, RMessageForError(RErrorCode));
+		exit(1);
+	}
+}
+
+static void bench_load(void *arg)
+{
+	FileData *data = arg;
+	RImage *image;
+
+	image = RLoadImage(ctx, data->file, 0);
+	if (!image) {
+		fprintf(stderr, "%s: could not load %s: %s\n", ProgName, data->file, RMessageForError(RErrorCode));
+		exit(1);
+	}
+	RReleaseImage(image);
+}
+
+static Bool write_ppm(RImage *image, const char *file)
+{
+	FILE *f;
+	int i;
+
+	f = fopen(file, "wb");
+	if (!f)
+		return False;
+
+	fprintf(f, "P6\n%d %d\n255\n", image->width, image->height);
+	for (i = 0; i < image->width * image->height; i++)
+		fwrite(image->data + i * 3, 1, 3, f);
+
+	return fclose(f) == 0;
+}
+
+static void bench_files(RImage *image, const char *tmpdir)
+{
+	static const struct {
+		const char *format;	/* as named by RSupportedFileFormats */
+		const char *saver;	/* as expected by RSaveImage, NULL when there is none */
+		const char *extension;
+	} formats[] = {
+		{ "PNG", "PNG", "png" },
+		{ "JPEG", "JPEG", "jpg" },
+		{ "XPM", "XPM", "xpm" },
+		{ "PPM", NULL, "ppm" },
+		{ "TIFF", NULL, "tiff" },
+		{ "GIF", NULL, "gif" },
+		{ "WEBP", NULL, "webp" },
+		{ "JXL", NULL, "jxl" }
+	};
+	char **supported = RSupportedFileFormats();
+	char file[1024], name[128];
+	RImage *small;
+	FileData data;
+	int i, j;
+
+	/* XPM is meant for icons, a full image would take ages and be of no use */
+	small = RScaleImage(image, 64, 64);
+
+	for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		for (j = 0; supported[j]; j++)
+			if (strcmp(supported[j], formats[i].format) == 0)
+				break;
+		snprintf(name, sizeof(name), "load/%s", formats[i].extension);
+		if (!supported[j]) {
+			skip(name, "format not supported in this build");
+			continue;
+		}
+
+		snprintf(file, sizeof(file), "%s/wrbench.%s", tmpdir, formats[i].extension);
+		data.file = file;
+		data.format = formats[i].saver;
+		data.image = (strcmp(formats[i].format, "XPM") == 0) ? small : image;
+		data.level = -1;
+
+		if (formats[i].saver) {
+			snprintf(name, sizeof(name), "save/%s", formats[i].extension);
+			run(name, bench_save, &data, data.image->width * data.image->height);
+
+			if (strcmp(formats[i].format, "PNG") == 0) {
+				data.level = 1;
+				run("save/png/fast", bench_save, &data, data.image->width * data.image->height);
+			}
+		} else if (strcmp(formats[i].format, "PPM") == 0) {
+			if (!write_ppm(image, file)) {
+				skip(name, "could not write the sample file");
+				continue;
+			}
+		} else {
+			skip(name, "no encoder to create a sample file");
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "load/%s", formats[i].extension);
+		if (strcmp(formats[i].format, "XPM") == 0 && !dpy)
+			skip(name, "no X display for the colors");
+		else
+			run(name, bench_load, &data, data.image->width * data.image->height);
+
+		unlink(file);
+	}
+
+	RReleaseImage(small);
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [options]\n", ProgName);
+	puts("Measure the speed of the main functions of wrlib and print the results in JSON");
+	puts("");
+	puts(" -d display       X display to use for the conversions (default: $DISPLAY)");
+	puts(" -n               do not use any X display");
+	puts(" -o file          write the results to file instead of the standard output");
+	puts(" -s WIDTHxHEIGHT  size of the test image (default: 1024x768)");
+	puts(" -t seconds       minimum time spent on each case (default: 0.2)");
+	puts(" -T directory     where to write the temporary files (default: $TMPDIR or /tmp)");
+	puts(" -h               display this help and exit");
+}
+
+int main(int argc, char **argv)
+{
+	const char *display_name = NULL;
+	const char *tmpdir;
+	Bool use_display = True;
+	RImage *image, *alpha_image;
+	RImageStats stats;
+	int opt;
+
+	ProgName = strrchr(argv[0], '/');
+	if (!ProgName)
+		ProgName = argv[0];
+	else
+		ProgName++;
+
+	output = stdout;
+	tmpdir = getenv("TMPDIR");
+	if (!tmpdir || !*tmpdir)
+		tmpdir = "/tmp";
+
+	while ((opt = getopt(argc, argv, "d:hno:s:t:T:")) != -1) {
+		switch (opt) {
+		case 'd':
+			display_name = optarg;
+			break;
+		case 'n':
+			use_display = False;
+			break;
+		case 'o':
+			output = fopen(optarg, "w");
+			if (!output) {
+				fprintf(stderr, "%s: could not open \"%s\" for writing\n", ProgName, optarg);
+				return 1;
+			}
+			break;
+		case 's':
+			if (sscanf(optarg, "%dx%d", &width, &height) != 2 || width < 16 || height < 16) {
+				fprintf(stderr, "%s: invalid image size \"%s\"\n", ProgName, optarg);
+				return 1;
+			}
+			break;
+		case 't':
+			min_time = atof(optarg);
+			break;
+		case 'T':
+			tmpdir = optarg;
+			break;
+		case 'h':
+			print_help();
+			return 0;
+		default:
+			print_help();
+			return 1;
+		}
+	}
+
+	/* The loaders must really decode the files each time */
+	setenv("RIMAGE_CACHE", "0", 1);
+
+	if (use_display)
+		dpy = XOpenDisplay(display_name);
+	if (dpy) {
+		ctx = RCreateContext(dpy, DefaultScreen(dpy), NULL);
+		if (!ctx) {
+			fprintf(stderr, "%s: could not create the context: %s\n", ProgName, RMessageForError(RErrorCode));
+			return 1;
+		}
+	} else {
+		headless_ctx.attribs = &headless_attribs;
+		headless_ctx.depth = 24;
+		ctx = &headless_ctx;
+	}
+
+	image = make_test_image(width, height, 0);
+	alpha_image = make_test_image(width, height, 1);
+
+	fprintf(output, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"display\": %s,\n  \"threads\": \"%s\",\n",
+	        width, height, dpy ? "true" : "false", getenv("WRASTER_THREADS") ? getenv("WRASTER_THREADS") : "auto");
+	fprintf(output, "  \"results\": [\n");
+
+	bench_conversions(image);
+	bench_scaling(image);
+	bench_gradients();
+	bench_effects(image, alpha_image);
+	bench_files(image, tmpdir);
+
+	RGetImageStats(&stats);
+	fprintf(output, "\n  ],\n  \"skipped\": [\n%s\n  ],\n", skipped);
+	fprintf(output, "  \"image_stats\": { \"peak_buffer_bytes\": %lu, \"shared_clones\": %lu, \"shared_bytes\": %lu, \"copies_on_write\": %lu, \"copied_bytes\": %lu }\n}\n",
+	        stats.peak_buffer_bytes, stats.shared_clones, stats.shared_bytes,
+	        stats.copies_on_write, stats.copied_bytes);
+
+	RReleaseImage(image);
+	RReleaseImage(alpha_image);
+	if (output != stdout)
+		fclose(output);
+	if (dpy) {
+		RDestroyContext(ctx);
+		XCloseDisplay(dpy);
+	}
+
+	return 0;
+}
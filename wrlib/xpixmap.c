@@ -149,7 +149,8 @@ RImage *RCreateImageFromXImage(RContext * context, XImage * image, XImage * mask
 RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap mask)
 {
 	RImage *image;
-	XImage *pimg, *mimg;
+	RXImage *pimg;
+	XImage *mimg;
 	unsigned int w, h, bar;
 	int foo;
 	Window baz;
@@ -160,7 +161,7 @@ RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap m
 		fprintf(stderr, _("wrlib: invalid window or pixmap passed to RCreateImageFromDrawable\n"));
 		return NULL;
 	}
-	pimg = XGetImage(context->dpy, drawable, 0, 0, w, h, AllPlanes, ZPixmap);
+	pimg = RGetXImage(context, drawable, 0, 0, w, h);
 
 	if (!pimg) {
 		RErrorCode = RERR_XERROR;
@@ -173,9 +174,9 @@ RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap m
 		}
 	}
 
-	image = RCreateImageFromXImage(context, pimg, mimg);
+	image = RCreateImageFromXImage(context, pimg->image, mimg);
 
-	XDestroyImage(pimg);
+	RDestroyXImage(context, pimg);
 	if (mimg)
 		XDestroyImage(mimg);
 
@@ -43,6 +43,9 @@
 
 #ifdef USE_XSHM
 
+/* Size from which RGetXImage uses shared memory */
+#define SHM_GET_MIN_PIXELS	(64 * 1024)
+
 static int shmError;
 
 static int (*oldErrorHandler)(Display *dpy, XErrorEvent *err);
@@ -193,15 +196,22 @@ RXImage *RGetXImage(RContext * context, Drawable d, int x, int y, unsigned width
 	RXImage *ximg = NULL;
 
 #ifdef USE_XSHM
-	if (context->attribs->use_shared_memory && 0) {
-		ximg = RCreateXImage(context, getDepth(context->dpy, d), width, height);
+	/*
+	 * Going through shared memory costs a few system calls, it is only worth
+	 * it when the pixels would take long to go through the socket. The image
+	 * is created with the visual of the context, so the drawable must match
+	 */
+	if (context->attribs->use_shared_memory && (unsigned long) width * height >= SHM_GET_MIN_PIXELS
+	    && getDepth(context->dpy, d) == context->depth) {
+		ximg = RCreateXImage(context, context->depth, width, height);
 
 		if (ximg && !ximg->is_shared) {
 			RDestroyXImage(context, ximg);
 			ximg = NULL;
 		}
-		if (ximg) {
-			XShmGetImage(context->dpy, d, ximg->image, x, y, AllPlanes);
+		if (ximg && !XShmGetImage(context->dpy, d, ximg->image, x, y, AllPlanes)) {
+			RDestroyXImage(context, ximg);
+			ximg = NULL;
 		}
 	}
 	if (!ximg) {